@@ -182,4 +182,5 @@ template class CacheReservationManagerImpl<CacheEntryRole::kMisc>;
 template class CacheReservationManagerImpl<CacheEntryRole::kWriteBuffer>;
 template class CacheReservationManagerImpl<CacheEntryRole::kFileMetadata>;
 template class CacheReservationManagerImpl<CacheEntryRole::kBlobCache>;
+template class CacheReservationManagerImpl<CacheEntryRole::kGlobalSecIndex>;
 }  // namespace ROCKSDB_NAMESPACE
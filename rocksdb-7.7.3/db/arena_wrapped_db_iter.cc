@@ -37,16 +37,15 @@ void ArenaWrappedDBIter::Init(
     uint64_t version_number, ReadCallback* read_callback, DBImpl* db_impl,
     ColumnFamilyData* cfd, bool expose_blob_index, bool allow_refresh) {
   auto mem = arena_.AllocateAligned(sizeof(DBIter));
-  // db_iter_ =
-  //     new (mem) DBIter(env, read_options, ioptions, mutable_cf_options,
-  //                      ioptions.user_comparator, /* iter */ nullptr, version,
-  //                      sequence, true, max_sequential_skip_in_iteration,
-  //                      read_callback, db_impl, cfd, expose_blob_index);
+  // Secondary index scans return their entries in secondary index order
+  const Comparator* user_comparator = read_options.is_secondary_index_scan
+                                          ? ioptions.user_sec_comparator
+                                          : ioptions.user_comparator;
   db_iter_ =
       new (mem) DBIter(env, read_options, ioptions, mutable_cf_options,
-                       ioptions.user_sec_comparator, /* iter */ nullptr, version,
-                       sequence, true, max_sequential_skip_in_iteration,
-                       read_callback, db_impl, cfd, expose_blob_index);
+                       user_comparator, /* iter */ nullptr, version, sequence,
+                       true, max_sequential_skip_in_iteration, read_callback,
+                       db_impl, cfd, expose_blob_index);
   sv_number_ = version_number;
   read_options_ = read_options;
   allow_refresh_ = allow_refresh;
@@ -437,6 +437,14 @@ class ColumnFamilyData {
   const InternalKeyComparator& internal_sec_comparator() const {
     return internal_sec_comparator_;
   }
+  // The order of the entries of an iterator created with `read_options`:
+  // secondary index scans are ordered by the secondary comparator, all other
+  // reads by the primary one. thread-safe
+  const InternalKeyComparator& internal_comparator_for_read(
+      const ReadOptions& read_options) const {
+    return read_options.is_secondary_index_scan ? internal_sec_comparator_
+                                                : internal_comparator_;
+  }
 
   const IntTblPropCollectorFactories* int_tbl_prop_collector_factories() const {
     return &int_tbl_prop_collector_factories_;
@@ -47,6 +47,7 @@
 #include "db/merge_helper.h"
 #include "db/periodic_task_scheduler.h"
 #include "db/range_tombstone_fragmenter.h"
+#include "db/secondary_query_iterator.h"
 #include "db/table_cache.h"
 #include "db/table_properties_collector.h"
 #include "db/transaction_log_impl.h"
@@ -89,6 +90,7 @@
 #include "table/get_context.h"
 #include "table/merging_iterator.h"
 #include "table/multiget_context.h"
+#include "table/sec_fan_out_iterator.h"
 #include "table/sst_file_dumper.h"
 #include "table/table_builder.h"
 #include "table/two_level_iterator.h"
@@ -1799,12 +1801,8 @@ InternalIterator* DBImpl::NewInternalIterator(
   InternalIterator* internal_iter;
   assert(arena != nullptr);
   // Need to create internal iterator from the arena.
-  // MergeIteratorBuilder merge_iter_builder(
-  //     &cfd->internal_comparator(), arena,
-  //     !read_options.total_order_seek &&
-  //         super_version->mutable_cf_options.prefix_extractor != nullptr);
   MergeIteratorBuilder merge_iter_builder(
-      &cfd->internal_sec_comparator(), arena,
+      &cfd->internal_comparator_for_read(read_options), arena,
       !read_options.total_order_seek &&
           super_version->mutable_cf_options.prefix_extractor != nullptr);
   // Collect iterator for mutable memtable
@@ -3142,6 +3140,29 @@ void DBImpl::MultiGetWithCallback(
                                multiget_cf_data[0].super_version);
 }
 
+void DBImpl::MultiGetWithSequences(const ReadOptions& read_options,
+                                   ColumnFamilyHandle* column_family,
+                                   SuperVersion* sv, SequenceNumber snapshot,
+                                   size_t num_keys, const Slice* keys,
+                                   PinnableSlice* values, Status* statuses,
+                                   SequenceNumber* seqs) {
+  autovector<KeyContext, MultiGetContext::MAX_BATCH_SIZE> key_context;
+  autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE> sorted_keys;
+  for (size_t i = 0; i < num_keys; ++i) {
+    key_context.emplace_back(column_family, keys[i], &values[i],
+                             /*timestamp=*/nullptr, &statuses[i]);
+    key_context.back().seq = &seqs[i];
+  }
+  for (size_t i = 0; i < num_keys; ++i) {
+    sorted_keys.emplace_back(&key_context[i]);
+  }
+  PrepareMultiGetKeys(num_keys, false /* sorted */, &sorted_keys);
+  Status s = MultiGetImpl(read_options, 0, num_keys, &sorted_keys, sv,
+                          snapshot, nullptr);
+  assert(s.ok() || s.IsTimedOut() || s.IsAborted());
+  (void)s;
+}
+
 // The actual implementation of batched MultiGet. Parameters -
 // start_key - Index in the sorted_keys vector to start processing from
 // num_keys - Number of keys to lookup, starting with sorted_keys[start_key]
@@ -3583,14 +3604,9 @@ Iterator* DBImpl::NewIterator(const ReadOptions& read_options,
     SuperVersion* sv = cfd->GetReferencedSuperVersion(this);
     auto iter = new ForwardIterator(this, read_options, cfd, sv,
                                     /* allow_unprepared_value */ true);
-    // result = NewDBIterator(
-    //     env_, read_options, *cfd->ioptions(), sv->mutable_cf_options,
-    //     cfd->user_comparator(), iter, sv->current, kMaxSequenceNumber,
-    //     sv->mutable_cf_options.max_sequential_skip_in_iterations, read_callback,
-    //     this, cfd);
     result = NewDBIterator(
         env_, read_options, *cfd->ioptions(), sv->mutable_cf_options,
-        cfd->user_sec_comparator(), iter, sv->current, kMaxSequenceNumber,
+        cfd->user_comparator(), iter, sv->current, kMaxSequenceNumber,
         sv->mutable_cf_options.max_sequential_skip_in_iterations, read_callback,
         this, cfd);
 #endif
@@ -3607,6 +3623,96 @@ Iterator* DBImpl::NewIterator(const ReadOptions& read_options,
   return result;
 }
 
+Iterator* DBImpl::NewSecondaryIndexIterator(const ReadOptions& read_options,
+                                            ColumnFamilyHandle* column_family,
+                                            const Slice& query) {
+  if (read_options.managed || read_options.tailing) {
+    return NewErrorIterator(Status::NotSupported(
+        "Managed and tailing secondary index iterators are not supported."));
+  }
+  if (read_options.read_tier == kPersistedTier) {
+    return NewErrorIterator(Status::NotSupported(
+        "ReadTier::kPersistedData is not yet supported in iterators."));
+  }
+
+  assert(column_family);
+  Status s = FailIfCfHasTs(column_family);
+  if (!s.ok()) {
+    return NewErrorIterator(s);
+  }
+
+  auto cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
+  ColumnFamilyData* cfd = cfh->cfd();
+  assert(cfd != nullptr);
+  SuperVersion* sv = cfd->GetReferencedSuperVersion(this);
+  const SequenceNumber sequence = read_options.snapshot != nullptr
+                                      ? read_options.snapshot->GetSequenceNumber()
+                                      : versions_->LastSequence();
+
+  auto iter = new SecondaryQueryIterator(read_options, query, sequence);
+  const ReadOptions& ro = iter->read_options();
+  Arena* arena = iter->arena();
+  std::vector<InternalIterator*> iters;
+  std::vector<std::unique_ptr<FragmentedRangeTombstoneIterator>> tombstones;
+
+  iter->AddIterator(sv->mem->NewIterator(ro, arena));
+  sv->imm->AddIterators(ro, &iters, arena);
+  if (!ro.ignore_range_deletions) {
+    iter->AddRangeTombstones(
+        std::unique_ptr<FragmentedRangeTombstoneIterator>(
+            sv->mem->NewRangeTombstoneIterator(ro, sequence,
+                                               false /* immutable_memtable */)));
+    sv->imm->AddRangeTombstoneIterators(ro, sequence, &tombstones);
+  }
+  if (ro.read_tier != kMemtableTier) {
+    size_t num_memtable_iters = iters.size();
+    s = sv->current->AddSecondaryIndexIterators(
+        ro, file_options_, arena, &iters,
+        ro.ignore_range_deletions ? nullptr : &tombstones);
+    // Results are unordered, so the files can as well be scanned concurrently
+    const size_t num_file_iters = iters.size() - num_memtable_iters;
+    if (s.ok() && ro.sec_query_parallelism > 1 && num_file_iters > 1) {
+      InternalIterator* fan_out_iter = NewSecFanOutIterator(
+          env_, iters.data() + num_memtable_iters, num_file_iters,
+          ro.sec_query_parallelism, arena);
+      iters.resize(num_memtable_iters);
+      iters.push_back(fan_out_iter);
+    }
+  }
+  for (InternalIterator* child : iters) {
+    iter->AddIterator(child);
+  }
+  for (auto& t : tombstones) {
+    iter->AddRangeTombstones(std::move(t));
+  }
+  if (ro.validate_sec_index_results) {
+    // The lookups use the iterator's super version, so they see the same
+    // data as the scan
+    ReadOptions lookup_options = read_options;
+    lookup_options.iterator_context = nullptr;
+    lookup_options.is_secondary_index_scan = false;
+    lookup_options.sec_index_plan = nullptr;
+    iter->SetValidator([this, column_family, sv, sequence, lookup_options](
+                           size_t num_keys, const Slice* keys,
+                           PinnableSlice* values, Status* statuses,
+                           SequenceNumber* seqs) {
+      MultiGetWithSequences(lookup_options, column_family, sv, sequence,
+                            num_keys, keys, values, statuses, seqs);
+    });
+  }
+
+  SuperVersionHandle* cleanup = new SuperVersionHandle(
+      this, &mutex_, sv,
+      read_options.background_purge_on_iterator_cleanup ||
+          immutable_db_options_.avoid_unnecessary_blocking_io);
+  iter->RegisterCleanup(CleanupSuperVersionHandle, cleanup, nullptr);
+  if (!s.ok()) {
+    delete iter;
+    return NewErrorIterator(s);
+  }
+  return iter;
+}
+
 ArenaWrappedDBIter* DBImpl::NewIteratorImpl(const ReadOptions& read_options,
                                             ColumnFamilyData* cfd,
                                             SequenceNumber snapshot,
@@ -3733,14 +3839,9 @@ Status DBImpl::NewIterators(
       SuperVersion* sv = cfd->GetReferencedSuperVersion(this);
       auto iter = new ForwardIterator(this, read_options, cfd, sv,
                                       /* allow_unprepared_value */ true);
-      // iterators->push_back(NewDBIterator(
-      //     env_, read_options, *cfd->ioptions(), sv->mutable_cf_options,
-      //     cfd->user_comparator(), iter, sv->current, kMaxSequenceNumber,
-      //     sv->mutable_cf_options.max_sequential_skip_in_iterations,
-      //     read_callback, this, cfd));
       iterators->push_back(NewDBIterator(
           env_, read_options, *cfd->ioptions(), sv->mutable_cf_options,
-          cfd->user_sec_comparator(), iter, sv->current, kMaxSequenceNumber,
+          cfd->user_comparator(), iter, sv->current, kMaxSequenceNumber,
           sv->mutable_cf_options.max_sequential_skip_in_iterations,
           read_callback, this, cfd));
     }
@@ -336,6 +336,10 @@ class DBImpl : public DB {
   using DB::NewIterator;
   virtual Iterator* NewIterator(const ReadOptions& options,
                                 ColumnFamilyHandle* column_family) override;
+  using DB::NewSecondaryIndexIterator;
+  virtual Iterator* NewSecondaryIndexIterator(
+      const ReadOptions& options, ColumnFamilyHandle* column_family,
+      const Slice& query) override;
   virtual Status NewIterators(
       const ReadOptions& options,
       const std::vector<ColumnFamilyHandle*>& column_families,
@@ -2271,6 +2275,16 @@ class DBImpl : public DB {
       autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE>* sorted_keys,
       SuperVersion* sv, SequenceNumber snap_seqnum, ReadCallback* callback);
 
+  // Batched lookup of the primary keys of secondary index results, which
+  // also returns the sequence number of the value found for each key. Used
+  // to validate the results of DB::NewSecondaryIndexIterator().
+  void MultiGetWithSequences(const ReadOptions& read_options,
+                             ColumnFamilyHandle* column_family,
+                             SuperVersion* sv, SequenceNumber snapshot,
+                             size_t num_keys, const Slice* keys,
+                             PinnableSlice* values, Status* statuses,
+                             SequenceNumber* seqs);
+
   Status DisableFileDeletionsWithLock();
 
   Status IncreaseFullHistoryTsLowImpl(ColumnFamilyData* cfd,
@@ -0,0 +1,212 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "db/column_family.h"
+#include "db/db_test_util.h"
+#include "db/version_set.h"
+#include "port/stack_trace.h"
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/table.h"
+#include "test_util/sync_point.h"
+#include "util/rtree.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// DBs with a one-dimensional secondary index on a double stored at the start
+// of each value
+class DBSecondaryIndexTest : public DBTestBase {
+ public:
+  DBSecondaryIndexTest()
+      : DBTestBase("db_secondary_index_test", /*env_do_fsync=*/false) {}
+
+  Options SecondaryIndexOptions() {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.disable_auto_compactions = true;
+    options.create_global_sec_index = true;
+    options.global_sec_index_is_spatial = false;
+    options.memtable_factory.reset(
+        new SkipListSecFactory(0, SkipListSecFactory::kSecValue));
+    BlockBasedTableOptions table_options;
+    table_options.create_secondary_index = true;
+    table_options.create_sec_index_reader = true;
+    table_options.sec_index_type = BlockBasedTableOptions::kOneDRtreeSec;
+    // Many data blocks, hence many secondary index entries per file
+    table_options.block_size = 512;
+    // The secondary index orders data blocks by attribute, so its block
+    // handles cannot be delta encoded against each other
+    table_options.format_version = 3;
+    options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+    return options;
+  }
+
+  static std::string SecValue(double attribute, int padding = 64) {
+    std::string value(reinterpret_cast<const char*>(&attribute),
+                      sizeof(double));
+    value.append(padding, 'v');
+    return value;
+  }
+
+  static std::string Query(double min, double max) {
+    std::string query;
+    query.append(reinterpret_cast<const char*>(&min), sizeof(double));
+    query.append(reinterpret_cast<const char*>(&max), sizeof(double));
+    return query;
+  }
+
+  // The keys returned by DB::NewSecondaryIndexIterator() for [min, max]
+  std::multiset<std::string> SecondaryIndexScan(double min, double max,
+                                                ReadOptions ro = {}) {
+    std::multiset<std::string> keys;
+    std::unique_ptr<Iterator> it(
+        db_->NewSecondaryIndexIterator(ro, Query(min, max)));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+      keys.insert(it->key().ToString());
+    }
+    EXPECT_OK(it->status());
+    return keys;
+  }
+
+  uint64_t GetIntProperty(const std::string& property) {
+    uint64_t value = 0;
+    EXPECT_TRUE(db_->GetIntProperty(property, &value));
+    return value;
+  }
+
+  ColumnFamilyData* DefaultColumnFamilyData() {
+    return static_cast_with_check<ColumnFamilyHandleImpl>(
+               db_->DefaultColumnFamily())
+        ->cfd();
+  }
+};
+
+TEST_F(DBSecondaryIndexTest, MemoryBudgetCoarsensGlobalIndex) {
+  using GlobalSecRtree = VersionSet::GlobalSecRtree;
+  const int kNumFiles = 8;
+  const int kKeysPerFile = 300;
+  Options options = SecondaryIndexOptions();
+  DestroyAndReopen(options);
+
+  // Files whose secondary ranges all overlap, so that every file is hit
+  std::map<std::string, double> attributes;
+  Random rnd(301);
+  for (int f = 0; f < kNumFiles; f++) {
+    for (int i = 0; i < kKeysPerFile; i++) {
+      const std::string key = Key(f * kKeysPerFile + i);
+      const double attribute = rnd.Uniform(10000) / 10.0;
+      attributes[key] = attribute;
+      ASSERT_OK(Put(key, SecValue(attribute)));
+    }
+    ASSERT_OK(Flush());
+  }
+  const uint64_t raw_entries =
+      GetIntProperty(DB::Properties::kGlobalSecIndexEntries);
+  const uint64_t raw_bytes =
+      GetIntProperty(DB::Properties::kGlobalSecIndexBytes);
+  ASSERT_GT(raw_entries, static_cast<uint64_t>(kNumFiles) * 10);
+  fprintf(stderr, "DBG all %d\n", (int)SecondaryIndexScan(0, 2000).size());
+  {
+    ReadOptions ro; RtreeIteratorContext ctx; ctx.query_mbr = Query(0, 2000);
+    ro.iterator_context = &ctx; ro.is_secondary_index_scan = true; ro.is_secondary_index_spatial = false;
+    std::unique_ptr<Iterator> it(db_->NewIterator(ro)); int n = 0;
+    for (it->SeekToFirst(); it->Valid(); it->Next()) n++;
+    fprintf(stderr, "DBG iter %d %s\n", n, it->status().ToString().c_str());
+  }
+
+  // Reopen with a quarter of the memory the index takes. The next flush
+  // schedules the repack, the one after installs its result.
+  options.global_sec_index_memory_budget = raw_bytes / 4;
+  Reopen(options);
+  ASSERT_EQ(raw_entries,
+            GetIntProperty(DB::Properties::kGlobalSecIndexEntries));
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"VersionSet::BGWorkRepackGlobalSecIndex:Done",
+        "DBSecondaryIndexTest::MemoryBudgetCoarsensGlobalIndex:Repacked"}});
+  SyncPoint::GetInstance()->EnableProcessing();
+  ASSERT_OK(Put(Key(kNumFiles * kKeysPerFile), SecValue(-1.0)));
+  attributes[Key(kNumFiles * kKeysPerFile)] = -1.0;
+  ASSERT_OK(Flush());
+  TEST_SYNC_POINT(
+      "DBSecondaryIndexTest::MemoryBudgetCoarsensGlobalIndex:Repacked");
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_OK(Put(Key(kNumFiles * kKeysPerFile + 1), SecValue(-2.0)));
+  attributes[Key(kNumFiles * kKeysPerFile + 1)] = -2.0;
+  ASSERT_OK(Flush());
+
+  const uint64_t entries =
+      GetIntProperty(DB::Properties::kGlobalSecIndexEntries);
+  EXPECT_LT(entries, raw_entries);
+  EXPECT_LT(GetIntProperty(DB::Properties::kGlobalSecIndexBytes), raw_bytes);
+
+  // Every secondary index entry of a file overlapping a query is still
+  // covered by a hit of the coarse index
+  dbfull()->TEST_LockMutex();
+  Version* current = DefaultColumnFamilyData()->current();
+  current->Ref();
+  dbfull()->TEST_UnlockMutex();
+  ASSERT_NE(nullptr, current->global_rtree_);
+  const GlobalSecRtree& rtree = *current->global_rtree_;
+  const VersionStorageInfo* vstorage = current->storage_info();
+  for (int q = 0; q < 50; q++) {
+    const double lo = rnd.Uniform(10000) / 10.0;
+    const double hi = lo + rnd.Uniform(200) / 10.0;
+    const double query_min[1] = {lo};
+    const double query_max[1] = {hi};
+    GlobalSecRtree::ElemType min[1];
+    GlobalSecRtree::ElemType max[1];
+    GlobalSecRtree::NarrowRect(query_min, query_max, min, max);
+    std::vector<GlobalSecIndexValue> hits;
+    rtree.Visit(min, max, [&hits](const GlobalSecIndexValue& value) {
+      hits.push_back(value);
+      return true;
+    });
+    for (int level = 0; level < vstorage->num_levels(); level++) {
+      for (const FileMetaData* file : vstorage->LevelFiles(level)) {
+        const uint64_t file_number = file->fd.GetNumber();
+        for (size_t id = 0; id < file->SecValrange.size(); id++) {
+          const Interval& range = file->SecValrange[id].first.range;
+          if (range.max < lo || range.min > hi) {
+            continue;
+          }
+          bool covered = false;
+          for (const GlobalSecIndexValue& hit : hits) {
+            covered |= hit.filenum == file_number &&
+                       static_cast<size_t>(hit.id) <= id &&
+                       id < static_cast<size_t>(hit.id) + hit.count;
+          }
+          EXPECT_TRUE(covered) << "file " << file_number << " entry " << id
+                               << " query [" << lo << "," << hi << "]";
+        }
+      }
+    }
+
+    // The coarse hits are expanded back to the exact entries
+    std::multiset<std::string> expected;
+    for (const auto& kv : attributes) {
+      if (kv.second >= lo && kv.second <= hi) {
+        expected.insert(kv.first);
+      }
+    }
+    EXPECT_EQ(expected, SecondaryIndexScan(lo, hi));
+  }
+  dbfull()->TEST_LockMutex();
+  current->Unref();
+  dbfull()->TEST_UnlockMutex();
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,505 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/global_sec_index/global_sec_index_log.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+#include "db/log_reader.h"
+#include "file/filename.h"
+#include "file/read_write_util.h"
+#include "file/sequence_file_reader.h"
+#include "file/writable_file_writer.h"
+#include "logging/logging.h"
+#include "util/coding.h"
+#include "util/mutexlock.h"
+#include "util/string_util.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+const char* kGlobalSecIndexFilePrefix = "GLOBALSECINDEX-";
+
+// Number of checkpoint entries packed into a single log record
+constexpr uint32_t kCheckpointEntriesPerRecord = 4096;
+
+// Types 1 and 3 held entries with a full block handle. Files using them
+// are skipped on recovery and the index is rebuilt from the table files.
+enum GlobalSecIndexRecordType : uint8_t {
+  kCheckpointEnd = 2,
+  kCheckpointEntries = 4,
+  kDeltas = 5,
+};
+
+void PutDouble(std::string* dst, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  PutFixed64(dst, bits);
+}
+
+bool GetDouble(Slice* input, double* value) {
+  uint64_t bits;
+  if (!GetFixed64(input, &bits)) {
+    return false;
+  }
+  memcpy(value, &bits, sizeof(bits));
+  return true;
+}
+
+std::string EncodeDeltasRecord(const std::vector<GlobalSecIndexDelta>& deltas) {
+  std::string record;
+  record.push_back(static_cast<char>(kDeltas));
+  PutVarint32(&record, static_cast<uint32_t>(deltas.size()));
+  for (const auto& delta : deltas) {
+    delta.EncodeTo(&record);
+  }
+  return record;
+}
+
+struct GlobalSecIndexLogReporter : public log::Reader::Reporter {
+  Status* status;
+  void Corruption(size_t /*bytes*/, const Status& s) override {
+    if (status->ok()) {
+      *status = s;
+    }
+  }
+};
+
+}  // namespace
+
+std::string GlobalSecIndexFileName(const std::string& dir, uint64_t number) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "/%s%06" PRIu64, kGlobalSecIndexFilePrefix,
+           number);
+  return dir + buf;
+}
+
+void GlobalSecIndexDelta::EncodeTo(std::string* dst) const {
+  dst->push_back(static_cast<char>(op));
+  for (int i = 0; i < kGlobalSecIndexMaxDims; i++) {
+    PutDouble(dst, min[i]);
+    PutDouble(dst, max[i]);
+  }
+  PutVarint32(dst, static_cast<uint32_t>(value.id));
+  PutVarint64(dst, value.filenum);
+  PutVarint32(dst, value.count);
+}
+
+Status GlobalSecIndexDelta::DecodeFrom(Slice* input) {
+  if (input->empty()) {
+    return Status::Corruption("GlobalSecIndexDelta", "missing op");
+  }
+  const uint8_t raw_op = static_cast<uint8_t>((*input)[0]);
+  if (raw_op != kInsert && raw_op != kRemove) {
+    return Status::Corruption("GlobalSecIndexDelta", "unknown op");
+  }
+  op = static_cast<Op>(raw_op);
+  input->remove_prefix(1);
+  for (int i = 0; i < kGlobalSecIndexMaxDims; i++) {
+    if (!GetDouble(input, &min[i]) || !GetDouble(input, &max[i])) {
+      return Status::Corruption("GlobalSecIndexDelta", "bad rect");
+    }
+  }
+  uint32_t id = 0;
+  if (!GetVarint32(input, &id) || !GetVarint64(input, &value.filenum) ||
+      !GetVarint32(input, &value.count)) {
+    return Status::Corruption("GlobalSecIndexDelta", "bad value");
+  }
+  value.id = static_cast<int>(id);
+  return Status::OK();
+}
+
+GlobalSecIndexLog::GlobalSecIndexLog(const std::string& dir, FileSystem* fs,
+                                     const ImmutableDBOptions* db_options,
+                                     const FileOptions& file_options,
+                                     uint64_t checkpoint_interval)
+    : dir_(dir),
+      fs_(fs),
+      db_options_(db_options),
+      file_options_(file_options),
+      checkpoint_interval_(checkpoint_interval),
+      current_number_(0),
+      next_number_(1),
+      deltas_since_checkpoint_(0),
+      checkpoint_in_progress_(false),
+      checkpoint_number_(0),
+      checkpoint_entries_(0),
+      checkpoint_batch_count_(0) {}
+
+GlobalSecIndexLog::~GlobalSecIndexLog() {
+  if (writer_) {
+    writer_->Close().PermitUncheckedError();
+  }
+  if (checkpoint_writer_) {
+    checkpoint_writer_->Close().PermitUncheckedError();
+  }
+}
+
+IOStatus GlobalSecIndexLog::ListFileNumbers(std::vector<uint64_t>* numbers) {
+  std::vector<std::string> children;
+  IOStatus io_s = fs_->GetChildren(dir_, IOOptions(), &children, nullptr);
+  if (!io_s.ok()) {
+    return io_s;
+  }
+  const Slice prefix(kGlobalSecIndexFilePrefix);
+  for (const auto& child : children) {
+    Slice rest(child);
+    if (!rest.starts_with(prefix)) {
+      continue;
+    }
+    rest.remove_prefix(prefix.size());
+    uint64_t number = 0;
+    if (ConsumeDecimalNumber(&rest, &number) && rest.empty()) {
+      numbers->push_back(number);
+    }
+  }
+  std::sort(numbers->begin(), numbers->end(), std::greater<uint64_t>());
+  return io_s;
+}
+
+Status GlobalSecIndexLog::Recover(
+    const std::function<void()>& reset,
+    const std::function<void(const GlobalSecIndexDelta&)>& apply,
+    bool* found) {
+  assert(found);
+  *found = false;
+
+  std::vector<uint64_t> numbers;
+  Status s = fs_->CreateDirIfMissing(dir_, IOOptions(), nullptr);
+  if (s.ok()) {
+    s = ListFileNumbers(&numbers);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  if (!numbers.empty()) {
+    next_number_ = numbers.front() + 1;
+  }
+
+  // Newest first; a file without a checkpoint end marker was being written
+  // when the process died and its predecessor is still complete.
+  for (uint64_t number : numbers) {
+    bool complete = false;
+    s = ReplayFile(number, reset, apply, &complete);
+    if (!s.ok()) {
+      return s;
+    }
+    if (complete) {
+      *found = true;
+      ROCKS_LOG_INFO(db_options_->info_log,
+                     "Recovered global secondary index from %s\n",
+                     GlobalSecIndexFileName(dir_, number).c_str());
+      break;
+    }
+    ROCKS_LOG_WARN(db_options_->info_log,
+                   "Skipping incomplete global secondary index file %s\n",
+                   GlobalSecIndexFileName(dir_, number).c_str());
+  }
+  return Status::OK();
+}
+
+Status GlobalSecIndexLog::ReplayFile(
+    uint64_t number, const std::function<void()>& reset,
+    const std::function<void(const GlobalSecIndexDelta&)>& apply,
+    bool* complete) {
+  const std::string fname = GlobalSecIndexFileName(dir_, number);
+  std::unique_ptr<SequentialFileReader> file_reader;
+  {
+    std::unique_ptr<FSSequentialFile> file;
+    Status s = fs_->NewSequentialFile(fname, file_options_, &file, nullptr);
+    if (!s.ok()) {
+      return s;
+    }
+    file_reader.reset(new SequentialFileReader(
+        std::move(file), fname, db_options_->log_readahead_size));
+  }
+
+  Status read_status;
+  GlobalSecIndexLogReporter reporter;
+  reporter.status = &read_status;
+  log::Reader reader(nullptr, std::move(file_reader), &reporter,
+                     true /* checksum */, number);
+
+  // Checkpoint entries are staged until the end marker is seen so that an
+  // incomplete checkpoint never reaches the index.
+  std::vector<GlobalSecIndexDelta> staged;
+  Slice record;
+  std::string scratch;
+  uint64_t num_deltas = 0;
+  while (reader.ReadRecord(&record, &scratch) && read_status.ok()) {
+    if (record.empty()) {
+      break;
+    }
+    const uint8_t type = static_cast<uint8_t>(record[0]);
+    record.remove_prefix(1);
+    if (type == kCheckpointEnd) {
+      uint64_t total = 0;
+      if (*complete || !GetVarint64(&record, &total) ||
+          total != staged.size()) {
+        break;
+      }
+      reset();
+      for (const auto& entry : staged) {
+        apply(entry);
+      }
+      staged.clear();
+      staged.shrink_to_fit();
+      *complete = true;
+      continue;
+    }
+    if (type != kCheckpointEntries && type != kDeltas) {
+      break;
+    }
+    if ((type == kDeltas) != *complete) {
+      // Deltas before the checkpoint end marker or checkpoint entries after
+      // it mean the file is not one we wrote.
+      break;
+    }
+    uint32_t count = 0;
+    if (!GetVarint32(&record, &count)) {
+      break;
+    }
+    bool ok = true;
+    for (uint32_t i = 0; i < count; i++) {
+      GlobalSecIndexDelta delta;
+      if (!delta.DecodeFrom(&record).ok()) {
+        ok = false;
+        break;
+      }
+      if (type == kDeltas) {
+        apply(delta);
+        num_deltas++;
+      } else {
+        staged.emplace_back(delta);
+      }
+    }
+    if (!ok) {
+      break;
+    }
+  }
+
+  if (!read_status.ok()) {
+    // A torn tail is expected after a crash; everything before it has
+    // already been applied.
+    ROCKS_LOG_WARN(db_options_->info_log,
+                   "Global secondary index file %s: stopped replay at %s\n",
+                   fname.c_str(), read_status.ToString().c_str());
+  }
+  if (*complete) {
+    ROCKS_LOG_INFO(db_options_->info_log,
+                   "Global secondary index file %s: replayed %" PRIu64
+                   " deltas\n",
+                   fname.c_str(), num_deltas);
+  }
+  return Status::OK();
+}
+
+IOStatus GlobalSecIndexLog::AppendDeltas(
+    const std::vector<GlobalSecIndexDelta>& deltas, bool sync) {
+  if (deltas.empty()) {
+    return IOStatus::OK();
+  }
+  MutexLock l(&mutex_);
+  if (checkpoint_in_progress_) {
+    checkpoint_pending_.insert(checkpoint_pending_.end(), deltas.begin(),
+                               deltas.end());
+  }
+  if (writer_ == nullptr) {
+    return IOStatus::OK();
+  }
+  IOStatus io_s = writer_->AddRecord(EncodeDeltasRecord(deltas));
+  if (io_s.ok() && sync) {
+    io_s = writer_->file()->Sync(db_options_->use_fsync);
+  }
+  if (!io_s.ok()) {
+    // The file may now end in a torn record. Everything before it is still
+    // replayable, so stop writing to it and let the next checkpoint replace
+    // it; recovery reconciles whatever this batch would have changed.
+    ROCKS_LOG_ERROR(db_options_->info_log,
+                    "Abandoning global secondary index file %s: %s\n",
+                    GlobalSecIndexFileName(dir_, current_number_).c_str(),
+                    io_s.ToString().c_str());
+    writer_->Close().PermitUncheckedError();
+    writer_.reset();
+    return io_s;
+  }
+  deltas_since_checkpoint_ += deltas.size();
+  return io_s;
+}
+
+bool GlobalSecIndexLog::NeedsCheckpoint() {
+  MutexLock l(&mutex_);
+  return !checkpoint_in_progress_ &&
+         (writer_ == nullptr ||
+          deltas_since_checkpoint_ >= checkpoint_interval_);
+}
+
+IOStatus GlobalSecIndexLog::BeginCheckpoint() {
+  if (checkpoint_writer_) {
+    // A previous checkpoint failed before it was finished
+    AbortCheckpoint();
+  }
+  IOStatus io_s = fs_->CreateDirIfMissing(dir_, IOOptions(), nullptr);
+  if (!io_s.ok()) {
+    return io_s;
+  }
+  {
+    MutexLock l(&mutex_);
+    checkpoint_number_ = next_number_++;
+  }
+  checkpoint_entries_ = 0;
+  checkpoint_batch_count_ = 0;
+  checkpoint_batch_.clear();
+
+  const std::string fname = GlobalSecIndexFileName(dir_, checkpoint_number_);
+  std::unique_ptr<FSWritableFile> file;
+  io_s = NewWritableFile(fs_, fname, &file, file_options_);
+  if (!io_s.ok()) {
+    return io_s;
+  }
+  std::unique_ptr<WritableFileWriter> file_writer(
+      new WritableFileWriter(std::move(file), fname, file_options_,
+                             db_options_->clock, nullptr /* io_tracer */,
+                             nullptr /* stats */, db_options_->listeners));
+  checkpoint_writer_.reset(
+      new log::Writer(std::move(file_writer), checkpoint_number_, false));
+
+  MutexLock l(&mutex_);
+  checkpoint_in_progress_ = true;
+  checkpoint_pending_.clear();
+  return io_s;
+}
+
+void GlobalSecIndexLog::AbortCheckpoint() {
+  // The partial checkpoint is skipped on recovery because it lacks an end
+  // marker, and deleted by the next successful one.
+  if (checkpoint_writer_) {
+    checkpoint_writer_->Close().PermitUncheckedError();
+    checkpoint_writer_.reset();
+  }
+  MutexLock l(&mutex_);
+  checkpoint_in_progress_ = false;
+  checkpoint_pending_.clear();
+  checkpoint_pending_.shrink_to_fit();
+}
+
+IOStatus GlobalSecIndexLog::FlushCheckpointBatch() {
+  if (checkpoint_batch_count_ == 0) {
+    return IOStatus::OK();
+  }
+  std::string record;
+  record.reserve(checkpoint_batch_.size() + 6);
+  record.push_back(static_cast<char>(kCheckpointEntries));
+  PutVarint32(&record, checkpoint_batch_count_);
+  record.append(checkpoint_batch_);
+  checkpoint_batch_.clear();
+  checkpoint_batch_count_ = 0;
+  return checkpoint_writer_->AddRecord(record);
+}
+
+IOStatus GlobalSecIndexLog::AddCheckpointEntry(
+    const GlobalSecIndexDelta& entry) {
+  assert(checkpoint_writer_ != nullptr);
+  assert(entry.op == GlobalSecIndexDelta::kInsert);
+  entry.EncodeTo(&checkpoint_batch_);
+  checkpoint_batch_count_++;
+  checkpoint_entries_++;
+  if (checkpoint_batch_count_ >= kCheckpointEntriesPerRecord) {
+    return FlushCheckpointBatch();
+  }
+  return IOStatus::OK();
+}
+
+IOStatus GlobalSecIndexLog::SyncDir() {
+  std::unique_ptr<FSDirectory> dir;
+  IOStatus io_s = fs_->NewDirectory(dir_, IOOptions(), &dir, nullptr);
+  if (io_s.ok()) {
+    io_s = dir->FsyncWithDirOptions(
+        IOOptions(), nullptr,
+        DirFsyncOptions(DirFsyncOptions::FsyncReason::kNewFileSynced));
+  }
+  if (io_s.ok()) {
+    io_s = dir->Close(IOOptions(), nullptr);
+  }
+  return io_s;
+}
+
+IOStatus GlobalSecIndexLog::FinishCheckpoint() {
+  assert(checkpoint_writer_ != nullptr);
+  IOStatus io_s = FlushCheckpointBatch();
+  if (io_s.ok()) {
+    std::string record;
+    record.push_back(static_cast<char>(kCheckpointEnd));
+    PutVarint64(&record, checkpoint_entries_);
+    io_s = checkpoint_writer_->AddRecord(record);
+  }
+  if (io_s.ok()) {
+    io_s = checkpoint_writer_->file()->Sync(db_options_->use_fsync);
+  }
+  if (!io_s.ok()) {
+    AbortCheckpoint();
+    return io_s;
+  }
+
+  const uint64_t number = checkpoint_number_;
+  {
+    // Deltas appended while the checkpoint was written follow it in the new
+    // file; from here on they go to the new file only.
+    MutexLock l(&mutex_);
+    uint64_t num_pending = checkpoint_pending_.size();
+    if (num_pending > 0) {
+      io_s = checkpoint_writer_->AddRecord(
+          EncodeDeltasRecord(checkpoint_pending_));
+      if (io_s.ok()) {
+        io_s = checkpoint_writer_->file()->Sync(db_options_->use_fsync);
+      }
+    }
+    checkpoint_in_progress_ = false;
+    checkpoint_pending_.clear();
+    checkpoint_pending_.shrink_to_fit();
+    if (!io_s.ok()) {
+      checkpoint_writer_->Close().PermitUncheckedError();
+      checkpoint_writer_.reset();
+      return io_s;
+    }
+    if (writer_) {
+      writer_->Close().PermitUncheckedError();
+    }
+    writer_ = std::move(checkpoint_writer_);
+    current_number_ = number;
+    deltas_since_checkpoint_ = num_pending;
+  }
+
+  // Older files are fully covered by the new checkpoint, but may only go
+  // once the new file is guaranteed to be found after a crash.
+  io_s = SyncDir();
+  if (!io_s.ok()) {
+    ROCKS_LOG_WARN(db_options_->info_log,
+                   "Keeping obsolete global secondary index files, failed to "
+                   "sync %s: %s\n",
+                   dir_.c_str(), io_s.ToString().c_str());
+    return io_s;
+  }
+  std::vector<uint64_t> numbers;
+  if (ListFileNumbers(&numbers).ok()) {
+    for (uint64_t n : numbers) {
+      if (n < number) {
+        const std::string fname = GlobalSecIndexFileName(dir_, n);
+        IOStatus del = fs_->DeleteFile(fname, IOOptions(), nullptr);
+        if (!del.ok()) {
+          ROCKS_LOG_WARN(db_options_->info_log,
+                         "Failed to delete obsolete %s: %s\n", fname.c_str(),
+                         del.ToString().c_str());
+        }
+      }
+    }
+  }
+  return IOStatus::OK();
+}
+
+}  // namespace ROCKSDB_NAMESPACE
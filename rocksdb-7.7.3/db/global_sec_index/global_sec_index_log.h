@@ -0,0 +1,147 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// Persistence for the in-RAM global secondary index.
+//
+// The global index is kept durable with a MANIFEST-like scheme: every
+// GLOBALSECINDEX-<number> file starts with a compacted checkpoint of the
+// whole index (closed by an end marker) and is followed by the deltas
+// produced by VersionBuilder::Apply. Insertions are written ahead of the
+// MANIFEST record that installs the corresponding files and removals only
+// after it has been synced, so after a crash the index can at worst contain
+// extra entries of files the MANIFEST does not know about; those are dropped
+// when the index is reconciled against the recovered versions. A file that
+// could not be written to is abandoned until the next checkpoint; the
+// reconciliation then also rebuilds entries the lost deltas would have added.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/log_writer.h"
+#include "options/db_options.h"
+#include "port/port.h"
+#include "rocksdb/file_system.h"
+#include "rocksdb/status.h"
+#include "util/rtree.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// The global index stores at most two dimensions (Rect / Rect1D)
+constexpr int kGlobalSecIndexMaxDims = 2;
+
+// One change made to the global secondary index. Checkpoint records reuse
+// the same layout with op == kInsert.
+struct GlobalSecIndexDelta {
+  enum Op : uint8_t {
+    kInsert = 1,
+    kRemove = 2,
+  };
+
+  Op op = kInsert;
+  double min[kGlobalSecIndexMaxDims] = {0, 0};
+  double max[kGlobalSecIndexMaxDims] = {0, 0};
+  GlobalSecIndexValue value;
+
+  GlobalSecIndexDelta() {}
+  GlobalSecIndexDelta(Op _op, const double* _min, const double* _max,
+                      int num_dims, const GlobalSecIndexValue& _value)
+      : op(_op), value(_value) {
+    for (int i = 0; i < num_dims && i < kGlobalSecIndexMaxDims; i++) {
+      min[i] = _min[i];
+      max[i] = _max[i];
+    }
+  }
+
+  void EncodeTo(std::string* dst) const;
+  Status DecodeFrom(Slice* input);
+};
+
+class GlobalSecIndexLog {
+ public:
+  GlobalSecIndexLog(const std::string& dir, FileSystem* fs,
+                    const ImmutableDBOptions* db_options,
+                    const FileOptions& file_options,
+                    uint64_t checkpoint_interval);
+  ~GlobalSecIndexLog();
+
+  // No copying allowed
+  GlobalSecIndexLog(const GlobalSecIndexLog&) = delete;
+  void operator=(const GlobalSecIndexLog&) = delete;
+
+  // Replays the newest complete checkpoint and the deltas following it.
+  // `reset` is invoked right before the checkpoint entries are applied;
+  // files without a complete checkpoint are skipped without side effects.
+  // *found is set to false if no usable file exists in the directory.
+  Status Recover(const std::function<void()>& reset,
+                 const std::function<void(const GlobalSecIndexDelta&)>& apply,
+                 bool* found);
+
+  // Appends a batch of deltas to the current file. A no-op before the first
+  // checkpoint has been written (e.g. for read-only instances) and after a
+  // failed append, which closes the current file so that NeedsCheckpoint()
+  // turns true. Deltas appended while a checkpoint is in progress are also
+  // queued for the new file.
+  IOStatus AppendDeltas(const std::vector<GlobalSecIndexDelta>& deltas,
+                        bool sync);
+
+  // True if there is no writable file or enough deltas were appended that
+  // replaying them costs more than writing a fresh checkpoint. False while a
+  // checkpoint is in progress.
+  bool NeedsCheckpoint();
+
+  // A checkpoint is written in three steps: BeginCheckpoint() creates a new
+  // file, AddCheckpointEntry() is called once per entry of the index as of
+  // BeginCheckpoint() and FinishCheckpoint() seals the file, appends the
+  // deltas queued meanwhile, switches further deltas to it and deletes all
+  // older files. The last two steps may run on a background thread,
+  // concurrently with AppendDeltas(). AbortCheckpoint() gives up a checkpoint
+  // whose entries could not be written; FinishCheckpoint() does so itself.
+  IOStatus BeginCheckpoint();
+  IOStatus AddCheckpointEntry(const GlobalSecIndexDelta& entry);
+  IOStatus FinishCheckpoint();
+  void AbortCheckpoint();
+
+  const std::string& dir() const { return dir_; }
+
+ private:
+  IOStatus FlushCheckpointBatch();
+  IOStatus SyncDir();
+  IOStatus ListFileNumbers(std::vector<uint64_t>* numbers);
+  Status ReplayFile(uint64_t number,
+                    const std::function<void()>& reset,
+                    const std::function<void(const GlobalSecIndexDelta&)>& apply,
+                    bool* complete);
+
+  const std::string dir_;
+  FileSystem* fs_;
+  const ImmutableDBOptions* db_options_;
+  const FileOptions file_options_;
+  const uint64_t checkpoint_interval_;
+
+  // Protects the current file and the deltas queued for a checkpoint
+  port::Mutex mutex_;
+  std::unique_ptr<log::Writer> writer_;
+  uint64_t current_number_;
+  uint64_t next_number_;
+  uint64_t deltas_since_checkpoint_;
+  bool checkpoint_in_progress_;
+  std::vector<GlobalSecIndexDelta> checkpoint_pending_;
+
+  // State of a checkpoint in progress, owned by the thread writing it
+  std::unique_ptr<log::Writer> checkpoint_writer_;
+  uint64_t checkpoint_number_;
+  uint64_t checkpoint_entries_;
+  uint32_t checkpoint_batch_count_;
+  std::string checkpoint_batch_;
+};
+
+extern std::string GlobalSecIndexFileName(const std::string& dir,
+                                          uint64_t number);
+
+}  // namespace ROCKSDB_NAMESPACE
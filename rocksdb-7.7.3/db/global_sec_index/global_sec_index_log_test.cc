@@ -0,0 +1,285 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/global_sec_index/global_sec_index_log.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file/file_util.h"
+#include "port/stack_trace.h"
+#include "rocksdb/env.h"
+#include "test_util/testharness.h"
+#include "test_util/testutil.h"
+#include "utilities/fault_injection_fs.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class GlobalSecIndexLogTest : public testing::Test {
+ public:
+  GlobalSecIndexLogTest()
+      : env_(Env::Default()),
+        fs_(std::make_shared<FaultInjectionTestFS>(env_->GetFileSystem())),
+        dir_(test::PerThreadDBPath(env_, "global_sec_index_log_test")),
+        db_options_(DBOptions()) {
+    EXPECT_OK(DestroyDir(env_, dir_));
+    EXPECT_OK(env_->CreateDirIfMissing(dir_));
+  }
+
+  ~GlobalSecIndexLogTest() override {
+    log_.reset();
+    EXPECT_OK(DestroyDir(env_, dir_));
+  }
+
+  void Open(uint64_t checkpoint_interval = 100) {
+    log_.reset(new GlobalSecIndexLog(dir_, fs_.get(), &db_options_,
+                                     FileOptions(), checkpoint_interval));
+  }
+
+  static GlobalSecIndexDelta Delta(GlobalSecIndexDelta::Op op, double lo,
+                                   double hi, uint64_t filenum, int id) {
+    return GlobalSecIndexDelta(op, &lo, &hi, 1,
+                               GlobalSecIndexValue(id, filenum));
+  }
+
+  void WriteCheckpoint(const std::vector<GlobalSecIndexDelta>& entries) {
+    ASSERT_OK(log_->BeginCheckpoint());
+    for (const auto& entry : entries) {
+      ASSERT_OK(log_->AddCheckpointEntry(entry));
+    }
+    ASSERT_OK(log_->FinishCheckpoint());
+  }
+
+  // Recovers with a fresh log and returns what was applied after the last
+  // reset.
+  std::vector<GlobalSecIndexDelta> Recover(bool* found) {
+    Open();
+    std::vector<GlobalSecIndexDelta> applied;
+    EXPECT_OK(log_->Recover(
+        [&]() { applied.clear(); },
+        [&](const GlobalSecIndexDelta& delta) { applied.push_back(delta); },
+        found));
+    return applied;
+  }
+
+  std::vector<std::string> LogFiles() {
+    std::vector<std::string> children;
+    EXPECT_OK(env_->GetChildren(dir_, &children));
+    std::vector<std::string> files;
+    for (const auto& child : children) {
+      if (child.find("GLOBALSECINDEX-") == 0) {
+        files.push_back(child);
+      }
+    }
+    return files;
+  }
+
+  static void AssertSame(const std::vector<GlobalSecIndexDelta>& expected,
+                         const std::vector<GlobalSecIndexDelta>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_EQ(expected[i].op, actual[i].op);
+      ASSERT_EQ(expected[i].min[0], actual[i].min[0]);
+      ASSERT_EQ(expected[i].max[0], actual[i].max[0]);
+      ASSERT_TRUE(expected[i].value == actual[i].value);
+    }
+  }
+
+  Env* env_;
+  std::shared_ptr<FaultInjectionTestFS> fs_;
+  std::string dir_;
+  ImmutableDBOptions db_options_;
+  std::unique_ptr<GlobalSecIndexLog> log_;
+};
+
+TEST_F(GlobalSecIndexLogTest, DeltaEncodeDecode) {
+  GlobalSecIndexDelta delta = Delta(GlobalSecIndexDelta::kRemove, -1.5, 2.25,
+                                    1ull << 40, 12345);
+  delta.value.count = 7;
+  std::string encoded;
+  delta.EncodeTo(&encoded);
+
+  Slice input(encoded);
+  GlobalSecIndexDelta decoded;
+  ASSERT_OK(decoded.DecodeFrom(&input));
+  ASSERT_TRUE(input.empty());
+  AssertSame({delta}, {decoded});
+
+  Slice truncated(encoded.data(), encoded.size() - 1);
+  ASSERT_TRUE(decoded.DecodeFrom(&truncated).IsCorruption());
+}
+
+TEST_F(GlobalSecIndexLogTest, DeltasFollowCheckpoint) {
+  Open();
+  bool found = true;
+  ASSERT_OK(log_->Recover([]() {}, [](const GlobalSecIndexDelta&) {}, &found));
+  ASSERT_FALSE(found);
+  ASSERT_TRUE(log_->NeedsCheckpoint());
+
+  // Nothing is written before the first checkpoint
+  ASSERT_OK(log_->AppendDeltas(
+      {Delta(GlobalSecIndexDelta::kInsert, 0, 1, 5, 0)}, true));
+  ASSERT_TRUE(LogFiles().empty());
+
+  std::vector<GlobalSecIndexDelta> expected = {
+      Delta(GlobalSecIndexDelta::kInsert, 0, 1, 1, 0),
+      Delta(GlobalSecIndexDelta::kInsert, 2, 3, 1, 1)};
+  WriteCheckpoint(expected);
+  ASSERT_FALSE(log_->NeedsCheckpoint());
+
+  std::vector<GlobalSecIndexDelta> batch = {
+      Delta(GlobalSecIndexDelta::kInsert, 4, 5, 2, 0),
+      Delta(GlobalSecIndexDelta::kRemove, 0, 1, 1, 0)};
+  ASSERT_OK(log_->AppendDeltas(batch, true));
+  expected.insert(expected.end(), batch.begin(), batch.end());
+
+  std::vector<GlobalSecIndexDelta> applied = Recover(&found);
+  ASSERT_TRUE(found);
+  AssertSame(expected, applied);
+}
+
+TEST_F(GlobalSecIndexLogTest, CheckpointRollover) {
+  Open(2 /* checkpoint_interval */);
+  WriteCheckpoint({Delta(GlobalSecIndexDelta::kInsert, 0, 1, 1, 0)});
+  ASSERT_OK(log_->AppendDeltas(
+      {Delta(GlobalSecIndexDelta::kInsert, 1, 2, 2, 0),
+       Delta(GlobalSecIndexDelta::kInsert, 2, 3, 3, 0)},
+      true));
+  ASSERT_TRUE(log_->NeedsCheckpoint());
+
+  std::vector<GlobalSecIndexDelta> entries = {
+      Delta(GlobalSecIndexDelta::kInsert, 0, 1, 1, 0),
+      Delta(GlobalSecIndexDelta::kInsert, 1, 2, 2, 0),
+      Delta(GlobalSecIndexDelta::kInsert, 2, 3, 3, 0)};
+  ASSERT_OK(log_->BeginCheckpoint());
+  ASSERT_FALSE(log_->NeedsCheckpoint());
+  // Appended while the checkpoint is written: go to the old file and are
+  // queued for the new one
+  std::vector<GlobalSecIndexDelta> concurrent = {
+      Delta(GlobalSecIndexDelta::kRemove, 0, 1, 1, 0)};
+  ASSERT_OK(log_->AppendDeltas(concurrent, true));
+  ASSERT_EQ(2, LogFiles().size());
+  for (const auto& entry : entries) {
+    ASSERT_OK(log_->AddCheckpointEntry(entry));
+  }
+  ASSERT_OK(log_->FinishCheckpoint());
+  ASSERT_EQ(1, LogFiles().size());
+  ASSERT_FALSE(log_->NeedsCheckpoint());
+
+  std::vector<GlobalSecIndexDelta> after = {
+      Delta(GlobalSecIndexDelta::kInsert, 3, 4, 4, 0)};
+  ASSERT_OK(log_->AppendDeltas(after, true));
+
+  std::vector<GlobalSecIndexDelta> expected = entries;
+  expected.insert(expected.end(), concurrent.begin(), concurrent.end());
+  expected.insert(expected.end(), after.begin(), after.end());
+  bool found = false;
+  AssertSame(expected, Recover(&found));
+  ASSERT_TRUE(found);
+}
+
+TEST_F(GlobalSecIndexLogTest, IncompleteCheckpointFallsBack) {
+  Open();
+  std::vector<GlobalSecIndexDelta> expected = {
+      Delta(GlobalSecIndexDelta::kInsert, 0, 1, 1, 0)};
+  WriteCheckpoint(expected);
+  ASSERT_OK(log_->AppendDeltas(
+      {Delta(GlobalSecIndexDelta::kInsert, 1, 2, 2, 0)}, true));
+  expected.push_back(Delta(GlobalSecIndexDelta::kInsert, 1, 2, 2, 0));
+
+  // Crash while a checkpoint is written
+  ASSERT_OK(log_->BeginCheckpoint());
+  ASSERT_OK(log_->AddCheckpointEntry(
+      Delta(GlobalSecIndexDelta::kInsert, 9, 9, 9, 0)));
+  ASSERT_EQ(2, LogFiles().size());
+
+  bool found = false;
+  AssertSame(expected, Recover(&found));
+  ASSERT_TRUE(found);
+}
+
+TEST_F(GlobalSecIndexLogTest, TruncatedTail) {
+  Open();
+  std::vector<GlobalSecIndexDelta> expected = {
+      Delta(GlobalSecIndexDelta::kInsert, 0, 1, 1, 0)};
+  WriteCheckpoint(expected);
+  std::vector<GlobalSecIndexDelta> batch = {
+      Delta(GlobalSecIndexDelta::kInsert, 1, 2, 2, 0)};
+  ASSERT_OK(log_->AppendDeltas(batch, true));
+  expected.insert(expected.end(), batch.begin(), batch.end());
+  ASSERT_OK(log_->AppendDeltas(
+      {Delta(GlobalSecIndexDelta::kInsert, 2, 3, 3, 0)}, true));
+  log_.reset();
+
+  // Tear the last record
+  std::vector<std::string> files = LogFiles();
+  ASSERT_EQ(1, files.size());
+  const std::string fname = dir_ + "/" + files[0];
+  uint64_t size = 0;
+  ASSERT_OK(env_->GetFileSize(fname, &size));
+  ASSERT_OK(test::TruncateFile(env_, fname, size - 3));
+
+  bool found = false;
+  AssertSame(expected, Recover(&found));
+  ASSERT_TRUE(found);
+}
+
+TEST_F(GlobalSecIndexLogTest, Reopen) {
+  Open();
+  WriteCheckpoint({Delta(GlobalSecIndexDelta::kInsert, 0, 1, 1, 0)});
+  ASSERT_OK(log_->AppendDeltas(
+      {Delta(GlobalSecIndexDelta::kInsert, 1, 2, 2, 0)}, true));
+
+  // A reopened log writes nothing until it has checkpointed what it
+  // recovered, and then continues with a higher file number
+  bool found = false;
+  std::vector<GlobalSecIndexDelta> recovered = Recover(&found);
+  ASSERT_TRUE(found);
+  ASSERT_EQ(2, recovered.size());
+  ASSERT_TRUE(log_->NeedsCheckpoint());
+  ASSERT_OK(log_->AppendDeltas(
+      {Delta(GlobalSecIndexDelta::kInsert, 9, 9, 9, 0)}, true));
+  const std::vector<std::string> before = LogFiles();
+  ASSERT_EQ(1, before.size());
+
+  WriteCheckpoint(recovered);
+  std::vector<GlobalSecIndexDelta> expected = recovered;
+  expected.push_back(Delta(GlobalSecIndexDelta::kRemove, 0, 1, 1, 0));
+  ASSERT_OK(log_->AppendDeltas({expected.back()}, true));
+  const std::vector<std::string> after = LogFiles();
+  ASSERT_EQ(1, after.size());
+  ASSERT_GT(after[0], before[0]);
+
+  AssertSame(expected, Recover(&found));
+  ASSERT_TRUE(found);
+}
+
+TEST_F(GlobalSecIndexLogTest, FailedAppendNeedsCheckpoint) {
+  Open();
+  std::vector<GlobalSecIndexDelta> expected = {
+      Delta(GlobalSecIndexDelta::kInsert, 0, 1, 1, 0)};
+  WriteCheckpoint(expected);
+
+  fs_->SetFilesystemActive(false, IOStatus::IOError("injected"));
+  ASSERT_NOK(log_->AppendDeltas(
+      {Delta(GlobalSecIndexDelta::kInsert, 1, 2, 2, 0)}, true));
+  fs_->SetFilesystemActive(true);
+  ASSERT_TRUE(log_->NeedsCheckpoint());
+  // The abandoned file is not written to anymore
+  ASSERT_OK(log_->AppendDeltas(
+      {Delta(GlobalSecIndexDelta::kInsert, 2, 3, 3, 0)}, true));
+  bool found = false;
+  AssertSame(expected, Recover(&found));
+  ASSERT_TRUE(found);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -310,6 +310,9 @@ static const std::string live_blob_file_garbage_size =
 static const std::string blob_cache_capacity = "blob-cache-capacity";
 static const std::string blob_cache_usage = "blob-cache-usage";
 static const std::string blob_cache_pinned_usage = "blob-cache-pinned-usage";
+static const std::string global_sec_index_bytes = "global-sec-index-bytes";
+static const std::string global_sec_index_entries = "global-sec-index-entries";
+static const std::string global_sec_index_height = "global-sec-index-height";
 
 const std::string DB::Properties::kNumFilesAtLevelPrefix =
     rocksdb_prefix + num_files_at_level_prefix;
@@ -418,6 +421,12 @@ const std::string DB::Properties::kBlobCacheUsage =
     rocksdb_prefix + blob_cache_usage;
 const std::string DB::Properties::kBlobCachePinnedUsage =
     rocksdb_prefix + blob_cache_pinned_usage;
+const std::string DB::Properties::kGlobalSecIndexBytes =
+    rocksdb_prefix + global_sec_index_bytes;
+const std::string DB::Properties::kGlobalSecIndexEntries =
+    rocksdb_prefix + global_sec_index_entries;
+const std::string DB::Properties::kGlobalSecIndexHeight =
+    rocksdb_prefix + global_sec_index_height;
 
 const UnorderedMap<std::string, DBPropertyInfo>
     InternalStats::ppt_name_to_info = {
@@ -588,6 +597,15 @@ const UnorderedMap<std::string, DBPropertyInfo>
         {DB::Properties::kBlobCachePinnedUsage,
          {false, nullptr, &InternalStats::HandleBlobCachePinnedUsage, nullptr,
           nullptr}},
+        {DB::Properties::kGlobalSecIndexBytes,
+         {false, nullptr, &InternalStats::HandleGlobalSecIndexBytes, nullptr,
+          nullptr}},
+        {DB::Properties::kGlobalSecIndexEntries,
+         {false, nullptr, &InternalStats::HandleGlobalSecIndexEntries, nullptr,
+          nullptr}},
+        {DB::Properties::kGlobalSecIndexHeight,
+         {false, nullptr, &InternalStats::HandleGlobalSecIndexHeight, nullptr,
+          nullptr}},
 };
 
 InternalStats::InternalStats(int num_levels, SystemClock* clock,
@@ -904,6 +922,45 @@ bool InternalStats::HandleBlobCachePinnedUsage(uint64_t* value, DBImpl* /*db*/,
   return false;
 }
 
+// The global secondary index is shared by all column families; every
+// version pins the snapshot matching its files.
+static const Version::GlobalSecRtree* GetGlobalSecIndexForStats(
+    ColumnFamilyData* cfd) {
+  const auto* current = cfd->current();
+  return current != nullptr ? current->global_rtree_.get() : nullptr;
+}
+
+bool InternalStats::HandleGlobalSecIndexBytes(uint64_t* value, DBImpl* /*db*/,
+                                              Version* /*version*/) {
+  const Version::GlobalSecRtree* rtree = GetGlobalSecIndexForStats(cfd_);
+  if (rtree) {
+    *value = static_cast<uint64_t>(rtree->NodeMemoryUsage());
+    return true;
+  }
+  return false;
+}
+
+bool InternalStats::HandleGlobalSecIndexEntries(uint64_t* value,
+                                                DBImpl* /*db*/,
+                                                Version* /*version*/) {
+  const Version::GlobalSecRtree* rtree = GetGlobalSecIndexForStats(cfd_);
+  if (rtree) {
+    *value = static_cast<uint64_t>(rtree->Size());
+    return true;
+  }
+  return false;
+}
+
+bool InternalStats::HandleGlobalSecIndexHeight(uint64_t* value, DBImpl* /*db*/,
+                                               Version* /*version*/) {
+  const Version::GlobalSecRtree* rtree = GetGlobalSecIndexForStats(cfd_);
+  if (rtree) {
+    *value = static_cast<uint64_t>(rtree->Height());
+    return true;
+  }
+  return false;
+}
+
 const DBPropertyInfo* GetPropertyInfo(const Slice& property) {
   std::string ppt_name = GetPropertyNameAndArg(property).first.ToString();
   auto ppt_info_iter = InternalStats::ppt_name_to_info.find(ppt_name);
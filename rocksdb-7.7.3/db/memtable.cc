@@ -111,6 +111,7 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
       prefix_extractor_(mutable_cf_options.prefix_extractor.get()),
       flush_state_(FLUSH_NOT_REQUESTED),
       clock_(ioptions.clock),
+      env_(ioptions.env),
       insert_with_hint_prefix_extractor_(
           ioptions.memtable_insert_with_hint_prefix_extractor.get()),
       oldest_key_time_(std::numeric_limits<uint64_t>::max()),
@@ -1392,7 +1393,9 @@ void MemTable::MultiGet(const ReadOptions& read_options, MultiGetRange* range,
     GetFromTable(*(iter->lkey), iter->max_covering_tombstone_seq, true,
                  callback, &iter->is_blob_index, iter->value->GetSelf(),
                  /*columns=*/nullptr, iter->timestamp, iter->s,
-                 &(iter->merge_context), &dummy_seq, &found_final_value,
+                 &(iter->merge_context),
+                 iter->seq != nullptr ? iter->seq : &dummy_seq,
+                 &found_final_value,
                  &merge_in_progress);
 
     if (!found_final_value && merge_in_progress) {
@@ -462,6 +462,7 @@ class MemTable {
   // write anything to this MemTable().  (Ie. do not call Add() or Update()).
   void MarkImmutable() {
     table_->MarkReadOnly();
+    table_->ScheduleReadOnlyWork(env_);
     mem_tracker_.DoneAllocating();
   }
 
@@ -616,6 +617,7 @@ class MemTable {
   std::atomic<FlushStateEnum> flush_state_;
 
   SystemClock* clock_;
+  Env* env_;
 
   // Extract sequential insert prefixes.
   const SliceTransform* insert_with_hint_prefix_extractor_;
@@ -210,6 +210,21 @@ Status MemTableListVersion::AddRangeTombstoneIterators(
   return Status::OK();
 }
 
+void MemTableListVersion::AddRangeTombstoneIterators(
+    const ReadOptions& read_opts, SequenceNumber read_seq,
+    std::vector<std::unique_ptr<FragmentedRangeTombstoneIterator>>*
+        range_tombstones) {
+  for (auto& m : memlist_) {
+    assert(m->IsFragmentedRangeTombstonesConstructed());
+    std::unique_ptr<FragmentedRangeTombstoneIterator> range_del_iter(
+        m->NewRangeTombstoneIterator(read_opts, read_seq,
+                                     true /* immutable_memtable */));
+    if (range_del_iter != nullptr && !range_del_iter->empty()) {
+      range_tombstones->push_back(std::move(range_del_iter));
+    }
+  }
+}
+
 void MemTableListVersion::AddIterators(
     const ReadOptions& options, std::vector<InternalIterator*>* iterator_list,
     Arena* arena) {
@@ -111,6 +111,13 @@ class MemTableListVersion {
   Status AddRangeTombstoneIterators(const ReadOptions& read_opts, Arena* arena,
                                     RangeDelAggregator* range_del_agg);
 
+  // Appends the non-empty range tombstone iterators of the memtables, for
+  // readers that look up tombstones by key instead of merging them
+  void AddRangeTombstoneIterators(
+      const ReadOptions& read_opts, SequenceNumber read_seq,
+      std::vector<std::unique_ptr<FragmentedRangeTombstoneIterator>>*
+          range_tombstones);
+
   void AddIterators(const ReadOptions& options,
                     std::vector<InternalIterator*>* iterator_list,
                     Arena* arena);
@@ -0,0 +1,186 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/secondary_query_iterator.h"
+
+#include "table/internal_iterator.h"
+#include "table/multiget_context.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+SecondaryQueryIterator::SecondaryQueryIterator(const ReadOptions& read_options,
+                                               const Slice& query,
+                                               SequenceNumber sequence)
+    : read_options_(read_options), sequence_(sequence) {
+  context_.query_mbr = query.ToString();
+  read_options_.iterator_context = &context_;
+  read_options_.is_secondary_index_scan = true;
+}
+
+SecondaryQueryIterator::~SecondaryQueryIterator() {
+  // The sources are in the arena
+  for (InternalIterator* child : children_) {
+    child->~InternalIterator();
+  }
+}
+
+void SecondaryQueryIterator::SeekToFirst() {
+  status_ = Status::OK();
+  current_ = 0;
+  batch_size_ = 0;
+  batch_pos_ = 0;
+  source_valid_ = false;
+  for (size_t c = 0; c < children_.size(); c++) {
+    int n = 0;
+    for (children_[c]->SeekToFirst(); children_[c]->Valid(); children_[c]->Next()) n++;
+    fprintf(stderr, "DBG child %d: %d %s\n", (int)c, n, children_[c]->status().ToString().c_str());
+  }
+  if (!children_.empty()) {
+    children_[0]->SeekToFirst();
+    FindVisibleEntry();
+  }
+  if (validator_) {
+    FindCurrentCandidate();
+  } else {
+    valid_ = source_valid_;
+  }
+}
+
+void SecondaryQueryIterator::Next() {
+  assert(valid_);
+  if (validator_) {
+    batch_pos_++;
+    FindCurrentCandidate();
+  } else {
+    children_[current_]->Next();
+    FindVisibleEntry();
+    valid_ = source_valid_;
+  }
+}
+
+void SecondaryQueryIterator::FindVisibleEntry() {
+  source_valid_ = false;
+  while (current_ < children_.size()) {
+    InternalIterator* iter = children_[current_];
+    for (; iter->Valid(); iter->Next()) {
+      Status s = ParseInternalKey(iter->key(), &parsed_,
+                                  false /* log_err_key */);
+      if (!s.ok()) {
+        status_ = s;
+        return;
+      }
+      if (parsed_.sequence > sequence_) {
+        continue;
+      }
+      switch (parsed_.type) {
+        case kTypeValue:
+          if (!IsCoveredByRangeTombstone()) {
+            source_valid_ = true;
+            return;
+          }
+          break;
+        case kTypeDeletion:
+        case kTypeSingleDeletion:
+        case kTypeDeletionWithTimestamp:
+          break;
+        default:
+          status_ = Status::NotSupported(
+              "Secondary index iterator only supports values and deletions");
+          return;
+      }
+    }
+    if (!iter->status().ok()) {
+      status_ = iter->status();
+      return;
+    }
+    if (++current_ < children_.size()) {
+      children_[current_]->SeekToFirst();
+    }
+  }
+}
+
+bool SecondaryQueryIterator::IsCoveredByRangeTombstone() {
+  for (auto& tombstones : range_tombstones_) {
+    if (tombstones->MaxCoveringTombstoneSeqnum(parsed_.user_key) >
+        parsed_.sequence) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SecondaryQueryIterator::FindCurrentCandidate() {
+  valid_ = false;
+  while (status_.ok()) {
+    for (; batch_pos_ < batch_size_; batch_pos_++) {
+      if (batch_[batch_pos_].current) {
+        valid_ = true;
+        return;
+      }
+    }
+    if (!source_valid_) {
+      return;
+    }
+    ReadAndValidateBatch();
+  }
+}
+
+void SecondaryQueryIterator::ReadAndValidateBatch() {
+  // One batch fills a MultiGet batch, so that its keys are looked up together
+  // and each table file is probed once per batch
+  const size_t max_batch_size = MultiGetContext::MAX_BATCH_SIZE;
+  batch_size_ = 0;
+  batch_pos_ = 0;
+  while (source_valid_ && batch_size_ < max_batch_size) {
+    if (batch_size_ == batch_.size()) {
+      batch_.emplace_back();
+    }
+    Candidate& candidate = batch_[batch_size_++];
+    candidate.key.assign(parsed_.user_key.data(), parsed_.user_key.size());
+    const Slice value = children_[current_]->value();
+    candidate.value.assign(value.data(), value.size());
+    candidate.sequence = parsed_.sequence;
+    children_[current_]->Next();
+    FindVisibleEntry();
+  }
+  if (!status_.ok()) {
+    batch_size_ = 0;
+    return;
+  }
+
+  batch_keys_.resize(batch_size_);
+  batch_values_.resize(batch_size_);
+  batch_statuses_.resize(batch_size_);
+  batch_seqs_.resize(batch_size_);
+  for (size_t i = 0; i < batch_size_; i++) {
+    batch_keys_[i] = batch_[i].key;
+    batch_values_[i].Reset();
+  }
+  validator_(batch_size_, batch_keys_.data(), batch_values_.data(),
+             batch_statuses_.data(), batch_seqs_.data());
+  for (size_t i = 0; i < batch_size_; i++) {
+    const Status& s = batch_statuses_[i];
+    if (s.ok()) {
+      // Another version of the key in the same or a later batch, if any, has
+      // a different sequence number and is dropped
+      batch_[i].current = batch_seqs_[i] == batch_[i].sequence;
+    } else if (s.IsNotFound()) {
+      batch_[i].current = false;
+    } else {
+      status_ = s;
+      batch_size_ = 0;
+      return;
+    }
+  }
+}
+
+void SecondaryQueryIterator::NotSupported() {
+  valid_ = false;
+  status_ = Status::NotSupported(
+      "Secondary index iterator only supports forward iteration from the "
+      "first entry");
+}
+
+}  // namespace ROCKSDB_NAMESPACE
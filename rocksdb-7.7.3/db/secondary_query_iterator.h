@@ -0,0 +1,141 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/range_tombstone_fragmenter.h"
+#include "memory/arena.h"
+#include "rocksdb/iterator.h"
+#include "rocksdb/options.h"
+#include "util/rtree.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// The iterator returned by DB::NewSecondaryIndexIterator(). Secondary index
+// results come in no particular order, so instead of merging its sources
+// with the secondary comparator, it reads them one after the other: the
+// memtables, then the table files. Each source is only positioned when the
+// previous one is exhausted.
+//
+// An entry is returned if it is a value visible at the iterator's sequence
+// number and not covered by a newer range tombstone. Point deletions are
+// skipped, but do not hide older values of the same key in other sources.
+// With a validator (see SetValidator()), an entry is only returned if it is
+// also the newest version of its primary key.
+//
+// Only SeekToFirst() and Next() are supported.
+class SecondaryQueryIterator final : public Iterator {
+ public:
+  // Looks up the primary keys keys[0, num_keys) at the iterator's sequence
+  // number. For each key, sets statuses[i] as a Get() would, and on success
+  // seqs[i] to the sequence number of the value found. values[i] receives
+  // the value.
+  using Validator =
+      std::function<void(size_t num_keys, const Slice* keys,
+                         PinnableSlice* values, Status* statuses,
+                         SequenceNumber* seqs)>;
+
+  // `query` is stored as the RtreeIteratorContext of read_options()
+  SecondaryQueryIterator(const ReadOptions& read_options, const Slice& query,
+                         SequenceNumber sequence);
+  ~SecondaryQueryIterator() override;
+
+  // No copying allowed
+  SecondaryQueryIterator(const SecondaryQueryIterator&) = delete;
+  SecondaryQueryIterator& operator=(const SecondaryQueryIterator&) = delete;
+
+  // The options the sources have to be created with. They live as long as
+  // the iterator.
+  const ReadOptions& read_options() const { return read_options_; }
+  // Where the sources have to be allocated
+  Arena* arena() { return &arena_; }
+
+  // Adds a source, allocated in arena(), after the previous ones
+  void AddIterator(InternalIterator* iter) { children_.push_back(iter); }
+  // Adds range tombstones applying to all sources
+  void AddRangeTombstones(
+      std::unique_ptr<FragmentedRangeTombstoneIterator>&& tombstones) {
+    if (tombstones != nullptr && !tombstones->empty()) {
+      range_tombstones_.push_back(std::move(tombstones));
+    }
+  }
+
+  // Makes the iterator read ahead batches of results and drop those whose
+  // primary key has a newer version according to `validator`
+  void SetValidator(Validator&& validator) {
+    validator_ = std::move(validator);
+  }
+
+  bool Valid() const override { return valid_; }
+  void SeekToFirst() override;
+  void SeekToLast() override { NotSupported(); }
+  void Seek(const Slice& /*target*/) override { NotSupported(); }
+  void SeekForPrev(const Slice& /*target*/) override { NotSupported(); }
+  void Next() override;
+  void Prev() override { NotSupported(); }
+  Slice key() const override {
+    assert(valid_);
+    return validator_ ? Slice(batch_[batch_pos_].key) : parsed_.user_key;
+  }
+  Slice value() const override {
+    assert(valid_);
+    return validator_ ? Slice(batch_[batch_pos_].value)
+                      : children_[current_]->value();
+  }
+  Status status() const override { return status_; }
+
+ private:
+  // A result read ahead for validation
+  struct Candidate {
+    std::string key;
+    std::string value;
+    SequenceNumber sequence;
+    bool current;
+  };
+
+  // Moves to the first visible entry of the sources, from the current
+  // position of the current source on
+  void FindVisibleEntry();
+  bool IsCoveredByRangeTombstone();
+  // Moves to the first current candidate, from batch_pos_ on, reading and
+  // validating new batches as needed
+  void FindCurrentCandidate();
+  void ReadAndValidateBatch();
+  void NotSupported();
+
+  RtreeIteratorContext context_;
+  ReadOptions read_options_;
+  const SequenceNumber sequence_;
+  Arena arena_;
+  std::vector<InternalIterator*> children_;
+  std::vector<std::unique_ptr<FragmentedRangeTombstoneIterator>>
+      range_tombstones_;
+
+  size_t current_ = 0;
+  // Whether the sources are positioned at a visible entry
+  bool source_valid_ = false;
+  bool valid_ = false;
+  ParsedInternalKey parsed_;
+  Status status_;
+
+  Validator validator_;
+  // The first batch_size_ candidates form the current batch, the others are
+  // kept for their buffers
+  std::vector<Candidate> batch_;
+  size_t batch_size_ = 0;
+  size_t batch_pos_ = 0;
+  std::vector<Slice> batch_keys_;
+  std::vector<PinnableSlice> batch_values_;
+  std::vector<Status> batch_statuses_;
+  std::vector<SequenceNumber> batch_seqs_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
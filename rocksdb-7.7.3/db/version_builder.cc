@@ -13,6 +13,7 @@
 #include <atomic>
 #include <cinttypes>
 #include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <set>
@@ -27,6 +28,7 @@
 #include "cache/cache_reservation_manager.h"
 #include "db/blob/blob_file_meta.h"
 #include "db/dbformat.h"
+#include "db/global_sec_index/global_sec_index_log.h"
 #include "db/internal_stats.h"
 #include "db/table_cache.h"
 #include "db/version_set.h"
@@ -702,7 +704,7 @@ class VersionBuilder::Rep {
     return meta->mbr;
   }  
 
-  std::vector<std::pair<Mbr, BlockHandle>> GetSecEntriesForTableFile(int level,
+  const std::vector<std::pair<Mbr, BlockHandle>>& GetSecEntriesForTableFile(int level,
                         uint64_t file_number) const {
     assert(level < num_levels_);
 
@@ -724,7 +726,7 @@ class VersionBuilder::Rep {
     return meta->SecondaryEntries;
   }  
 
-  std::vector<std::pair<ValueRange, BlockHandle>> GetSecValRangeForTableFile(int level,
+  const std::vector<std::pair<ValueRange, BlockHandle>>& GetSecValRangeForTableFile(int level,
                         uint64_t file_number) const {
     assert(level < num_levels_);
 
@@ -897,6 +899,54 @@ class VersionBuilder::Rep {
     return Status::OK();
   }
 
+  // Drop all the entries of a deleted file from the global index with one
+  // walk over the tree, restricted to the branches leading to the entries'
+  // own bounds, and a single condense pass. Removing them one by one would
+  // search the tree from the root for every entry while the DB mutex is
+  // held, and a walk over the rect covering the file would visit most of
+  // the tree.
+  // `entry_mins`/`entry_maxs` hold the narrowed bounds of entry i at index
+  // i * GlobalSecRtree::DIMS.
+  static void RemoveFileFromGlobalSecIndex(
+      GlobalSecRtree* global_rtree_p, uint64_t file_number,
+      const std::vector<GlobalSecRtree::ElemType>& entry_mins,
+      const std::vector<GlobalSecRtree::ElemType>& entry_maxs) {
+    const size_t num_entries = entry_mins.size() / GlobalSecRtree::DIMS;
+    if (num_entries == 0) {
+      return;
+    }
+    const int removed = global_rtree_p->RemoveIf(
+        entry_mins.data(), entry_maxs.data(), num_entries,
+        [file_number](const GlobalSecIndexValue& value) {
+          return value.filenum == file_number;
+        });
+    assert(static_cast<size_t>(removed) <= num_entries);
+    (void)removed;
+  }
+
+  static void AppendNarrowedRect(const double* entry_min,
+                                 const double* entry_max,
+                                 std::vector<GlobalSecRtree::ElemType>* mins,
+                                 std::vector<GlobalSecRtree::ElemType>* maxs) {
+    GlobalSecRtree::ElemType min[GlobalSecRtree::DIMS];
+    GlobalSecRtree::ElemType max[GlobalSecRtree::DIMS];
+    GlobalSecRtree::NarrowRect(entry_min, entry_max, min, max);
+    mins->insert(mins->end(), min, min + GlobalSecRtree::DIMS);
+    maxs->insert(maxs->end(), max, max + GlobalSecRtree::DIMS);
+  }
+
+  // The global index stores its bounds rounded outward to floats, the exact
+  // ones stay in the FileMetaData of the file
+  static void InsertIntoGlobalSecIndex(GlobalSecRtree* global_rtree_p,
+                                       const double* entry_min,
+                                       const double* entry_max,
+                                       const GlobalSecIndexValue& value) {
+    GlobalSecRtree::ElemType min[GlobalSecRtree::DIMS];
+    GlobalSecRtree::ElemType max[GlobalSecRtree::DIMS];
+    GlobalSecRtree::NarrowRect(entry_min, entry_max, min, max);
+    global_rtree_p->Insert(min, max, value);
+  }
+
     // Apply all of the edits in *edit to the current state.
   Status Apply(const VersionEdit* edit) {
     // std::cout << "old apply" << std::endl;
@@ -1073,7 +1123,8 @@ class VersionBuilder::Rep {
   }
 
     // Apply all of the edits in *edit to the current state.
-  Status Apply(const VersionEdit* edit, GlobalSecRtree* global_rtee_p) {
+  Status Apply(const VersionEdit* edit, GlobalSecRtree* global_rtee_p,
+               std::vector<GlobalSecIndexDelta>* global_sec_deltas) {
     // std::cout << "apply" << std::endl;
     {
       const Status s = CheckConsistency(base_vstorage_);
@@ -1115,16 +1166,25 @@ class VersionBuilder::Rep {
           // Rect1D filerect(valrange.range.min, valrange.range.max);
           // global_rtree.Remove(filerect.min, filerect.max, std::make_pair(level, file_number));
 
-          const std::vector<std::pair<ValueRange, BlockHandle>> file_secentries_num = GetSecValRangeForTableFile(level, file_number);
+          const std::vector<std::pair<ValueRange, BlockHandle>>& file_secentries_num = GetSecValRangeForTableFile(level, file_number);
+          std::vector<GlobalSecRtree::ElemType> entry_mins;
+          std::vector<GlobalSecRtree::ElemType> entry_maxs;
           int globla_sec_id = 0;
           for (const std::pair<ValueRange, BlockHandle>& entry: file_secentries_num) {
             ValueRange entryvalrange = entry.first;
             Rect1D tuplerect_num(entryvalrange.range.min, entryvalrange.range.max);
-            BlockHandle entryblkhandle_num = entry.second;
-            GlobalSecIndexValue sec_index_val_num(globla_sec_id, file_number, entryblkhandle_num);
-            global_rtee_p->Remove(tuplerect_num.min, tuplerect_num.max, sec_index_val_num);
+            GlobalSecIndexValue sec_index_val_num(globla_sec_id, file_number);
+            AppendNarrowedRect(tuplerect_num.min, tuplerect_num.max,
+                               &entry_mins, &entry_maxs);
+            if (global_sec_deltas) {
+              global_sec_deltas->emplace_back(GlobalSecIndexDelta::kRemove,
+                                              tuplerect_num.min, tuplerect_num.max,
+                                              1, sec_index_val_num);
+            }
             globla_sec_id++;
           }
+          RemoveFileFromGlobalSecIndex(global_rtee_p, file_number,
+                                       entry_mins, entry_maxs);
         } else {
           // // global index @ tuple level
           // const std::vector<std::pair<int, Mbr>> filetuples= GetTupleMbrForTableFile(level, file_number);
@@ -1136,17 +1196,26 @@ class VersionBuilder::Rep {
           // }
 
           // global index @ block level
-          const std::vector<std::pair<Mbr, BlockHandle>> file_secentries = GetSecEntriesForTableFile(level, file_number);         
+          const std::vector<std::pair<Mbr, BlockHandle>>& file_secentries = GetSecEntriesForTableFile(level, file_number);         
           // std::cout << "delete: " <<  file_number << "; filetuple_entries.size: " << static_cast<int>(file_secentries.size()) << std::endl;
+          std::vector<GlobalSecRtree::ElemType> entry_mins;
+          std::vector<GlobalSecRtree::ElemType> entry_maxs;
           int glosecid = 0;
           for (const std::pair<Mbr, BlockHandle>& entry: file_secentries) {    
             Mbr entrymbr = entry.first;
-            BlockHandle entryblkhandle = entry.second;
-            GlobalSecIndexValue sec_index_val(glosecid, file_number, entryblkhandle);
+            GlobalSecIndexValue sec_index_val(glosecid, file_number);
             Rect tuplerect(entrymbr.first.min, entrymbr.second.min, entrymbr.first.max, entrymbr.second.max);
-            global_rtee_p->Remove(tuplerect.min, tuplerect.max, sec_index_val);
+            AppendNarrowedRect(tuplerect.min, tuplerect.max, &entry_mins,
+                               &entry_maxs);
+            if (global_sec_deltas) {
+              global_sec_deltas->emplace_back(GlobalSecIndexDelta::kRemove,
+                                              tuplerect.min, tuplerect.max, 2,
+                                              sec_index_val);
+            }
             glosecid++;
           }   
+          RemoveFileFromGlobalSecIndex(global_rtee_p, file_number,
+                                       entry_mins, entry_maxs);
         }
       }
 
@@ -1176,10 +1245,14 @@ class VersionBuilder::Rep {
           int rtree_id_num = 0;
           for (const std::pair<ValueRange, BlockHandle>& entry: filetuple_entries_num) {
             ValueRange entryvalrange = entry.first;
-            BlockHandle entryblkhandle_num = entry.second;
-            GlobalSecIndexValue sec_indexvalnum(rtree_id_num, filenumber, entryblkhandle_num);
+            GlobalSecIndexValue sec_indexvalnum(rtree_id_num, filenumber);
             Rect1D tuplerect_num(entryvalrange.range.min, entryvalrange.range.max);
-            global_rtee_p->Insert(tuplerect_num.min, tuplerect_num.max, sec_indexvalnum);
+            InsertIntoGlobalSecIndex(global_rtee_p, tuplerect_num.min, tuplerect_num.max, sec_indexvalnum);
+            if (global_sec_deltas) {
+              global_sec_deltas->emplace_back(GlobalSecIndexDelta::kInsert,
+                                              tuplerect_num.min, tuplerect_num.max,
+                                              1, sec_indexvalnum);
+            }
             rtree_id_num++;
           }
         } else {
@@ -1199,10 +1272,14 @@ class VersionBuilder::Rep {
           int rtree_id = 0;         
           for (const std::pair<Mbr, BlockHandle>& entry: filetuple_entries) { 
             Mbr entrymbr = entry.first;
-            BlockHandle entryblkhandle = entry.second;
-            GlobalSecIndexValue sec_indexval(rtree_id, filenumber, entryblkhandle);
+            GlobalSecIndexValue sec_indexval(rtree_id, filenumber);
             Rect tuplerect(entrymbr.first.min, entrymbr.second.min, entrymbr.first.max, entrymbr.second.max);
-            global_rtee_p->Insert(tuplerect.min, tuplerect.max, sec_indexval);
+            InsertIntoGlobalSecIndex(global_rtee_p, tuplerect.min, tuplerect.max, sec_indexval);
+            if (global_sec_deltas) {
+              global_sec_deltas->emplace_back(GlobalSecIndexDelta::kInsert,
+                                              tuplerect.min, tuplerect.max, 2,
+                                              sec_indexval);
+            }
             rtree_id++;
           }
         }
@@ -1669,8 +1746,10 @@ Status VersionBuilder::Apply(const VersionEdit* edit) {
   return rep_->Apply(edit);
 }
 
-Status VersionBuilder::Apply(const VersionEdit* edit, GlobalSecRtree* global_rtree_p) {
-  return rep_->Apply(edit, global_rtree_p);
+Status VersionBuilder::Apply(
+    const VersionEdit* edit, GlobalSecRtree* global_rtree_p,
+    std::vector<GlobalSecIndexDelta>* global_sec_deltas) {
+  return rep_->Apply(edit, global_rtree_p, global_sec_deltas);
 }
 
 Status VersionBuilder::SaveTo(VersionStorageInfo* vstorage) const {
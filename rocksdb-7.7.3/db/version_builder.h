@@ -28,13 +28,14 @@ class Version;
 class VersionSet;
 class ColumnFamilyData;
 class CacheReservationManager;
+struct GlobalSecIndexDelta;
 
 // A helper class so we can efficiently apply a whole sequence
 // of edits to a particular state without creating intermediate
 // Versions that contain full copies of the intermediate state.
 class VersionBuilder {
  public:
-  typedef RTree<GlobalSecIndexValue, double, 1, double> GlobalSecRtree; 
+  typedef RTree<GlobalSecIndexValue, float, 1, double> GlobalSecRtree; 
   VersionBuilder(const FileOptions& file_options,
                  const ImmutableCFOptions* ioptions, TableCache* table_cache,
                  VersionStorageInfo* base_vstorage, VersionSet* version_set,
@@ -44,7 +45,10 @@ class VersionBuilder {
 
   bool CheckConsistencyForNumLevels();
   Status Apply(const VersionEdit* edit);
-  Status Apply(const VersionEdit* edit, GlobalSecRtree* global_rtree_p);
+  // Also applies the edit to the global secondary index. Every change made
+  // to the index is appended to *global_sec_deltas if it is not null.
+  Status Apply(const VersionEdit* edit, GlobalSecRtree* global_rtree_p,
+               std::vector<GlobalSecIndexDelta>* global_sec_deltas = nullptr);
   Status SaveTo(VersionStorageInfo* vstorage) const;
   Status LoadTableHandlers(
       InternalStats* internal_stats, int max_threads,
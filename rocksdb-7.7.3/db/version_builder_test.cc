@@ -5,10 +5,13 @@
 
 #include <cstring>
 #include <iomanip>
+#include <map>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <string>
 
+#include "db/global_sec_index/global_sec_index_log.h"
 #include "db/version_edit.h"
 #include "db/version_set.h"
 #include "rocksdb/advanced_options.h"
@@ -201,6 +204,86 @@ TEST_F(VersionBuilderTest, ApplyAndSaveTo) {
   UnrefFilesInVersion(&new_vstorage);
 }
 
+TEST_F(VersionBuilderTest, ApplyRemovesFileFromGlobalSecIndex) {
+  ioptions_.global_sec_index = true;
+  ioptions_.global_sec_index_is_spatial = false;
+  typedef VersionBuilder::GlobalSecRtree GlobalSecRtree;
+
+  // Three files whose entries interleave, so that every file's cover spans
+  // the entries of the others
+  constexpr int kEntriesPerFile = 60;
+  VersionEdit add_edit;
+  for (uint64_t file_number = 10; file_number < 13; file_number++) {
+    std::vector<std::pair<ValueRange, BlockHandle>> sec_valrange;
+    for (int i = 0; i < kEntriesPerFile; i++) {
+      ValueRange range;
+      const double lo = i * 10.0 + static_cast<double>(file_number);
+      range.set_range(lo, lo + 5);
+      sec_valrange.emplace_back(range, BlockHandle(i * 100, 100));
+    }
+    const std::string smallest = std::to_string(file_number * 100);
+    const std::string largest = std::to_string(file_number * 100 + 50);
+    add_edit.AddFile(1, file_number, 0, 100U, GetInternalKey(smallest.c_str()),
+                     GetInternalKey(largest.c_str()), 200, 200, false,
+                     Temperature::kUnknown, kInvalidBlobFileNumber,
+                     kUnknownOldestAncesterTime, kUnknownFileCreationTime,
+                     kUnknownFileChecksum, kUnknownFileChecksumFuncName,
+                     kNullUniqueId64x2, Mbr(), SpatialSketch(), sec_valrange,
+                     {});
+  }
+
+  EnvOptions env_options;
+  GlobalSecRtree global_rtree;
+  std::vector<GlobalSecIndexDelta> deltas;
+  VersionBuilder add_builder(env_options, &ioptions_, nullptr, &vstorage_,
+                             nullptr);
+  ASSERT_OK(add_builder.Apply(&add_edit, &global_rtree, &deltas));
+  VersionStorageInfo added_vstorage(&icmp_, ucmp_, options_.num_levels,
+                                    kCompactionStyleLevel, nullptr, false);
+  ASSERT_OK(add_builder.SaveTo(&added_vstorage));
+  UpdateVersionStorageInfo(&added_vstorage);
+  ASSERT_EQ(3 * kEntriesPerFile, global_rtree.Size());
+  ASSERT_EQ(3 * kEntriesPerFile, deltas.size());
+
+  // Merge two entries of file 11 the way coarsening does; the merged entry
+  // has to go as well
+  {
+    const GlobalSecRtree::ElemType lo[] = {11};
+    const GlobalSecRtree::ElemType hi[] = {16};
+    const GlobalSecRtree::ElemType merged_hi[] = {26};
+    global_rtree.Remove(lo, hi, GlobalSecIndexValue(0, 11));
+    const GlobalSecRtree::ElemType lo1[] = {21};
+    const GlobalSecRtree::ElemType hi1[] = {26};
+    global_rtree.Remove(lo1, hi1, GlobalSecIndexValue(1, 11));
+    global_rtree.Insert(lo, merged_hi, GlobalSecIndexValue(0, 11, 2));
+  }
+
+  VersionEdit delete_edit;
+  delete_edit.DeleteFile(1, 11);
+  deltas.clear();
+  VersionBuilder delete_builder(env_options, &ioptions_, nullptr,
+                                &added_vstorage, nullptr);
+  ASSERT_OK(delete_builder.Apply(&delete_edit, &global_rtree, &deltas));
+  ASSERT_EQ(kEntriesPerFile, deltas.size());
+  for (const auto& delta : deltas) {
+    ASSERT_EQ(GlobalSecIndexDelta::kRemove, delta.op);
+    ASSERT_EQ(11, delta.value.filenum);
+  }
+
+  ASSERT_EQ(2 * kEntriesPerFile, global_rtree.Size());
+  std::map<uint64_t, std::set<int>> remaining;
+  GlobalSecRtree::Iterator it;
+  for (global_rtree.GetFirst(it); !global_rtree.IsNull(it);
+       global_rtree.GetNext(it)) {
+    ASSERT_TRUE(remaining[(*it).filenum].insert((*it).id).second);
+  }
+  ASSERT_EQ(2, remaining.size());
+  ASSERT_EQ(kEntriesPerFile, remaining[10].size());
+  ASSERT_EQ(kEntriesPerFile, remaining[12].size());
+
+  UnrefFilesInVersion(&added_vstorage);
+}
+
 TEST_F(VersionBuilderTest, ApplyAndSaveToDynamic) {
   ioptions_.level_compaction_dynamic_level_bytes = true;
 
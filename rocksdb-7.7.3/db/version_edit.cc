@@ -22,6 +22,149 @@ namespace ROCKSDB_NAMESPACE {
 
 namespace {
 
+// Secondary index metadata is stored with exact double bit patterns: the
+// rectangles have to compare equal to the ones inserted into the global
+// secondary index, so that removing a file removes its entries.
+void PutDouble(std::string* dst, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  PutFixed64(dst, bits);
+}
+
+bool GetDouble(Slice* input, double* value) {
+  uint64_t bits;
+  if (!GetFixed64(input, &bits)) {
+    return false;
+  }
+  memcpy(value, &bits, sizeof(bits));
+  return true;
+}
+
+void EncodeMbr(std::string* dst, const Mbr& mbr) {
+  PutVarint64Varint64(dst, mbr.iid.min, mbr.iid.max);
+  PutDouble(dst, mbr.first.min);
+  PutDouble(dst, mbr.first.max);
+  PutDouble(dst, mbr.second.min);
+  PutDouble(dst, mbr.second.max);
+}
+
+bool DecodeMbr(Slice* input, Mbr* mbr) {
+  uint64_t iid_min, iid_max;
+  double first_min, first_max, second_min, second_max;
+  if (!GetVarint64(input, &iid_min) || !GetVarint64(input, &iid_max) ||
+      !GetDouble(input, &first_min) || !GetDouble(input, &first_max) ||
+      !GetDouble(input, &second_min) || !GetDouble(input, &second_max)) {
+    return false;
+  }
+  mbr->set_iid(iid_min, iid_max);
+  mbr->set_first(first_min, first_max);
+  mbr->set_second(second_min, second_max);
+  return true;
+}
+
+void EncodeValueRange(std::string* dst, const ValueRange& valrange) {
+  PutDouble(dst, valrange.range.min);
+  PutDouble(dst, valrange.range.max);
+}
+
+bool DecodeValueRange(Slice* input, ValueRange* valrange) {
+  double min, max;
+  if (!GetDouble(input, &min) || !GetDouble(input, &max)) {
+    return false;
+  }
+  valrange->set_range(min, max);
+  return true;
+}
+
+// Entries come out of the table builder grouped by leaf partition, so runs
+// sharing a block handle store the handle once:
+//   varint32 num_groups
+//   num_groups * (BlockHandle, varint32 count, count * encoded entry)
+template <typename T>
+void EncodeSecEntries(std::string* dst,
+                      const std::vector<std::pair<T, BlockHandle>>& entries,
+                      void (*encode_entry)(std::string*, const T&)) {
+  std::string groups;
+  uint32_t num_groups = 0;
+  size_t i = 0;
+  while (i < entries.size()) {
+    const BlockHandle& handle = entries[i].second;
+    size_t end = i + 1;
+    while (end < entries.size() && entries[end].second == handle) {
+      ++end;
+    }
+    handle.EncodeTo(&groups);
+    PutVarint32(&groups, static_cast<uint32_t>(end - i));
+    for (; i < end; ++i) {
+      encode_entry(&groups, entries[i].first);
+    }
+    ++num_groups;
+  }
+  PutVarint32(dst, num_groups);
+  dst->append(groups);
+}
+
+template <typename T>
+bool DecodeSecEntries(Slice* input,
+                      std::vector<std::pair<T, BlockHandle>>* entries,
+                      bool (*decode_entry)(Slice*, T*)) {
+  uint32_t num_groups = 0;
+  if (!GetVarint32(input, &num_groups)) {
+    return false;
+  }
+  entries->clear();
+  for (uint32_t g = 0; g < num_groups; ++g) {
+    BlockHandle handle;
+    uint32_t count = 0;
+    if (!handle.DecodeFrom(input).ok() || !GetVarint32(input, &count)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      T entry;
+      if (!decode_entry(input, &entry)) {
+        return false;
+      }
+      entries->emplace_back(entry, handle);
+    }
+  }
+  return input->empty();
+}
+
+// The non-zero cells of a sketch, as "row,col:count"
+std::string SketchCellsToString(const SpatialSketch& sketch) {
+  std::string r;
+  for (int row = 0; row < SpatialSketch::ROWS; row++) {
+    for (int col = 0; col < SpatialSketch::COLS; col++) {
+      if (sketch.density_map_[row][col] != 0) {
+        if (!r.empty()) {
+          r.append(" ");
+        }
+        r.append(std::to_string(row) + "," + std::to_string(col) + ":" +
+                 std::to_string(sketch.density_map_[row][col]));
+      }
+    }
+  }
+  return r;
+}
+
+// One "range@offset+size" per entry
+template <typename T>
+std::string SecEntriesToString(
+    const std::vector<std::pair<T, BlockHandle>>& entries) {
+  std::string r;
+  for (const auto& entry : entries) {
+    if (!r.empty()) {
+      r.append(" ");
+    }
+    r.append(entry.first.toString());
+    r.append("@");
+    AppendNumberTo(&r, entry.second.offset());
+    r.append("+");
+    AppendNumberTo(&r, entry.second.size());
+  }
+  return r;
+}
+
 }  // anonymous namespace
 
 uint64_t PackFileNumberAndPathId(uint64_t number, uint64_t path_id) {
@@ -263,6 +406,43 @@ bool VersionEdit::EncodeTo(std::string* dst) const {
       std::string unique_id_str = EncodeUniqueIdBytes(&unique_id);
       PutLengthPrefixedSlice(dst, Slice(unique_id_str));
     }
+    if (!f.mbr.empty()) {
+      PutVarint32(dst, NewFileCustomTag::kMbr);
+      std::string mbr;
+      EncodeMbr(&mbr, f.mbr);
+      PutLengthPrefixedSlice(dst, Slice(mbr));
+    }
+    if (f.sketch.getSumValues() != 0) {
+      // The density map is mostly empty, only keep the non-zero cells.
+      PutVarint32(dst, NewFileCustomTag::kSpatialSketch);
+      std::string cells;
+      uint32_t num_cells = 0;
+      for (int r = 0; r < SpatialSketch::ROWS; r++) {
+        for (int c = 0; c < SpatialSketch::COLS; c++) {
+          if (f.sketch.density_map_[r][c] != 0) {
+            PutVarint32Varint32(&cells, r * SpatialSketch::COLS + c,
+                                f.sketch.density_map_[r][c]);
+            num_cells++;
+          }
+        }
+      }
+      std::string sketch;
+      PutVarint32(&sketch, num_cells);
+      sketch.append(cells);
+      PutLengthPrefixedSlice(dst, Slice(sketch));
+    }
+    if (!f.SecondaryEntries.empty()) {
+      PutVarint32(dst, NewFileCustomTag::kSecondaryEntries);
+      std::string entries;
+      EncodeSecEntries<Mbr>(&entries, f.SecondaryEntries, EncodeMbr);
+      PutLengthPrefixedSlice(dst, Slice(entries));
+    }
+    if (!f.SecValrange.empty()) {
+      PutVarint32(dst, NewFileCustomTag::kSecValueRanges);
+      std::string entries;
+      EncodeSecEntries<ValueRange>(&entries, f.SecValrange, EncodeValueRange);
+      PutLengthPrefixedSlice(dst, Slice(entries));
+    }
 
     TEST_SYNC_POINT_CALLBACK("VersionEdit::EncodeTo:NewFile4:CustomizeFields",
                              dst);
@@ -431,6 +611,42 @@ const char* VersionEdit::DecodeNewFile4From(Slice* input) {
             return "invalid unique id";
           }
           break;
+        case kMbr:
+          if (!DecodeMbr(&field, &f.mbr) || !field.empty()) {
+            return "invalid mbr";
+          }
+          break;
+        case kSpatialSketch: {
+          uint32_t num_cells = 0;
+          if (!GetVarint32(&field, &num_cells)) {
+            return "invalid spatial sketch";
+          }
+          for (uint32_t i = 0; i < num_cells; i++) {
+            uint32_t cell = 0;
+            uint32_t count = 0;
+            if (!GetVarint32(&field, &cell) || !GetVarint32(&field, &count) ||
+                cell >= SpatialSketch::ROWS * SpatialSketch::COLS) {
+              return "invalid spatial sketch";
+            }
+            f.sketch.density_map_[cell / SpatialSketch::COLS]
+                                 [cell % SpatialSketch::COLS] = count;
+          }
+          if (!field.empty()) {
+            return "invalid spatial sketch";
+          }
+          break;
+        }
+        case kSecondaryEntries:
+          if (!DecodeSecEntries<Mbr>(&field, &f.SecondaryEntries, DecodeMbr)) {
+            return "invalid secondary entries";
+          }
+          break;
+        case kSecValueRanges:
+          if (!DecodeSecEntries<ValueRange>(&field, &f.SecValrange,
+                                            DecodeValueRange)) {
+            return "invalid secondary value ranges";
+          }
+          break;
         default:
           if ((custom_tag & kCustomTagNonSafeIgnoreMask) != 0) {
             // Should not proceed if cannot understand it
@@ -865,6 +1081,22 @@ std::string VersionEdit::DebugString(bool hex_key) const {
       InternalUniqueIdToExternal(&id);
       r.append(UniqueIdToHumanString(EncodeUniqueIdBytes(&id)));
     }
+    if (!f.mbr.empty()) {
+      r.append(" mbr: ");
+      r.append(f.mbr.toString());
+    }
+    if (f.sketch.getSumValues() != 0) {
+      r.append(" spatial_sketch: ");
+      r.append(SketchCellsToString(f.sketch));
+    }
+    if (!f.SecondaryEntries.empty()) {
+      r.append(" secondary_entries: ");
+      r.append(SecEntriesToString(f.SecondaryEntries));
+    }
+    if (!f.SecValrange.empty()) {
+      r.append(" sec_value_ranges: ");
+      r.append(SecEntriesToString(f.SecValrange));
+    }
   }
 
   for (const auto& blob_file_addition : blob_file_additions_) {
@@ -979,6 +1211,18 @@ std::string VersionEdit::DebugJSON(int edit_num, bool hex_key) const {
         // permanent
         jw << "Temperature" << static_cast<int>(f.temperature);
       }
+      if (!f.mbr.empty()) {
+        jw << "Mbr" << f.mbr.toString();
+      }
+      if (f.sketch.getSumValues() != 0) {
+        jw << "SpatialSketch" << SketchCellsToString(f.sketch);
+      }
+      if (!f.SecondaryEntries.empty()) {
+        jw << "SecondaryEntries" << SecEntriesToString(f.SecondaryEntries);
+      }
+      if (!f.SecValrange.empty()) {
+        jw << "SecValueRanges" << SecEntriesToString(f.SecValrange);
+      }
       jw.EndArrayedObject();
     }
 
@@ -89,6 +89,12 @@ enum NewFileCustomTag : uint32_t {
   kMinTimestamp = 10,
   kMaxTimestamp = 11,
   kUniqueId = 12,
+  // Secondary index metadata of the file, so that recovery does not need to
+  // reopen the table to rebuild it.
+  kMbr = 13,
+  kSpatialSketch = 14,
+  kSecondaryEntries = 15,
+  kSecValueRanges = 16,
 
   // If this bit for the custom tag is set, opening DB should fail if
   // we don't know this field.
@@ -114,6 +114,75 @@ TEST_F(VersionEditTest, EncodeDecodeNewFile4) {
   ASSERT_EQ(1001, new_files[3].second.oldest_blob_file_number);
 }
 
+TEST_F(VersionEditTest, EncodeDecodeSecondaryIndexMetadata) {
+  VersionEdit base;
+  base.AddFile(3, 300, 0, 100, InternalKey("foo", 500, kTypeValue),
+               InternalKey("zoo", 600, kTypeValue), 500, 600, false,
+               Temperature::kUnknown, kInvalidBlobFileNumber,
+               kUnknownOldestAncesterTime, kUnknownFileCreationTime,
+               kUnknownFileChecksum, kUnknownFileChecksumFuncName,
+               kNullUniqueId64x2);
+  FileMetaData f = base.GetNewFiles()[0].second;
+  f.mbr.set_iid(7, 42);
+  f.mbr.set_first(-12.25, 37.5);
+  f.mbr.set_second(50.125, 125.75);
+  f.sketch.density_map_[0][3] = 5;
+  f.sketch.density_map_[15][15] = 1;
+  Mbr block_mbr;
+  block_mbr.set_iid(7, 20);
+  block_mbr.set_first(-12.25, 0.5);
+  block_mbr.set_second(50.125, 60.0);
+  // Two entries sharing a block handle and one in a block of their own
+  f.SecondaryEntries.emplace_back(block_mbr, BlockHandle(0, 4000));
+  f.SecondaryEntries.emplace_back(f.mbr, BlockHandle(0, 4000));
+  f.SecondaryEntries.emplace_back(block_mbr, BlockHandle(4005, 3000));
+  ValueRange valrange;
+  valrange.set_range(0.5, 99.25);
+  f.SecValrange.emplace_back(valrange, BlockHandle(4005, 3000));
+
+  VersionEdit edit;
+  edit.AddFile(3, f);
+  TestEncodeDecode(edit);
+
+  std::string encoded;
+  edit.EncodeTo(&encoded);
+  VersionEdit parsed;
+  Status s = parsed.DecodeFrom(encoded);
+  ASSERT_TRUE(s.ok()) << s.ToString();
+  const FileMetaData& g = parsed.GetNewFiles()[0].second;
+  ASSERT_EQ(f.mbr.toString(), g.mbr.toString());
+  for (int r = 0; r < SpatialSketch::ROWS; r++) {
+    for (int c = 0; c < SpatialSketch::COLS; c++) {
+      ASSERT_EQ(f.sketch.density_map_[r][c], g.sketch.density_map_[r][c]);
+    }
+  }
+  ASSERT_EQ(3u, g.SecondaryEntries.size());
+  for (size_t i = 0; i < f.SecondaryEntries.size(); i++) {
+    ASSERT_EQ(f.SecondaryEntries[i].first.toString(),
+              g.SecondaryEntries[i].first.toString());
+    ASSERT_EQ(f.SecondaryEntries[i].second.offset(),
+              g.SecondaryEntries[i].second.offset());
+    ASSERT_EQ(f.SecondaryEntries[i].second.size(),
+              g.SecondaryEntries[i].second.size());
+  }
+  ASSERT_EQ(1u, g.SecValrange.size());
+  ASSERT_EQ(0.5, g.SecValrange[0].first.range.min);
+  ASSERT_EQ(99.25, g.SecValrange[0].first.range.max);
+  ASSERT_EQ(4005u, g.SecValrange[0].second.offset());
+
+  // Shown by manifest dumps
+  std::string str = parsed.DebugString();
+  ASSERT_NE(str.find(" mbr: "), std::string::npos);
+  ASSERT_NE(str.find(" spatial_sketch: 0,3:5 15,15:1"), std::string::npos);
+  ASSERT_NE(str.find("@4005+3000"), std::string::npos);
+  ASSERT_NE(str.find(" sec_value_ranges: "), std::string::npos);
+  std::string json = parsed.DebugJSON(0);
+  ASSERT_NE(json.find("\"Mbr\""), std::string::npos);
+  ASSERT_NE(json.find("\"SpatialSketch\""), std::string::npos);
+  ASSERT_NE(json.find("\"SecondaryEntries\""), std::string::npos);
+  ASSERT_NE(json.find("\"SecValueRanges\""), std::string::npos);
+}
+
 TEST_F(VersionEditTest, ForwardCompatibleNewFile4) {
   static const uint64_t kBig = 1ull << 50;
   VersionEdit edit;
@@ -18,10 +18,12 @@
 #include <map>
 #include <set>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 #include <utility>
 
+#include "cache/cache_reservation_manager.h"
 #include "db/blob/blob_fetcher.h"
 #include "db/blob/blob_file_cache.h"
 #include "db/blob/blob_file_reader.h"
@@ -56,11 +58,14 @@
 #include "options/options_helper.h"
 #include "rocksdb/env.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/table.h"
 #include "rocksdb/write_buffer_manager.h"
+#include "table/block_based/sec_index_query_plan.h"
 #include "table/format.h"
 #include "table/get_context.h"
 #include "table/internal_iterator.h"
 #include "table/merging_iterator.h"
+#include "table/sec_fan_out_iterator.h"
 #include "table/meta_blocks.h"
 #include "table/multiget_context.h"
 #include "table/plain/plain_table_factory.h"
@@ -72,6 +77,7 @@
 #include "util/coding.h"
 #include "util/coro_utils.h"
 #include "util/stop_watch.h"
+#include "util/mutexlock.h"
 #include "util/string_util.h"
 #include "util/user_comparator_wrapper.h"
 #include "util/rtree.h"
@@ -1912,7 +1918,10 @@ void Version::AddIterators(const ReadOptions& read_options,
                            bool allow_unprepared_value) {
   assert(storage_info_.finalized_);
 
-  if(mutable_cf_options_.create_global_sec_index){
+  // Only secondary index scans are served by the global secondary index,
+  // primary key reads go through all levels
+  if (mutable_cf_options_.create_global_sec_index &&
+      read_options.is_secondary_index_scan) {
     int level = 0;
     AddIteratorsForLevel(read_options,soptions,merge_iter_builder,level, allow_unprepared_value);
   } else {
@@ -1923,6 +1932,174 @@ void Version::AddIterators(const ReadOptions& read_options,
   }
 }
 
+void Version::SearchGlobalSecIndex(const ReadOptions& read_options,
+                                   SecIndexQueryPlan* plan) const {
+  plan->Clear();
+
+  // getting the search range
+  RtreeIteratorContext* context =
+      reinterpret_cast<RtreeIteratorContext*>(read_options.iterator_context);
+  Slice query_slice(context->query_mbr);
+  const bool is_spatial = mutable_cf_options_.global_sec_index_is_spatial;
+  Mbr query_mbr;
+  ValueRange query_valrange;
+  if (is_spatial) {
+    query_mbr = ReadSecQueryMbr(query_slice);
+  } else {
+    query_valrange = ReadValueRange(query_slice);
+  }
+
+  // The index only stores the file and entry numbers and rounds its bounds
+  // outward: collect the matching entries first, then look up the block
+  // handles and exact bounds of each file's entries in its FileMetaData.
+  static thread_local std::vector<GlobalSecIndexValue> matches;
+  matches.clear();
+  auto visitor = [&](const GlobalSecIndexValue& value) {
+    matches.push_back(value);
+    return true;
+  };
+
+  if (is_spatial) {
+    Rect query_rect(query_mbr.first.min, query_mbr.second.min,
+                    query_mbr.first.max, query_mbr.second.max);
+    GlobalSecRtree::ElemType min[GlobalSecRtree::DIMS];
+    GlobalSecRtree::ElemType max[GlobalSecRtree::DIMS];
+    GlobalSecRtree::NarrowRect(query_rect.min, query_rect.max, min, max);
+    global_rtree_->Visit(min, max, visitor);
+  } else {
+    Rect1D query_rect1D(query_valrange.range.min, query_valrange.range.max);
+    GlobalSecRtree::ElemType min[GlobalSecRtree::DIMS];
+    GlobalSecRtree::ElemType max[GlobalSecRtree::DIMS];
+    GlobalSecRtree::NarrowRect(query_rect1D.min, query_rect1D.max, min, max);
+    global_rtree_->Visit(min, max, visitor);
+  }
+
+  std::stable_sort(matches.begin(), matches.end(),
+                   [](const GlobalSecIndexValue& a,
+                      const GlobalSecIndexValue& b) {
+                     return a.filenum < b.filenum;
+                   });
+  const FileMetaData* meta = nullptr;
+  for (size_t i = 0; i < matches.size(); i++) {
+    const GlobalSecIndexValue& value = matches[i];
+    if (i == 0 || value.filenum != matches[i - 1].filenum) {
+      // Files of other column families are skipped
+      meta = storage_info_.GetFileMetaDataByNumber(value.filenum);
+    }
+    if (meta == nullptr) {
+      continue;
+    }
+    const size_t num_entries =
+        is_spatial ? meta->SecondaryEntries.size() : meta->SecValrange.size();
+    const size_t end = static_cast<size_t>(
+        std::min<uint64_t>(num_entries, static_cast<uint64_t>(value.id) +
+                                            value.count));
+    for (size_t entry = static_cast<size_t>(value.id); entry < end; entry++) {
+      const BlockHandle& handle = is_spatial
+                                      ? meta->SecondaryEntries[entry].second
+                                      : meta->SecValrange[entry].second;
+      if (is_spatial
+              ? IntersectMbrExcludeIID(meta->SecondaryEntries[entry].first,
+                                       query_mbr)
+              : IntersectValRange(meta->SecValrange[entry].first,
+                                  query_valrange)) {
+        plan->Add(value.filenum, handle.offset(), handle.size());
+      }
+    }
+  }
+
+  plan->Finish();
+}
+
+namespace {
+void DestroyArenaReadOptions(void* arg1, void* /*arg2*/) {
+  static_cast<ReadOptions*>(arg1)->~ReadOptions();
+}
+}  // namespace
+
+InternalIterator* Version::NewSecIndexTableIterator(
+    const ReadOptions& read_options, const FileOptions& soptions,
+    const FileMetaData& file_meta, const SecIndexFilePlan* plan, int level,
+    Arena* arena, bool allow_unprepared_value,
+    TruncatedRangeDelIterator** tombstone_iter) {
+  const ReadOptions* file_read_options = &read_options;
+  ReadOptions* plan_read_options = nullptr;
+  if (plan != nullptr) {
+    // The table iterator keeps a reference to its ReadOptions, so the copy
+    // and the file's plan it points to live in the arena until the iterator
+    // is destroyed
+    plan_read_options = new (arena->AllocateAligned(sizeof(ReadOptions)))
+        ReadOptions(read_options);
+    plan_read_options->sec_index_plan = CopySecIndexFilePlan(*plan, arena);
+    file_read_options = plan_read_options;
+  }
+  InternalIterator* table_iter = cfd_->table_cache()->NewIterator(
+      *file_read_options, soptions, cfd_->internal_sec_comparator(), file_meta,
+      /*range_del_agg=*/nullptr, mutable_cf_options_.prefix_extractor, nullptr,
+      cfd_->internal_stats()->GetFileReadHist(level),
+      TableReaderCaller::kUserIterator, arena,
+      /*skip_filters=*/false, level, max_file_size_for_l0_meta_pin_,
+      /*smallest_compaction_key=*/nullptr,
+      /*largest_compaction_key=*/nullptr, allow_unprepared_value,
+      tombstone_iter);
+  if (plan_read_options != nullptr) {
+    table_iter->RegisterCleanup(&DestroyArenaReadOptions, plan_read_options,
+                                nullptr);
+  }
+  return table_iter;
+}
+
+Status Version::AddSecondaryIndexIterators(
+    const ReadOptions& read_options, const FileOptions& soptions,
+    Arena* arena, std::vector<InternalIterator*>* iters,
+    std::vector<std::unique_ptr<FragmentedRangeTombstoneIterator>>*
+        range_tombstones) {
+  assert(storage_info_.finalized_);
+
+  auto add_file = [&](const FileMetaData& file_meta,
+                      const SecIndexFilePlan* plan, int level) -> Status {
+    iters->push_back(NewSecIndexTableIterator(
+        read_options, soptions, file_meta, plan, level, arena,
+        /*allow_unprepared_value=*/false, /*tombstone_iter=*/nullptr));
+    if (range_tombstones == nullptr) {
+      return Status::OK();
+    }
+    std::unique_ptr<FragmentedRangeTombstoneIterator> tombstones;
+    Status s = cfd_->table_cache()->GetRangeTombstoneIterator(
+        read_options, cfd_->internal_comparator(), file_meta, &tombstones);
+    if (s.ok() && tombstones != nullptr && !tombstones->empty()) {
+      range_tombstones->push_back(std::move(tombstones));
+    }
+    return s;
+  };
+
+  Status s;
+  if (mutable_cf_options_.create_global_sec_index) {
+    // The plan is kept per thread, so that queries reuse its buffers
+    static thread_local SecIndexQueryPlan plan;
+    SearchGlobalSecIndex(read_options, &plan);
+    for (size_t i = 0; s.ok() && i < plan.num_files(); i++) {
+      const SecIndexFilePlan& file_plan = plan.file(i);
+      auto file_loc = storage_info_.GetFileLocation(file_plan.file_number);
+      if (file_loc.GetLevel() == -1) {
+        continue;
+      }
+      const auto& file = storage_info_.LevelFilesBrief(file_loc.GetLevel())
+                             .files[file_loc.GetPosition()];
+      s = add_file(*file.file_metadata, &file_plan, /*level=*/0);
+    }
+  } else {
+    for (int level = 0; s.ok() && level < storage_info_.num_non_empty_levels();
+         level++) {
+      const LevelFilesBrief& files = storage_info_.LevelFilesBrief(level);
+      for (size_t i = 0; s.ok() && i < files.num_files; i++) {
+        s = add_file(*files.files[i].file_metadata, /*plan=*/nullptr, level);
+      }
+    }
+  }
+  return s;
+}
+
 void Version::AddIteratorsForLevel(const ReadOptions& read_options,
                                    const FileOptions& soptions,
                                    MergeIteratorBuilder* merge_iter_builder,
@@ -1943,95 +2120,62 @@ void Version::AddIteratorsForLevel(const ReadOptions& read_options,
   // When global secondary index is activated
   // the iterator for level will be created based on the outputs from
   // global secondary index
-  if(mutable_cf_options_.create_global_sec_index) {
-    
-    // getting the search range
-    RtreeIteratorContext* context = 
-        reinterpret_cast<RtreeIteratorContext*>(read_options.iterator_context);
-    Slice query_slice(context->query_mbr);
-    std::vector<GlobalSecIndexValue> hittedFiles;
-    if (mutable_cf_options_.global_sec_index_is_spatial) {
-      Mbr query_mbr = ReadSecQueryMbr(query_slice);
-      Rect query_rect(query_mbr.first.min, query_mbr.second.min, query_mbr.first.max, query_mbr.second.max);
-      hittedFiles = global_rtree_->Search(query_rect.min, query_rect.max, GlobalRTreeCallback);
-    } else {
-      ValueRange query_valrange = ReadValueRange(query_slice);
-      Rect1D query_rect1D(query_valrange.range.min, query_valrange.range.max);
-      hittedFiles = global_rtree_->Search(query_rect1D.min, query_rect1D.max, GlobalRTreeCallback);
-    }
+  if (mutable_cf_options_.create_global_sec_index &&
+      read_options.is_secondary_index_scan) {
 
-    // iterating through the return vector
-    // find the level and position of each file and 
-    // create the respective table_iter
+    // The plan is kept per thread, so that queries reuse its buffers
+    static thread_local SecIndexQueryPlan plan;
+    SearchGlobalSecIndex(read_options, &plan);
+
+    // iterating through the planned files,
+    // find the level and position of each file and
+    // create the respective table_iter, which reads the planned
+    // partitions of its file in offset order
     TruncatedRangeDelIterator* tombstone_iter = nullptr;
-    // int n_hits = static_cast<int>(hittedFiles.size());
-    // std::cout << "return hits: " << n_hits << std::endl;    
-
-    std::map<uint64_t, std::vector<BlockHandle>> filenum_2_blkhandle;
-    std::vector<uint64_t> hitfilenum;
-    for (const GlobalSecIndexValue& hf :hittedFiles){
-      // hitfilenum.emplace_back(hf.filenum);
-      filenum_2_blkhandle[hf.filenum].emplace_back(hf.blkhandle);
-    }
-
-    // std::sort(hitfilenum.begin(),hitfilenum.end());
-    // hitfilenum.erase(std::unique(hitfilenum.begin(),hitfilenum.end()),hitfilenum.end());
-    // std::cout << "Found file number: " << static_cast<int>(hitfilenum.size()) << std::endl;
-
-    std::set<std::pair<uint64_t, u_int64_t>> seenBlkHandle;
-
-    for (std::map<uint64_t, std::vector<BlockHandle>>::iterator mit = filenum_2_blkhandle.begin(); mit != filenum_2_blkhandle.end(); ++mit) {
-    // for (int i = 0; i < static_cast<int>(hitfilenum.size()); i++) {
-      // find the file_number of the hitted file
-      // uint64_t hfile_number = hittedFiles[i].second;
-      // uint64_t hfile_number = hitfilenum[i];
-      uint64_t hfile_number = mit->first;
-      // std::cout << hfile_number << std::endl;
-
-      // for (const BlockHandle& bh: filenum_2_blkhandle[hfile_number]) {
-      for (const BlockHandle& bh: mit->second) {
-        uint64_t offset_bh = bh.offset();
-        uint64_t size_bh = bh.size();
-        if (seenBlkHandle.find(std::make_pair(offset_bh, size_bh)) != seenBlkHandle.end()) {
-          continue;
-        } else {
-          read_options.found_sec_blkhandle->emplace_back(std::make_pair(offset_bh, size_bh));
-          seenBlkHandle.insert(std::make_pair(offset_bh, size_bh));
-        }
-        // read_options.found_sec_blkhandle->emplace_back(std::make_pair(offset_bh, size_bh));
-      }
-      seenBlkHandle.clear();
-      // std::cout << "found_sec_blkhandle size: " << read_options.found_sec_blkhandle->size() << std::endl;
+    // Files without range tombstones are scanned concurrently when the
+    // query asks for it, since nothing has to be merged
+    const bool fan_out =
+        read_options.sec_query_parallelism > 1 && plan.num_files() > 1;
+    std::vector<InternalIterator*> fan_out_iters;
+    for (size_t i = 0; i < plan.num_files(); i++) {
+      const SecIndexFilePlan& file_plan = plan.file(i);
+      const uint64_t hfile_number = file_plan.file_number;
 
-     
       // std::cout << "file number:" << hfile_number << std::endl;
       // get the file location
       // file_level: location.GetLevel()
       // file_position: location.GetPosition()
       auto hfile_loc = storage_info_.GetFileLocation(hfile_number);
       if (hfile_loc.GetLevel() == -1) {
-        read_options.found_sec_blkhandle->clear();
         continue;
       } 
       // create the iterator
       const auto& file = storage_info_.LevelFilesBrief(hfile_loc.GetLevel()).files[hfile_loc.GetPosition()];
-      auto table_iter = cfd_->table_cache()->NewIterator(
-          read_options, soptions, cfd_->internal_sec_comparator(),
-          *file.file_metadata, /*range_del_agg=*/nullptr,
-          mutable_cf_options_.prefix_extractor, nullptr,
-          cfd_->internal_stats()->GetFileReadHist(0),
-          TableReaderCaller::kUserIterator, arena,
-          /*skip_filters=*/false, /*level=*/0, max_file_size_for_l0_meta_pin_,
-          /*smallest_compaction_key=*/nullptr,
-          /*largest_compaction_key=*/nullptr, allow_unprepared_value,
-          &tombstone_iter);    
-      if (read_options.ignore_range_deletions) {
+      auto table_iter = NewSecIndexTableIterator(
+          read_options, soptions, *file.file_metadata, &file_plan,
+          /*level=*/0, arena, allow_unprepared_value, &tombstone_iter);
+      if (fan_out && tombstone_iter == nullptr) {
+        fan_out_iters.push_back(table_iter);
+      } else if (read_options.ignore_range_deletions) {
         merge_iter_builder->AddIterator(table_iter);
       } else {
         merge_iter_builder->AddPointAndTombstoneIterator(table_iter,
                                                         tombstone_iter);
         } 
-      read_options.found_sec_blkhandle->clear();       
+    }
+    if (!fan_out_iters.empty()) {
+      InternalIterator* fan_out_iter =
+          fan_out_iters.size() == 1
+              ? fan_out_iters[0]
+              : NewSecFanOutIterator(cfd_->ioptions()->env,
+                                     fan_out_iters.data(), fan_out_iters.size(),
+                                     read_options.sec_query_parallelism, arena);
+      if (read_options.ignore_range_deletions) {
+        merge_iter_builder->AddIterator(fan_out_iter);
+      } else {
+        merge_iter_builder->AddPointAndTombstoneIterator(
+            fan_out_iter, /*tombstone_iter=*/nullptr);
+      }
     }
   } else {
     if (level == 0) {
@@ -2240,9 +2384,7 @@ Version::Version(ColumnFamilyData* column_family_data, VersionSet* vset,
           // TODO(PepperBun) based on the secondary index type
           // the global_sec_index shall load different files
           // global_rtree_.Load(mutable_cf_options.global_sec_index_loc);
-          global_rtree_ = &vset->global_rtree_;
-          // global_rtree_(vset->global_rtree_);
-          // global_rtree_.Load(vset->global_rtree_loc_);
+          global_rtree_ = vset->global_rtree_snapshot_;
         }
       }
 
@@ -2560,7 +2702,7 @@ void Version::MultiGet(const ReadOptions& read_options, MultiGetRange* range,
         iter->s->ok() ? GetContext::kNotFound : GetContext::kMerge,
         iter->ukey_with_ts, iter->value, /*columns=*/nullptr, iter->timestamp,
         nullptr, &(iter->merge_context), true,
-        &iter->max_covering_tombstone_seq, clock_, nullptr,
+        &iter->max_covering_tombstone_seq, clock_, iter->seq,
         merge_operator_ ? &pinned_iters_mgr : nullptr, callback,
         &iter->is_blob_index, tracing_mget_id, &blob_fetcher);
     // MergeInProgress status, if set, has been transferred to the get_context
@@ -5373,10 +5515,17 @@ VersionSet::VersionSet(const std::string& dbname,
       block_cache_tracer_(block_cache_tracer),
       io_tracer_(io_tracer),
       db_session_id_(db_session_id) {
-        global_rtree_.Load(global_rtree_loc_);
-      }
+  PublishGlobalSecIndex();
+}
 
 VersionSet::~VersionSet() {
+  {
+    // The repack and checkpoint jobs reference this VersionSet
+    MutexLock l(&repack_mu_);
+    while (repack_job_running_ || checkpoint_job_running_) {
+      repack_cv_.Wait();
+    }
+  }
   // we need to delete column_family_set_ because its destructor depends on
   // VersionSet
   column_family_set_.reset();
@@ -5389,8 +5538,6 @@ VersionSet::~VersionSet() {
   }
   obsolete_files_.clear();
   io_status_.PermitUncheckedError();
-
-  global_rtree_.Save(global_rtree_loc_);
 }
 
 void VersionSet::Reset() {
@@ -5422,7 +5569,13 @@ void VersionSet::Reset() {
   obsolete_files_.clear();
   obsolete_manifests_.clear();
   wals_.Reset();
-  global_rtree_.Load(global_rtree_loc_);
+  WaitForGlobalSecIndexCheckpoint();
+  global_rtree_.RemoveAll();
+  PublishGlobalSecIndex();
+  global_sec_index_log_.reset();
+  global_sec_index_generation_++;
+  global_sec_index_repacking_ = false;
+  global_sec_index_repack_deltas_.clear();
 }
 
 void VersionSet::AppendVersion(ColumnFamilyData* column_family_data,
@@ -5469,6 +5622,9 @@ Status VersionSet::ProcessManifestWrites(
   autovector<Version*> versions;
   autovector<const MutableCFOptions*> mutable_cf_options_ptrs;
   std::vector<std::unique_ptr<BaseReferencedVersionBuilder>> builder_guards;
+  // Changes made to global_rtree_ by this batch, to be persisted alongside
+  // the MANIFEST records.
+  std::vector<GlobalSecIndexDelta> global_sec_deltas;
 
   // Tracking `max_last_sequence` is needed to ensure we write
   // `VersionEdit::last_sequence_`s in non-decreasing order according to the
@@ -5482,6 +5638,7 @@ Status VersionSet::ProcessManifestWrites(
     LogAndApplyCFHelper(first_writer.edit_list.front(), &max_last_sequence);
     batch_edits.push_back(first_writer.edit_list.front());
   } else {
+    InstallRepackedGlobalSecIndex();
     auto it = manifest_writers_.cbegin();
     size_t group_start = std::numeric_limits<size_t>::max();
     while (it != manifest_writers_.cend()) {
@@ -5567,8 +5724,9 @@ Status VersionSet::ProcessManifestWrites(
         } else if (group_start != std::numeric_limits<size_t>::max()) {
           group_start = std::numeric_limits<size_t>::max();
         }
-        Status s = LogAndApplyHelper(last_writer->cfd, builder, e,
-                                     &max_last_sequence, mu);
+        Status s = LogAndApplyHelper(
+            last_writer->cfd, builder, e, &max_last_sequence, mu,
+            global_sec_index_log_ ? &global_sec_deltas : nullptr);
         if (!s.ok()) {
           // free up the allocated memory
           for (auto v : versions) {
@@ -5592,6 +5750,15 @@ Status VersionSet::ProcessManifestWrites(
         return s;
       }
     }
+    // The new versions see the global secondary index with this batch
+    // applied; readers of older versions keep their own snapshot.
+    PublishGlobalSecIndex();
+    for (auto v : versions) {
+      if (v->global_rtree_) {
+        v->global_rtree_ = global_rtree_snapshot_;
+      }
+    }
+    MaybeRepackGlobalSecIndex(global_sec_deltas);
   }
 
 #ifndef NDEBUG
@@ -5736,6 +5903,27 @@ Status VersionSet::ProcessManifestWrites(
         }
       }
 
+      // Persist the global index insertions before the MANIFEST records that
+      // make their files live. Removals are persisted after the MANIFEST has
+      // been synced, see below. This holds even when a checkpoint is due:
+      // the checkpoint is only written after the MANIFEST, and a crash in
+      // between must not leave live files without index entries.
+      if (global_sec_index_log_) {
+        std::vector<GlobalSecIndexDelta> inserts;
+        for (const auto& delta : global_sec_deltas) {
+          if (delta.op == GlobalSecIndexDelta::kInsert) {
+            inserts.push_back(delta);
+          }
+        }
+        io_s = global_sec_index_log_->AppendDeltas(inserts, true /* sync */);
+        if (!io_s.ok()) {
+          s = io_s;
+          ROCKS_LOG_ERROR(db_options_->info_log,
+                          "Global secondary index log write %s\n",
+                          s.ToString().c_str());
+        }
+      }
+
       // Write new records to MANIFEST log
 #ifndef NDEBUG
       size_t idx = 0;
@@ -5797,6 +5985,29 @@ Status VersionSet::ProcessManifestWrites(
       new_manifest_file_size = descriptor_log_->file()->GetFileSize();
     }
 
+    if (s.ok() && global_sec_index_log_ && !global_sec_deltas.empty()) {
+      std::vector<GlobalSecIndexDelta> removes;
+      for (const auto& delta : global_sec_deltas) {
+        if (delta.op == GlobalSecIndexDelta::kRemove) {
+          removes.push_back(delta);
+        }
+      }
+      // The edit is already durable, so a failure here must not fail it. The
+      // log abandons its file instead and the next batch starts a new
+      // checkpoint; until that is written, a reopen reconciles the index
+      // with the recovered versions.
+      IOStatus index_io_s =
+          global_sec_index_log_->AppendDeltas(removes, true /* sync */);
+      if (!index_io_s.ok()) {
+        ROCKS_LOG_ERROR(db_options_->info_log,
+                        "Global secondary index log write %s\n",
+                        index_io_s.ToString().c_str());
+      }
+      if (global_sec_index_log_->NeedsCheckpoint()) {
+        ScheduleGlobalSecIndexCheckpoint();
+      }
+    }
+
     if (first_writer.edit_list.front()->is_column_family_drop_) {
       TEST_SYNC_POINT("VersionSet::LogAndApply::ColumnFamilyDrop:0");
       TEST_SYNC_POINT("VersionSet::LogAndApply::ColumnFamilyDrop:1");
@@ -6109,7 +6320,9 @@ void VersionSet::LogAndApplyCFHelper(VersionEdit* edit,
 Status VersionSet::LogAndApplyHelper(ColumnFamilyData* cfd,
                                      VersionBuilder* builder, VersionEdit* edit,
                                      SequenceNumber* max_last_sequence,
-                                     InstrumentedMutex* mu) {
+                                     InstrumentedMutex* mu,
+                                     std::vector<GlobalSecIndexDelta>*
+                                         global_sec_deltas) {
 #ifdef NDEBUG
   (void)cfd;
 #endif
@@ -6138,7 +6351,8 @@ Status VersionSet::LogAndApplyHelper(ColumnFamilyData* cfd,
   assert(builder || edit->IsWalManipulation());
   // return builder ? builder->Apply(edit) : Status::OK();
   // std::cout << "log and apply" << std::endl;
-  return builder ? builder->Apply(edit, &global_rtree_) : Status::OK();
+  return builder ? builder->Apply(edit, &global_rtree_, global_sec_deltas)
+                 : Status::OK();
 }
 
 Status VersionSet::GetCurrentManifestPath(const std::string& dbname,
@@ -6245,9 +6459,625 @@ Status VersionSet::Recover(
     }
   }
 
+  if (s.ok()) {
+    s = RecoverGlobalSecIndex(read_only);
+  }
+
   return s;
 }
 
+Status VersionSet::RecoverGlobalSecIndex(bool read_only) {
+  const ImmutableCFOptions* ioptions = nullptr;
+  for (auto cfd : *column_family_set_) {
+    if (!cfd->IsDropped() && cfd->ioptions()->global_sec_index) {
+      ioptions = cfd->ioptions();
+      break;
+    }
+  }
+  WaitForGlobalSecIndexCheckpoint();
+  global_rtree_.RemoveAll();
+  global_sec_index_log_.reset();
+  global_sec_index_generation_++;
+  global_sec_index_churn_ = 0;
+  global_sec_index_repacking_ = false;
+  global_sec_index_repack_deltas_.clear();
+  global_sec_index_packed_bytes_ = 0;
+  global_sec_index_cache_res_mgr_.reset();
+  if (ioptions == nullptr) {
+    return Status::OK();
+  }
+  global_sec_index_repack_threshold_ =
+      ioptions->global_sec_index_repack_threshold;
+  global_sec_index_memory_budget_ = ioptions->global_sec_index_memory_budget;
+
+  if (ioptions->table_factory->IsInstanceOf(
+          TableFactory::kBlockBasedTableName()) &&
+      ioptions->table_factory->GetOptions<BlockBasedTableOptions>()) {
+    const BlockBasedTableOptions* bbto =
+        ioptions->table_factory->GetOptions<BlockBasedTableOptions>();
+    const auto& options_overrides = bbto->cache_usage_options.options_overrides;
+    const auto global_sec_index_charged =
+        options_overrides.at(CacheEntryRole::kGlobalSecIndex).charged;
+    if (bbto->block_cache && global_sec_index_charged ==
+                                 CacheEntryRoleOptions::Decision::kEnabled) {
+      global_sec_index_cache_res_mgr_.reset(
+          new CacheReservationManagerImpl<CacheEntryRole::kGlobalSecIndex>(
+              bbto->block_cache));
+    }
+  }
+
+  const std::string dir = ioptions->global_index_loc != nullptr
+                              ? std::string(ioptions->global_index_loc)
+                              : dbname_;
+  global_sec_index_log_.reset(new GlobalSecIndexLog(
+      dir, fs_.get(), db_options_, file_options_,
+      ioptions->global_sec_index_checkpoint_interval));
+
+  bool found = false;
+  GlobalSecIndexReplayer replayer(&global_rtree_);
+  Status s = global_sec_index_log_->Recover(
+      [this, &replayer]() {
+        replayer.Clear();
+        global_rtree_.RemoveAll();
+      },
+      [&replayer](const GlobalSecIndexDelta& delta) {
+        replayer.Replay(delta);
+      },
+      &found);
+  replayer.Flush();
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Drop the entries of files that never made it into the MANIFEST, or
+  // whose removal was not logged before a crash.
+  std::unordered_map<uint64_t, GlobalSecIndexRebuildFile> live_files;
+  for (auto cfd : *column_family_set_) {
+    if (cfd->IsDropped() || cfd->current() == nullptr ||
+        !cfd->ioptions()->global_sec_index) {
+      continue;
+    }
+    const auto* vstorage = cfd->current()->storage_info();
+    for (int level = 0; level < vstorage->num_levels(); level++) {
+      for (auto* f : vstorage->LevelFiles(level)) {
+        live_files.emplace(f->fd.GetNumber(),
+                           GlobalSecIndexRebuildFile{cfd, f, level});
+      }
+    }
+  }
+  // Rect covering the entries of every stale file, so that each file is
+  // dropped with a single RemoveIf
+  struct StaleFile {
+    GlobalSecRtree::ElemType min[GlobalSecRtree::DIMS];
+    GlobalSecRtree::ElemType max[GlobalSecRtree::DIMS];
+  };
+  std::unordered_map<uint64_t, StaleFile> stale_files;
+  size_t stale = 0;
+  std::unordered_set<uint64_t> indexed_files;
+  GlobalSecRtree::Iterator it;
+  for (global_rtree_.GetFirst(it); !global_rtree_.IsNull(it);
+       global_rtree_.GetNext(it)) {
+    const GlobalSecIndexValue& value = global_rtree_.GetAt(it);
+    if (live_files.count(value.filenum) == 0) {
+      GlobalSecRtree::ElemType min[GlobalSecRtree::DIMS];
+      GlobalSecRtree::ElemType max[GlobalSecRtree::DIMS];
+      it.GetBounds(min, max);
+      auto inserted = stale_files.emplace(value.filenum, StaleFile());
+      StaleFile& file = inserted.first->second;
+      for (int axis = 0; axis < GlobalSecRtree::DIMS; axis++) {
+        file.min[axis] =
+            inserted.second ? min[axis] : std::min(file.min[axis], min[axis]);
+        file.max[axis] =
+            inserted.second ? max[axis] : std::max(file.max[axis], max[axis]);
+      }
+      stale++;
+    } else {
+      indexed_files.insert(value.filenum);
+    }
+  }
+  for (const auto& file : stale_files) {
+    const uint64_t file_number = file.first;
+    global_rtree_.RemoveIf(file.second.min, file.second.max,
+                           [file_number](const GlobalSecIndexValue& value) {
+                             return value.filenum == file_number;
+                           });
+  }
+
+  std::vector<GlobalSecIndexRebuildFile> unindexed;
+  for (const auto& live_file : live_files) {
+    if (indexed_files.count(live_file.first) == 0) {
+      unindexed.push_back(live_file.second);
+    }
+  }
+  ROCKS_LOG_INFO(db_options_->info_log,
+                 "Global secondary index recovered (found log: %d), dropped "
+                 "%" ROCKSDB_PRIszt " stale entries, %" ROCKSDB_PRIszt
+                 " of %" ROCKSDB_PRIszt " live files have no entries\n",
+                 found, stale, unindexed.size(), live_files.size());
+  if (!unindexed.empty()) {
+    s = RebuildGlobalSecIndex(unindexed);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  // The recovered versions were created before the index was loaded
+  PublishGlobalSecIndex();
+  for (auto cfd : *column_family_set_) {
+    if (!cfd->IsDropped() && cfd->current() != nullptr &&
+        cfd->current()->global_rtree_) {
+      cfd->current()->global_rtree_ = global_rtree_snapshot_;
+    }
+  }
+
+  if (read_only) {
+    // Leave the log untouched; AppendDeltas() is a no-op without a
+    // checkpoint written by this instance.
+    return Status::OK();
+  }
+  // Start a fresh file so that the deltas replayed above are not replayed
+  // again, and so that no stale entry can come back.
+  return WriteGlobalSecIndexCheckpoint(global_rtree_);
+}
+
+void VersionSet::PublishGlobalSecIndex() {
+  global_rtree_snapshot_ = std::make_shared<GlobalSecRtree>(
+      global_rtree_, GlobalSecRtree::ShareTag());
+  UpdateGlobalSecIndexCacheReservation();
+}
+
+void VersionSet::UpdateGlobalSecIndexCacheReservation() {
+  if (!global_sec_index_cache_res_mgr_) {
+    return;
+  }
+  // Failing to reserve does not fail the write, the index has to stay
+  // consistent with the MANIFEST. global_sec_index_memory_budget is what
+  // bounds it.
+  Status s = global_sec_index_cache_res_mgr_->UpdateCacheReservation(
+      global_rtree_.NodeMemoryUsage());
+  if (!s.ok()) {
+    ROCKS_LOG_WARN(db_options_->info_log,
+                   "Global secondary index cache reservation: %s\n",
+                   s.ToString().c_str());
+  }
+}
+
+void VersionSet::GlobalSecIndexReplayer::Replay(
+    const GlobalSecIndexDelta& delta) {
+  if (!pending_mins_.empty() && (delta.op != GlobalSecIndexDelta::kRemove ||
+                                 delta.value.filenum != pending_file_)) {
+    Flush();
+  }
+  GlobalSecRtree::ElemType min[GlobalSecRtree::DIMS];
+  GlobalSecRtree::ElemType max[GlobalSecRtree::DIMS];
+  GlobalSecRtree::NarrowRect(delta.min, delta.max, min, max);
+  if (delta.op == GlobalSecIndexDelta::kInsert) {
+    rtree_->Insert(min, max, delta.value);
+    return;
+  }
+  pending_mins_.insert(pending_mins_.end(), min, min + GlobalSecRtree::DIMS);
+  pending_maxs_.insert(pending_maxs_.end(), max, max + GlobalSecRtree::DIMS);
+  pending_file_ = delta.value.filenum;
+}
+
+void VersionSet::GlobalSecIndexReplayer::Flush() {
+  if (pending_mins_.empty()) {
+    return;
+  }
+  const uint64_t file_number = pending_file_;
+  rtree_->RemoveIf(pending_mins_.data(), pending_maxs_.data(),
+                   pending_mins_.size() / GlobalSecRtree::DIMS,
+                   [file_number](const GlobalSecIndexValue& value) {
+                     return value.filenum == file_number;
+                   });
+  Clear();
+}
+
+void VersionSet::MaybeRepackGlobalSecIndex(
+    const std::vector<GlobalSecIndexDelta>& deltas) {
+  if (deltas.empty()) {
+    return;
+  }
+  global_sec_index_churn_ += deltas.size();
+  if (global_sec_index_repacking_) {
+    // The snapshot being repacked predates these changes
+    global_sec_index_repack_deltas_.insert(
+        global_sec_index_repack_deltas_.end(), deltas.begin(), deltas.end());
+    return;
+  }
+  const size_t bytes = global_rtree_.NodeMemoryUsage();
+  const bool over_budget =
+      global_sec_index_memory_budget_ > 0 &&
+      bytes > global_sec_index_memory_budget_ &&
+      bytes > global_sec_index_packed_bytes_ +
+                  global_sec_index_packed_bytes_ / 4;
+  if (!over_budget && (global_sec_index_repack_threshold_ == 0 ||
+                       global_sec_index_churn_ <
+                           global_sec_index_repack_threshold_)) {
+    return;
+  }
+
+  global_sec_index_repacking_ = true;
+  {
+    MutexLock l(&repack_mu_);
+    repack_job_running_ = true;
+  }
+  auto* job = new GlobalSecIndexRepackJob{
+      this, global_rtree_snapshot_, global_sec_index_generation_,
+      global_sec_index_memory_budget_};
+  ROCKS_LOG_INFO(db_options_->info_log,
+                 "Scheduling repack of the global secondary index after "
+                 "%" PRIu64 " changes, %" ROCKSDB_PRIszt " bytes\n",
+                 global_sec_index_churn_, bytes);
+  db_options_->env->Schedule(&VersionSet::BGWorkRepackGlobalSecIndex, job,
+                             Env::Priority::LOW, this);
+}
+
+void VersionSet::BGWorkRepackGlobalSecIndex(void* arg) {
+  std::unique_ptr<GlobalSecIndexRepackJob> job(
+      static_cast<GlobalSecIndexRepackJob*>(arg));
+  job->vset->RepackGlobalSecIndex(std::move(job->snapshot), job->generation,
+                                  job->memory_budget);
+  TEST_SYNC_POINT("VersionSet::BGWorkRepackGlobalSecIndex:Done");
+}
+
+void VersionSet::RepackGlobalSecIndex(
+    std::shared_ptr<const GlobalSecRtree> snapshot, uint64_t generation,
+    uint64_t memory_budget) {
+  const uint64_t start_micros = clock_->NowMicros();
+  const GlobalSecRtree::OverlapStats before = snapshot->GetOverlapStats();
+
+  std::vector<GlobalSecRtree::BulkEntry> entries;
+  entries.reserve(before.m_entries);
+  GlobalSecRtree::Iterator it;
+  for (snapshot->GetFirst(it); !snapshot->IsNull(it); snapshot->GetNext(it)) {
+    GlobalSecRtree::BulkEntry entry;
+    it.GetBounds(entry.m_min, entry.m_max);
+    entry.m_data = *it;
+    entries.push_back(entry);
+  }
+  snapshot.reset();
+  std::unique_ptr<GlobalSecRtree> repacked(
+      new GlobalSecRtree(entries, GlobalSecRtree::kSortTileRecursive));
+
+  // Over budget: merge as many adjacent entries of each file as it takes for
+  // the node bytes to shrink under the budget, and pack again. Files with
+  // fewer entries than the merge factor shrink less, so this is repeated
+  // until the result fits.
+  size_t coarsen_factor = 1;
+  while (memory_budget > 0 &&
+         repacked->NodeMemoryUsage() > memory_budget &&
+         entries.size() > 1) {
+    const size_t bytes = repacked->NodeMemoryUsage();
+    coarsen_factor = std::max<size_t>(
+        2, static_cast<size_t>(
+               (bytes + memory_budget - 1) / memory_budget));
+    const size_t num_entries = entries.size();
+    CoarsenGlobalSecIndexEntries(&entries, coarsen_factor);
+    repacked.reset();
+    repacked.reset(
+        new GlobalSecRtree(entries, GlobalSecRtree::kSortTileRecursive));
+    ROCKS_LOG_INFO(db_options_->info_log,
+                   "Coarsened global secondary index by %" ROCKSDB_PRIszt
+                   ": %" ROCKSDB_PRIszt " -> %" ROCKSDB_PRIszt
+                   " entries, %" ROCKSDB_PRIszt " -> %" ROCKSDB_PRIszt
+                   " bytes, budget %" PRIu64 "\n",
+                   coarsen_factor, num_entries, entries.size(), bytes,
+                   repacked->NodeMemoryUsage(), memory_budget);
+    if (entries.size() == num_entries) {
+      // Every file is down to a single entry
+      break;
+    }
+  }
+  const GlobalSecRtree::OverlapStats after = repacked->GetOverlapStats();
+
+  ROCKS_LOG_INFO(db_options_->info_log,
+                 "Repacked global secondary index of %" ROCKSDB_PRIszt
+                 " entries in %" PRIu64 " us: nodes %" ROCKSDB_PRIszt
+                 " -> %" ROCKSDB_PRIszt ", height %d -> %d, node overlap "
+                 "ratio %.4f -> %.4f\n",
+                 after.m_entries, clock_->NowMicros() - start_micros,
+                 before.m_nodes, after.m_nodes, before.m_height,
+                 after.m_height, before.OverlapRatio(), after.OverlapRatio());
+
+  MutexLock l(&repack_mu_);
+  repacked_global_rtree_ = std::move(repacked);
+  repacked_generation_ = generation;
+  repack_job_running_ = false;
+  repack_cv_.SignalAll();
+}
+
+void VersionSet::InstallRepackedGlobalSecIndex() {
+  if (!global_sec_index_repacking_) {
+    return;
+  }
+  std::unique_ptr<GlobalSecRtree> repacked;
+  {
+    MutexLock l(&repack_mu_);
+    if (repack_job_running_) {
+      return;
+    }
+    if (repacked_generation_ == global_sec_index_generation_) {
+      repacked = std::move(repacked_global_rtree_);
+    }
+    repacked_global_rtree_.reset();
+  }
+  global_sec_index_repacking_ = false;
+  if (repacked) {
+    // Catch up with the changes made while the job ran
+    {
+      GlobalSecIndexReplayer replayer(repacked.get());
+      for (const auto& delta : global_sec_index_repack_deltas_) {
+        replayer.Replay(delta);
+      }
+    }
+    global_rtree_.ShareFrom(*repacked);
+    global_sec_index_churn_ = global_sec_index_repack_deltas_.size();
+    global_sec_index_packed_bytes_ = global_rtree_.NodeMemoryUsage();
+    ROCKS_LOG_INFO(db_options_->info_log,
+                   "Installed repacked global secondary index, replayed "
+                   "%" ROCKSDB_PRIszt " changes\n",
+                   global_sec_index_repack_deltas_.size());
+  }
+  global_sec_index_repack_deltas_.clear();
+}
+
+void VersionSet::CoarsenGlobalSecIndexEntries(
+    std::vector<GlobalSecRtree::BulkEntry>* entries, size_t factor) {
+  // The entries of a file, single or already merged, in entry order
+  std::sort(entries->begin(), entries->end(),
+            [](const GlobalSecRtree::BulkEntry& a,
+               const GlobalSecRtree::BulkEntry& b) {
+              return std::make_pair(a.m_data.filenum, a.m_data.id) <
+                     std::make_pair(b.m_data.filenum, b.m_data.id);
+            });
+  size_t out = 0;
+  for (size_t i = 0; i < entries->size();) {
+    GlobalSecRtree::BulkEntry merged = (*entries)[i];
+    uint64_t end = static_cast<uint64_t>(merged.m_data.id) +
+                   merged.m_data.count;
+    size_t j = i + 1;
+    for (; j < entries->size() && j - i < factor &&
+           (*entries)[j].m_data.filenum == merged.m_data.filenum;
+         j++) {
+      const GlobalSecRtree::BulkEntry& next = (*entries)[j];
+      for (int axis = 0; axis < GlobalSecRtree::DIMS; axis++) {
+        merged.m_min[axis] = std::min(merged.m_min[axis], next.m_min[axis]);
+        merged.m_max[axis] = std::max(merged.m_max[axis], next.m_max[axis]);
+      }
+      end = std::max(end, static_cast<uint64_t>(next.m_data.id) +
+                              next.m_data.count);
+    }
+    merged.m_data.count =
+        static_cast<uint32_t>(end - static_cast<uint64_t>(merged.m_data.id));
+    (*entries)[out++] = merged;
+    i = j;
+  }
+  entries->resize(out);
+}
+
+Status VersionSet::RebuildGlobalSecIndex(
+    std::vector<GlobalSecIndexRebuildFile>& files) {
+  const uint64_t start_micros = clock_->NowMicros();
+
+  // Read the secondary index blocks of the files in parallel, unless the
+  // MANIFEST already carried their entries. Every thread only touches the
+  // FileMetaData of the files it picked.
+  ReadOptions read_options;
+  read_options.fill_cache = false;
+  std::vector<Status> statuses(files.size());
+  std::atomic<size_t> next_file_idx(0);
+  std::function<void()> load_entries_func([&]() {
+    while (true) {
+      size_t file_idx = next_file_idx.fetch_add(1);
+      if (file_idx >= files.size()) {
+        break;
+      }
+      ColumnFamilyData* cfd = files[file_idx].cfd;
+      FileMetaData* meta = files[file_idx].meta;
+      const int level = files[file_idx].level;
+      if (cfd->ioptions()->global_sec_index_is_spatial
+              ? !meta->SecondaryEntries.empty()
+              : !meta->SecValrange.empty()) {
+        continue;
+      }
+
+      Cache::Handle* handle = nullptr;
+      Status s = cfd->table_cache()->FindTable(
+          read_options, file_options_, cfd->internal_comparator(), *meta,
+          &handle, cfd->GetLatestMutableCFOptions()->prefix_extractor,
+          false /* no_io */, true /* record_read_stats */,
+          nullptr /* file_read_hist */, true /* skip_filters */, level,
+          false /* prefetch_index_and_filter_in_cache */,
+          0 /* max_file_size_for_l0_meta_pin */, meta->temperature);
+      if (s.ok()) {
+        std::vector<std::pair<std::string, BlockHandle>> sec_entries;
+        s = cfd->table_cache()
+                ->GetTableReaderFromHandle(handle)
+                ->GetSecondaryEntries(read_options, &sec_entries);
+        if (s.ok()) {
+          meta->SecondaryEntries.clear();
+          meta->SecValrange.clear();
+          s = meta->UpdateSecEntries(sec_entries);
+        }
+        cfd->table_cache()->ReleaseHandle(handle);
+      }
+      statuses[file_idx] = s;
+    }
+  });
+
+  const int max_threads =
+      std::max(1, std::min(db_options_->max_file_opening_threads,
+                           static_cast<int>(files.size())));
+  std::vector<port::Thread> threads;
+  for (int i = 1; i < max_threads; i++) {
+    threads.emplace_back(load_entries_func);
+  }
+  load_entries_func();
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    if (statuses[i].IsNotSupported()) {
+      // Written without a secondary index, nothing to load
+      ROCKS_LOG_WARN(db_options_->info_log,
+                     "File %" PRIu64 " has no secondary index: %s\n",
+                     files[i].meta->fd.GetNumber(),
+                     statuses[i].ToString().c_str());
+    } else if (!statuses[i].ok()) {
+      ROCKS_LOG_ERROR(db_options_->info_log,
+                      "Failed to rebuild global secondary index entries of "
+                      "file %" PRIu64 ": %s\n",
+                      files[i].meta->fd.GetNumber(),
+                      statuses[i].ToString().c_str());
+      return statuses[i];
+    }
+  }
+
+  // Bulk load the recovered entries together with the new ones; the ids
+  // match the ones VersionBuilder::Apply assigns.
+  std::vector<GlobalSecRtree::BulkEntry> entries;
+  GlobalSecRtree::Iterator it;
+  for (global_rtree_.GetFirst(it); !global_rtree_.IsNull(it);
+       global_rtree_.GetNext(it)) {
+    GlobalSecRtree::BulkEntry entry;
+    it.GetBounds(entry.m_min, entry.m_max);
+    entry.m_data = *it;
+    entries.push_back(entry);
+  }
+  for (const auto& file : files) {
+    const uint64_t file_number = file.meta->fd.GetNumber();
+    if (!file.cfd->ioptions()->global_sec_index_is_spatial) {
+      int id = 0;
+      for (const auto& sec_entry : file.meta->SecValrange) {
+        Rect1D rect(sec_entry.first.range.min, sec_entry.first.range.max);
+        GlobalSecRtree::BulkEntry entry;
+        GlobalSecRtree::NarrowRect(rect.min, rect.max, entry.m_min,
+                                   entry.m_max);
+        entry.m_data = GlobalSecIndexValue(id++, file_number);
+        entries.push_back(entry);
+      }
+    } else {
+      int id = 0;
+      for (const auto& sec_entry : file.meta->SecondaryEntries) {
+        const Mbr& mbr = sec_entry.first;
+        Rect rect(mbr.first.min, mbr.second.min, mbr.first.max,
+                  mbr.second.max);
+        GlobalSecRtree::BulkEntry entry;
+        GlobalSecRtree::NarrowRect(rect.min, rect.max, entry.m_min,
+                                   entry.m_max);
+        entry.m_data = GlobalSecIndexValue(id++, file_number);
+        entries.push_back(entry);
+      }
+    }
+  }
+  global_rtree_.BulkLoad(entries);
+
+  ROCKS_LOG_INFO(db_options_->info_log,
+                 "Rebuilt global secondary index entries of %" ROCKSDB_PRIszt
+                 " files with %d threads in %" PRIu64
+                 " us, index holds %" ROCKSDB_PRIszt " entries\n",
+                 files.size(), max_threads,
+                 clock_->NowMicros() - start_micros, entries.size());
+  return Status::OK();
+}
+
+namespace {
+// Writes the entries of `rtree` into the checkpoint begun on `log` and
+// finishes it, or gives it up on failure.
+IOStatus CompleteGlobalSecIndexCheckpoint(
+    const VersionSet::GlobalSecRtree& rtree, GlobalSecIndexLog* log) {
+  using GlobalSecRtree = VersionSet::GlobalSecRtree;
+  IOStatus io_s;
+  GlobalSecRtree::Iterator it;
+  for (rtree.GetFirst(it); io_s.ok() && !rtree.IsNull(it); rtree.GetNext(it)) {
+    GlobalSecRtree::ElemType bounds_min[GlobalSecRtree::DIMS];
+    GlobalSecRtree::ElemType bounds_max[GlobalSecRtree::DIMS];
+    it.GetBounds(bounds_min, bounds_max);
+    // Widening the rounded bounds is exact, so a recovered index has the
+    // same bounds
+    double min[GlobalSecRtree::DIMS];
+    double max[GlobalSecRtree::DIMS];
+    std::copy(bounds_min, bounds_min + GlobalSecRtree::DIMS, min);
+    std::copy(bounds_max, bounds_max + GlobalSecRtree::DIMS, max);
+    io_s = log->AddCheckpointEntry(
+        GlobalSecIndexDelta(GlobalSecIndexDelta::kInsert, min, max,
+                            GlobalSecRtree::DIMS, *it));
+  }
+  if (io_s.ok()) {
+    io_s = log->FinishCheckpoint();
+  } else {
+    log->AbortCheckpoint();
+  }
+  return io_s;
+}
+}  // namespace
+
+IOStatus VersionSet::WriteGlobalSecIndexCheckpoint(
+    const GlobalSecRtree& rtree) {
+  assert(global_sec_index_log_);
+  IOStatus io_s = global_sec_index_log_->BeginCheckpoint();
+  if (!io_s.ok()) {
+    global_sec_index_log_->AbortCheckpoint();
+    return io_s;
+  }
+  return CompleteGlobalSecIndexCheckpoint(rtree, global_sec_index_log_.get());
+}
+
+void VersionSet::ScheduleGlobalSecIndexCheckpoint() {
+  assert(global_sec_index_log_);
+  {
+    MutexLock l(&repack_mu_);
+    if (checkpoint_job_running_) {
+      return;
+    }
+  }
+  // The published snapshot holds every delta appended so far; the ones
+  // appended from here on are queued by the log until the job finishes.
+  IOStatus io_s = global_sec_index_log_->BeginCheckpoint();
+  if (!io_s.ok()) {
+    global_sec_index_log_->AbortCheckpoint();
+    ROCKS_LOG_ERROR(db_options_->info_log,
+                    "Global secondary index checkpoint %s\n",
+                    io_s.ToString().c_str());
+    return;
+  }
+  {
+    MutexLock l(&repack_mu_);
+    checkpoint_job_running_ = true;
+  }
+  auto* job = new GlobalSecIndexCheckpointJob{this, global_rtree_snapshot_};
+  db_options_->env->Schedule(&VersionSet::BGWorkGlobalSecIndexCheckpoint, job,
+                             Env::Priority::LOW, this);
+}
+
+void VersionSet::BGWorkGlobalSecIndexCheckpoint(void* arg) {
+  std::unique_ptr<GlobalSecIndexCheckpointJob> job(
+      static_cast<GlobalSecIndexCheckpointJob*>(arg));
+  VersionSet* vset = job->vset;
+  IOStatus io_s = CompleteGlobalSecIndexCheckpoint(
+      *job->snapshot, vset->global_sec_index_log_.get());
+  job->snapshot.reset();
+  if (!io_s.ok()) {
+    // Retried with the next batch of deltas
+    ROCKS_LOG_ERROR(vset->db_options_->info_log,
+                    "Global secondary index checkpoint %s\n",
+                    io_s.ToString().c_str());
+  }
+  TEST_SYNC_POINT("VersionSet::BGWorkGlobalSecIndexCheckpoint:Done");
+
+  MutexLock l(&vset->repack_mu_);
+  vset->checkpoint_job_running_ = false;
+  vset->repack_cv_.SignalAll();
+}
+
+void VersionSet::WaitForGlobalSecIndexCheckpoint() {
+  MutexLock l(&repack_mu_);
+  while (checkpoint_job_running_) {
+    repack_cv_.Wait();
+  }
+}
+
 namespace {
 class ManifestPicker {
  public:
@@ -6761,7 +7591,8 @@ Status VersionSet::WriteCurrentStateToManifest(
                        f->marked_for_compaction, f->temperature,
                        f->oldest_blob_file_number, f->oldest_ancester_time,
                        f->file_creation_time, f->file_checksum,
-                       f->file_checksum_func_name, f->unique_id);
+                       f->file_checksum_func_name, f->unique_id, f->mbr,
+                       f->sketch, f->SecValrange, f->SecondaryEntries);
         }
       }
 
@@ -38,6 +38,7 @@
 #include "db/compaction/compaction_picker.h"
 #include "db/dbformat.h"
 #include "db/file_indexer.h"
+#include "db/global_sec_index/global_sec_index_log.h"
 #include "db/log_reader.h"
 #include "db/range_del_aggregator.h"
 #include "db/read_callback.h"
@@ -82,6 +83,9 @@ class ColumnFamilySet;
 class MergeIteratorBuilder;
 class SystemClock;
 class ManifestTailer;
+class SecIndexQueryPlan;
+struct SecIndexFilePlan;
+class FragmentedRangeTombstoneIterator;
 class FilePickerMultiGet;
 struct CompactionInputFiles;
 
@@ -842,6 +846,25 @@ class Version {
                     MergeIteratorBuilder* merger_iter_builder,
                     bool allow_unprepared_value);
 
+  // Plans the secondary index partitions to read for the query in
+  // `read_options.iterator_context`: those of the global secondary index
+  // entries overlapping it, grouped by file and sorted by offset. `plan` is
+  // cleared first; reusing it across queries saves the allocations.
+  void SearchGlobalSecIndex(const ReadOptions& read_options,
+                            SecIndexQueryPlan* plan) const;
+
+  // Appends to *iters an iterator over every table file a secondary index
+  // query in `read_options` has to read: the files picked by the global
+  // secondary index if there is one, all files otherwise. The iterators are
+  // allocated in `arena`. Unless `range_tombstones` is null, the range
+  // tombstones of the files are appended to it.
+  // @param read_options Must outlive the iterators.
+  Status AddSecondaryIndexIterators(
+      const ReadOptions& read_options, const FileOptions& soptions,
+      Arena* arena, std::vector<InternalIterator*>* iters,
+      std::vector<std::unique_ptr<FragmentedRangeTombstoneIterator>>*
+          range_tombstones);
+
   // @param read_options Must outlive any iterator built by
   // `merger_iter_builder`.
   void AddIteratorsForLevel(const ReadOptions& read_options,
@@ -1004,9 +1027,14 @@ class Version {
   // TODO(PepperBun) setting the variable based on the sec index type
   // Currently this may be mannually adjusted
   // (SecIndexType) Manually Changed is needed here
-  typedef RTree<GlobalSecIndexValue, double, 1, double> GlobalSecRtree;
-  GlobalSecRtree* global_rtree_;
-  // GlobalSecRtree global_rtree_;
+  // The bounds are stored as floats rounded outward (see
+  // GlobalSecRtree::NarrowRect), so searches are checked against the exact
+  // bounds kept in FileMetaData.
+  typedef RTree<GlobalSecIndexValue, float, 1, double> GlobalSecRtree;
+  // Snapshot of the global secondary index matching this version's files.
+  // It is immutable, so queries pinning this version through their
+  // SuperVersion search it without holding any lock.
+  std::shared_ptr<const GlobalSecRtree> global_rtree_;
 
  private:
   Env* env_;
@@ -1039,10 +1067,13 @@ class Version {
   // This accumulated stats will be used in compaction.
   void UpdateAccumulatedStats();
 
-  static bool GlobalRTreeCallback(GlobalSecIndexValue index_data) {
-    (void) index_data;
-    return true;
-  }
+  // Creates the iterator of a table file for a secondary index query,
+  // reading the partitions of `plan` if it is not null
+  InternalIterator* NewSecIndexTableIterator(
+      const ReadOptions& read_options, const FileOptions& soptions,
+      const FileMetaData& file_meta, const SecIndexFilePlan* plan, int level,
+      Arena* arena, bool allow_unprepared_value,
+      TruncatedRangeDelIterator** tombstone_iter);
 
   DECLARE_SYNC_AND_ASYNC(
       /* ret_type */ Status, /* func_name */ MultiGetFromSST,
@@ -1506,9 +1537,14 @@ class VersionSet {
   // TODO(PepperBun) setting the variable based on the sec index type
   // Currently this may be mannually adjusted
   // (SecIndexType) Manually Changed is needed here
-  typedef RTree<GlobalSecIndexValue, double, 1, double> GlobalSecRtree;
+  typedef RTree<GlobalSecIndexValue, float, 1, double> GlobalSecRtree;
   GlobalSecRtree global_rtree_;
-  const char* global_rtree_loc_ = "<<Global Index Component Directory>>";
+  // Copy-on-write snapshot of global_rtree_ handed to new versions. Only
+  // replaced with the DB mutex held.
+  std::shared_ptr<const GlobalSecRtree> global_rtree_snapshot_;
+  // Keeps global_rtree_ durable. Created by Recover() when any column family
+  // has create_global_sec_index set.
+  std::unique_ptr<GlobalSecIndexLog> global_sec_index_log_;
 
  protected:
   using VersionBuilderMap =
@@ -1645,7 +1681,136 @@ class VersionSet {
                            SequenceNumber* max_last_sequence);
   Status LogAndApplyHelper(ColumnFamilyData* cfd, VersionBuilder* b,
                            VersionEdit* edit, SequenceNumber* max_last_sequence,
-                           InstrumentedMutex* mu);
+                           InstrumentedMutex* mu,
+                           std::vector<GlobalSecIndexDelta>* global_sec_deltas =
+                               nullptr);
+
+  // Loads global_rtree_ from its log, drops the entries of files that are
+  // not part of any recovered version and rebuilds the entries of live files
+  // the log does not cover.
+  Status RecoverGlobalSecIndex(bool read_only);
+
+  struct GlobalSecIndexRebuildFile {
+    ColumnFamilyData* cfd;
+    FileMetaData* meta;
+    int level;
+  };
+
+  // Reads the secondary index blocks of `files` over
+  // max_file_opening_threads threads and bulk loads their entries into
+  // global_rtree_.
+  Status RebuildGlobalSecIndex(std::vector<GlobalSecIndexRebuildFile>& files);
+
+  // Takes a new snapshot of global_rtree_ for the versions created from now
+  // on. Only the nodes modified afterwards get copied. REQUIRES: DB mutex
+  // held, or single threaded recovery.
+  void PublishGlobalSecIndex();
+
+  // Counts the changes `deltas` made to global_rtree_ and starts a
+  // background repack once global_sec_index_repack_threshold is reached, or
+  // once global_rtree_ outgrows global_sec_index_memory_budget.
+  // While a repack runs, queues the changes so they can be replayed onto its
+  // result. REQUIRES: DB mutex held, called by the MANIFEST writer after
+  // publishing the batch.
+  void MaybeRepackGlobalSecIndex(
+      const std::vector<GlobalSecIndexDelta>& deltas);
+
+  // Swaps in the result of a finished repack job, if any. REQUIRES: DB mutex
+  // held, called by the MANIFEST writer before applying a batch.
+  void InstallRepackedGlobalSecIndex();
+
+  // Bulk loads a packed copy of `snapshot` and hands it over to
+  // InstallRepackedGlobalSecIndex(). If the copy takes more than
+  // `memory_budget` bytes, it is coarsened until it fits. Runs in the LOW
+  // priority pool.
+  struct GlobalSecIndexRepackJob {
+    VersionSet* vset;
+    std::shared_ptr<const GlobalSecRtree> snapshot;
+    uint64_t generation;
+    uint64_t memory_budget;
+  };
+  static void BGWorkRepackGlobalSecIndex(void* arg);
+  void RepackGlobalSecIndex(std::shared_ptr<const GlobalSecRtree> snapshot,
+                            uint64_t generation, uint64_t memory_budget);
+
+  // Merges every `factor` adjacent entries of the same file into one entry
+  // covering all of them, see GlobalSecIndexValue::count.
+  static void CoarsenGlobalSecIndexEntries(
+      std::vector<GlobalSecRtree::BulkEntry>* entries, size_t factor);
+
+  // Applies logged deltas to a global index in order. The removals of a
+  // file are always logged together; they are applied with one RemoveIf
+  // over their rects, which also drops the merged entries of the file that
+  // no logged value matches.
+  class GlobalSecIndexReplayer {
+   public:
+    explicit GlobalSecIndexReplayer(GlobalSecRtree* rtree) : rtree_(rtree) {}
+    ~GlobalSecIndexReplayer() { Flush(); }
+
+    void Replay(const GlobalSecIndexDelta& delta);
+    // Applies the pending removals
+    void Flush();
+    // Forgets the pending removals
+    void Clear() {
+      pending_mins_.clear();
+      pending_maxs_.clear();
+    }
+
+   private:
+    GlobalSecRtree* rtree_;
+    uint64_t pending_file_ = 0;
+    // Narrowed bounds of the pending removals, DIMS per removal
+    std::vector<GlobalSecRtree::ElemType> pending_mins_;
+    std::vector<GlobalSecRtree::ElemType> pending_maxs_;
+  };
+
+  // Charges the node bytes of global_rtree_ to the block cache, see
+  // CacheEntryRole::kGlobalSecIndex. Updated whenever a snapshot is
+  // published.
+  void UpdateGlobalSecIndexCacheReservation();
+
+  // Changes made to global_rtree_ since it was last packed.
+  uint64_t global_sec_index_churn_ = 0;
+  uint64_t global_sec_index_repack_threshold_ = 0;
+  // Set while a repack is outstanding; the changes applied in the meantime
+  // are kept in global_sec_index_repack_deltas_. Only used by the MANIFEST
+  // writer.
+  bool global_sec_index_repacking_ = false;
+  std::vector<GlobalSecIndexDelta> global_sec_index_repack_deltas_;
+  // Bumped whenever global_rtree_ is rebuilt from scratch, which makes the
+  // result of a repack started before useless.
+  uint64_t global_sec_index_generation_ = 0;
+  // Hand-off from the repack job.
+  port::Mutex repack_mu_;
+  port::CondVar repack_cv_{&repack_mu_};
+  bool repack_job_running_ = false;
+  uint64_t repacked_generation_ = 0;
+  std::unique_ptr<GlobalSecRtree> repacked_global_rtree_;
+
+  uint64_t global_sec_index_memory_budget_ = 0;
+  // Bytes of global_rtree_ right after the last repack. An index that could
+  // not be coarsened under the budget is only repacked again once it has
+  // grown by a quarter.
+  size_t global_sec_index_packed_bytes_ = 0;
+  std::unique_ptr<CacheReservationManager> global_sec_index_cache_res_mgr_;
+
+  // Writes all entries of `rtree` to a new global index log file. `rtree`
+  // must reflect every delta appended before the call.
+  IOStatus WriteGlobalSecIndexCheckpoint(const GlobalSecRtree& rtree);
+
+  // Starts a checkpoint of the published snapshot and finishes it in the LOW
+  // priority pool, so that the MANIFEST writer keeps appending deltas while
+  // the entries are written. Only called by the MANIFEST writer.
+  struct GlobalSecIndexCheckpointJob {
+    VersionSet* vset;
+    std::shared_ptr<const GlobalSecRtree> snapshot;
+  };
+  void ScheduleGlobalSecIndexCheckpoint();
+  static void BGWorkGlobalSecIndexCheckpoint(void* arg);
+  // Waits for the checkpoint job, which references global_sec_index_log_.
+  void WaitForGlobalSecIndexCheckpoint();
+  // Protected by repack_mu_
+  bool checkpoint_job_running_ = false;
 };
 
 // ReactiveVersionSet represents a collection of versions of the column
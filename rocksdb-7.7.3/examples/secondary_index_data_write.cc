@@ -182,7 +182,7 @@ int main(int argc, char* argv[]) {
     options.table_factory.reset(NewBlockBasedTableFactory(block_based_options));
     options.memtable_factory.reset(new rocksdb::SkipListSecFactory);
     
-    options.allow_concurrent_memtable_write = false;
+    options.allow_concurrent_memtable_write = true;
 
     // Set the write buffer size to 64 MB
     options.write_buffer_size = 64 * 1024 * 1024;
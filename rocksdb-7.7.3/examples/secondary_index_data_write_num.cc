@@ -175,9 +175,10 @@ int main(int argc, char* argv[]) {
     options.global_sec_index_is_spatial = false;
 
     options.table_factory.reset(NewBlockBasedTableFactory(block_based_options));
-    options.memtable_factory.reset(new rocksdb::SkipListSecFactory);
+    options.memtable_factory.reset(new rocksdb::SkipListSecFactory(
+        0, rocksdb::SkipListSecFactory::kSecValue));
     
-    options.allow_concurrent_memtable_write = false;
+    options.allow_concurrent_memtable_write = true;
 
     // Set the write buffer size to 64 MB
     options.write_buffer_size = 64 * 1024 * 1024;
@@ -159,7 +159,7 @@ int main(int argc, char* argv[]) {
     options.table_factory.reset(NewBlockBasedTableFactory(block_based_options));
     options.memtable_factory.reset(new rocksdb::SkipListSecFactory);
     
-    options.allow_concurrent_memtable_write = false;
+    options.allow_concurrent_memtable_write = true;
     options.force_consistency_checks = false;
 
     // Set the write buffer size to 64 MB
@@ -174,13 +174,13 @@ int main(int argc, char* argv[]) {
     double low[2], high[2];
 
     rocksdb::ReadOptions read_options;
-    rocksdb::RtreeIteratorContext iterator_context;
+    // Only return the current version of each updated object
+    read_options.validate_sec_index_results = true;
     std::string operation_type;
     int lineCount = 0;
     std::string line;    
 
     std::chrono::nanoseconds totalDuration{0};
-    std::map<int, uint64_t> update_memo;
     uint64_t time_stamp = 20000001;
 
     int write_c = 0;
@@ -227,26 +227,13 @@ int main(int argc, char* argv[]) {
             ss >> low[0] >> low[1] >> high[0] >> high[1];
 
             auto query_start = std::chrono::high_resolution_clock::now();
-            iterator_context.query_mbr = 
+            std::string query =
                     serialize_query(low[0], high[0], low[1], high[1]);
-            read_options.iterator_context = &iterator_context;
-            read_options.is_secondary_index_scan = true;
-            // read_options.async_io = true;
-            // std::cout << "create newiterator" << std::endl;
-            std::unique_ptr <rocksdb::Iterator> it(db->NewIterator(read_options));
-            // std::cout << "created New iterator" << std::endl;
+            std::unique_ptr <rocksdb::Iterator> it(
+                    db->NewSecondaryIndexIterator(read_options, query));
             counter = 0;
-            // auto start = std::chrono::high_resolution_clock::now();
             for (it->SeekToFirst(); it->Valid(); it->Next()) {
-                int pkey_id = deserialize_key(it->key());
-                // Val value = deserialize_val(it->value());
-                uint64_t timestamp = deserialize_val(it->value());
-                if (update_memo.count(pkey_id) > 0 && update_memo[pkey_id] > timestamp) {
-                    continue;
-                } else {
-                    counter ++;
-                }
-                // counter++;
+                counter ++;
             }
 
             // std::cout << "found results: " << counter << std::endl;
@@ -277,7 +264,6 @@ int main(int argc, char* argv[]) {
             
             s = db->Delete(WriteOptions(), key);
             s = db->Put(WriteOptions(), key, value);
-            update_memo[id] = time_stamp;
             time_stamp++;
             // std::cout << "write first data" << std::endl;
             auto update_end = std::chrono::high_resolution_clock::now(); 
@@ -152,9 +152,10 @@ int main(int argc, char* argv[]) {
     std::ofstream resFile(resultpath);
 
     options.table_factory.reset(NewBlockBasedTableFactory(block_based_options));
-    options.memtable_factory.reset(new rocksdb::SkipListSecFactory);
+    options.memtable_factory.reset(new rocksdb::SkipListSecFactory(
+        0, rocksdb::SkipListSecFactory::kSecValue));
     
-    options.allow_concurrent_memtable_write = false;
+    options.allow_concurrent_memtable_write = true;
     options.force_consistency_checks = false;
 
     // Set the write buffer size to 64 MB
@@ -149,7 +149,8 @@ int main(int argc, char* argv[]) {
     block_based_options.block_cache = rocksdb::NewLRUCache(64 * 1024 * 1024);
 
     options.table_factory.reset(NewBlockBasedTableFactory(block_based_options));
-    options.memtable_factory.reset(new rocksdb::SkipListSecFactory);
+    options.memtable_factory.reset(new rocksdb::SkipListSecFactory(
+        0, rocksdb::SkipListSecFactory::kSecValue));
 
     options.force_consistency_checks = false;
 
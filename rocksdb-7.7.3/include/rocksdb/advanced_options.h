@@ -1070,6 +1070,38 @@ struct AdvancedColumnFamilyOptions {
   char* global_sec_index_loc = nullptr;
   bool global_sec_index_is_spatial = true;
 
+  // The global secondary index is persisted as a log of the changes made to
+  // it, prefixed by a checkpoint of the whole index. A new checkpoint is
+  // written (and the older log dropped) once this many changes have been
+  // logged. The log lives in global_sec_index_loc, or in the DB directory if
+  // global_sec_index_loc is not set.
+  //
+  // Default: 100000
+  uint64_t global_sec_index_checkpoint_interval = 100000;
+
+  // Inserting and removing the entries of flushed and compacted files one by
+  // one gradually makes the nodes of the global secondary index overlap more,
+  // so queries visit more of them. Once this many entries have been inserted
+  // or removed since the index was last packed, a background job bulk loads
+  // a packed copy of the index and swaps it in. 0 disables repacking.
+  //
+  // Default: 1000000
+  uint64_t global_sec_index_repack_threshold = 1000000;
+
+  // Upper bound on the bytes of the in-memory global secondary index nodes.
+  // Once exceeded, the background repack job coarsens the index: adjacent
+  // entries of the same file are merged into one entry covering all their
+  // blocks, until the packed index fits. Queries stay exact, as the blocks of
+  // a merged entry are checked against the query one by one, but they have
+  // to look at more blocks. 0 means no budget.
+  //
+  // The usage is reported by the "rocksdb.global-sec-index-bytes" property
+  // and can be charged to the block cache with
+  // CacheEntryRole::kGlobalSecIndex.
+  //
+  // Default: 0
+  uint64_t global_sec_index_memory_budget = 0;
+
   // Create ColumnFamilyOptions with default values for all fields
   AdvancedColumnFamilyOptions();
   // Create ColumnFamilyOptions from Options
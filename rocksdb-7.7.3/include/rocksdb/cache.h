@@ -696,6 +696,9 @@ enum class CacheEntryRole {
   // Blob cache's charge to account for its memory usage (when using a
   // separate block cache and blob cache)
   kBlobCache,
+  // Global secondary index's charge to account for the memory of its
+  // in-memory R-tree nodes
+  kGlobalSecIndex,
   // Default bucket, for miscellaneous cache entries. Do not use for
   // entries that could potentially add up to large usage.
   kMisc,
@@ -894,6 +894,25 @@ class DB {
   virtual Iterator* NewIterator(const ReadOptions& options) {
     return NewIterator(options, DefaultColumnFamily());
   }
+  // Return a heap-allocated iterator over the entries whose secondary
+  // attribute matches `query`, in no particular order. `query` is encoded
+  // like RtreeIteratorContext::query_mbr: an MBR for a spatial secondary
+  // index (see ReadOptions::is_secondary_index_spatial), a value range
+  // otherwise. Only SeekToFirst() and Next() are supported, and no
+  // secondary comparator is involved.
+  //
+  // Caller should delete the iterator when it is no longer needed.
+  // The returned iterator should be deleted before this db is deleted.
+  virtual Iterator* NewSecondaryIndexIterator(
+      const ReadOptions& /*options*/, ColumnFamilyHandle* /*column_family*/,
+      const Slice& /*query*/) {
+    return NewErrorIterator(
+        Status::NotSupported("NewSecondaryIndexIterator() not implemented."));
+  }
+  virtual Iterator* NewSecondaryIndexIterator(const ReadOptions& options,
+                                              const Slice& query) {
+    return NewSecondaryIndexIterator(options, DefaultColumnFamily(), query);
+  }
   // Returns iterators from a consistent database state across multiple
   // column families. Iterators are heap allocated and need to be deleted
   // before the db is deleted
@@ -1176,6 +1195,18 @@ class DB {
     // "rocksdb.blob-cache-pinned-usage" - returns the memory size for the
     //      entries being pinned in blob cache.
     static const std::string kBlobCachePinnedUsage;
+
+    //  "rocksdb.global-sec-index-bytes" - returns the memory size of the
+    //      nodes of the in-memory global secondary index.
+    static const std::string kGlobalSecIndexBytes;
+
+    //  "rocksdb.global-sec-index-entries" - returns the number of entries in
+    //      the global secondary index.
+    static const std::string kGlobalSecIndexEntries;
+
+    //  "rocksdb.global-sec-index-height" - returns the number of node levels
+    //      of the global secondary index.
+    static const std::string kGlobalSecIndexHeight;
   };
 #endif /* ROCKSDB_LITE */
 
@@ -1244,6 +1275,11 @@ class DB {
   //  "rocksdb.blob-cache-capacity"
   //  "rocksdb.blob-cache-usage"
   //  "rocksdb.blob-cache-pinned-usage"
+  //
+  //  Properties dedicated for the global secondary index:
+  //  "rocksdb.global-sec-index-bytes"
+  //  "rocksdb.global-sec-index-entries"
+  //  "rocksdb.global-sec-index-height"
   virtual bool GetIntProperty(ColumnFamilyHandle* column_family,
                               const Slice& property, uint64_t* value) = 0;
   virtual bool GetIntProperty(const Slice& property, uint64_t* value) {
@@ -49,6 +49,7 @@ namespace ROCKSDB_NAMESPACE {
 
 class Arena;
 class Allocator;
+class Env;
 class LookupKey;
 class SliceTransform;
 class Logger;
@@ -173,6 +174,12 @@ class MemTableRep {
   // or any writes done directly to entries accessed through the iterator.)
   virtual void MarkReadOnly() {}
 
+  // Called by the memtable right after MarkReadOnly(), with the Env of its
+  // DB. A rep that prepares its contents for reads once it is read-only
+  // schedules that work on `env`, and has to drop it or wait for it when
+  // destroyed. By default, does nothing.
+  virtual void ScheduleReadOnlyWork(Env* /*env*/) {}
+
   // Notify this table rep that it has been flushed to stable storage.
   // By default, does nothing.
   //
@@ -396,7 +403,19 @@ private:
 // Adding SkipListFactorySecondary
 class SkipListSecFactory : public MemTableRepFactory {
 public:
-    explicit SkipListSecFactory(size_t lookahead = 0) : lookahead_(lookahead) {}
+    // The secondary attribute at the start of the values, which the
+    // memtables index for secondary queries: a 2D MBR (min_x, max_x, min_y,
+    // max_y as doubles) as for BlockBasedTableOptions::kRtreeSec, or a
+    // double as for BlockBasedTableOptions::kOneDRtreeSec. Queries of the
+    // other type fall back to scanning the whole memtable.
+    enum SecAttributeType : char {
+      kSecMbr = 0x00,
+      kSecValue = 0x01,
+    };
+
+    explicit SkipListSecFactory(size_t lookahead = 0,
+                                SecAttributeType attribute = kSecMbr)
+        : lookahead_(lookahead), attribute_(attribute) {}
 
     // Methods for MemTableRepFactory class overrides
     using MemTableRepFactory::CreateMemTableRep;
@@ -410,12 +429,19 @@ public:
 
 private:
     const size_t lookahead_;
+    const SecAttributeType attribute_;
 };
 
 // Adding RtreeFactory
+//
+// Parameters:
+//   bucket_count: number of buckets of the hash on the user key that serves
+//     the point lookups of each RtreeRep. The buckets are allocated from the
+//     memtable's arena.
 class RTreeFactory : public MemTableRepFactory {
 public:
-    explicit RTreeFactory() {}
+    explicit RTreeFactory(size_t bucket_count = 50000)
+        : bucket_count_(bucket_count) {}
 
     // Methods for MemTableRepFactory class overrides
     using MemTableRepFactory::CreateMemTableRep;
@@ -426,6 +452,9 @@ public:
     virtual const char* Name() const override {return "RTreeFactory";}
 
     bool IsInsertConcurrentlySupported() const override { return  false; }
+
+private:
+    const size_t bucket_count_;
 };
 
 
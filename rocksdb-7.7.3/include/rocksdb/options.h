@@ -59,6 +59,7 @@ class FileSystem;
 
 struct Options;
 struct DbPath;
+struct SecIndexFilePlanRef;
 // Adding Iterator_context
 struct IteratorContext {};
 
@@ -1710,7 +1711,25 @@ struct ReadOptions {
   // Default: false
   bool is_secondary_index_scan=false;
   bool is_secondary_index_spatial=true;
-  std::vector<std::pair<uint64_t, uint64_t>>* found_sec_blkhandle = new std::vector<std::pair<uint64_t, uint64_t>>();
+  // The secondary index partitions of the file to read, set internally for
+  // every file picked by the global secondary index. Not owned; it lives in
+  // the arena of the query's iterators.
+  const SecIndexFilePlanRef* sec_index_plan = nullptr;
+  // With the global secondary index, the number of files a secondary index
+  // query scans concurrently in the Env's USER priority pool. The entries of
+  // the scanned files are then returned in no particular order, and only
+  // forward iteration is supported. 1 scans the files on the calling thread
+  // through a merging iterator.
+  // Default: 1
+  size_t sec_query_parallelism = 1;
+  // For DB::NewSecondaryIndexIterator(): only return the entries that are
+  // still the newest value of their primary key at the iterator's snapshot.
+  // The iterator reads ahead a batch of results and checks their primary
+  // keys with one batched lookup, which drops the versions that were
+  // overwritten or deleted since, possibly by a write that moved the entry
+  // out of the query.
+  // Default: false
+  bool validate_sec_index_results = false;
 
   ReadOptions();
   ReadOptions(bool cksum, bool cache);
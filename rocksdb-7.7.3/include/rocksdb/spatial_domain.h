@@ -0,0 +1,112 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "rocksdb/rocksdb_namespace.h"
+#include "rocksdb/slice.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// The rectangle of the data space that the space-filling curves (z-order,
+// Hilbert) lay their grid over. Points outside of it fall into the border
+// cells (except for Legacy(), see there), so a domain much larger than the
+// data packs it into a few cells and one smaller than the data piles it up on
+// the border: either way the curve loses its locality.
+//
+// A default-constructed domain is empty; Extend() grows it to fit points.
+struct SpatialDomain {
+  double x_min = std::numeric_limits<double>::infinity();
+  double x_max = -std::numeric_limits<double>::infinity();
+  double y_min = std::numeric_limits<double>::infinity();
+  double y_max = -std::numeric_limits<double>::infinity();
+
+  SpatialDomain() {}
+  SpatialDomain(double _x_min, double _x_max, double _y_min, double _y_max)
+      : x_min(_x_min), x_max(_x_max), y_min(_y_min), y_max(_y_max) {}
+
+  // The bounds the spatial comparators were first written for, mapped to
+  // cells the way they were then: coordinates below the minimum are not
+  // clamped but wrap around to huge cell numbers. This is the comparators'
+  // default, so that the keys of existing databases keep their order; new
+  // databases should configure a domain that fits their data instead.
+  static SpatialDomain Legacy() {
+    SpatialDomain domain(-12.2304942, 37.4497039, 50.0218541, 125.9548288);
+    domain.wrap_below_min = true;
+    return domain;
+  }
+
+  bool empty() const { return !(x_min <= x_max && y_min <= y_max); }
+
+  // Grows the domain to contain the point (x, y). NaN coordinates are
+  // ignored.
+  void Extend(double x, double y) {
+    x_min = std::min(x_min, x);
+    x_max = std::max(x_max, x);
+    y_min = std::min(y_min, y);
+    y_max = std::max(y_max, y);
+  }
+
+  // The column and row of a point on a grid of n x n cells over the domain,
+  // in [0, n) unless wrap_below_min is set
+  uint32_t CellX(double x, uint32_t n) const {
+    return Cell(x, x_min, x_max, n, wrap_below_min);
+  }
+  uint32_t CellY(double y, uint32_t n) const {
+    return Cell(y, y_min, y_max, n, wrap_below_min);
+  }
+
+  // The four bounds, 8 bytes each in native byte order like the coordinates
+  // of keys and values
+  void EncodeTo(std::string* dst) const {
+    const double bounds[4] = {x_min, x_max, y_min, y_max};
+    dst->append(reinterpret_cast<const char*>(bounds), sizeof(bounds));
+  }
+
+  bool DecodeFrom(const Slice& src) {
+    double bounds[4];
+    if (src.size() != sizeof(bounds)) {
+      return false;
+    }
+    memcpy(bounds, src.data(), sizeof(bounds));
+    *this = SpatialDomain(bounds[0], bounds[1], bounds[2], bounds[3]);
+    return true;
+  }
+
+  bool operator==(const SpatialDomain& other) const {
+    return x_min == other.x_min && x_max == other.x_max &&
+           y_min == other.y_min && y_max == other.y_max &&
+           wrap_below_min == other.wrap_below_min;
+  }
+
+  // Set by Legacy() only. Not part of the encoding.
+  bool wrap_below_min = false;
+
+ private:
+  static uint32_t Cell(double v, double lo, double hi, uint32_t n,
+                       bool wrap_below_min) {
+    if (wrap_below_min) {
+      // Bit for bit the mapping of the original comparators
+      const int cell =
+          static_cast<int>(std::floor((v - lo) / ((hi - lo) / n)));
+      return static_cast<uint32_t>(std::min(cell, static_cast<int>(n) - 1));
+    }
+    const double cell = std::floor((v - lo) / ((hi - lo) / n));
+    // Also catches NaN, e.g. from a domain of zero width
+    if (!(cell > 0)) {
+      return 0;
+    }
+    return cell < n ? static_cast<uint32_t>(cell) : n - 1;
+  }
+};
+
+}  // namespace ROCKSDB_NAMESPACE
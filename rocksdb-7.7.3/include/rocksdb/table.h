@@ -26,6 +26,7 @@
 #include "rocksdb/customizable.h"
 #include "rocksdb/env.h"
 #include "rocksdb/options.h"
+#include "rocksdb/spatial_domain.h"
 #include "rocksdb/status.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -247,6 +248,22 @@ struct BlockBasedTableOptions {
   };
   SecondaryIndexType sec_index_type = kRtreeSec;
 
+  // With create_secondary_index, append to each data block a column holding
+  // the secondary attribute of its entries (the MBR for kRtreeSec, the
+  // value for kOneDRtreeSec), which secondary index scans test against the
+  // query before decoding any entry of the block.
+  bool sec_attribute_column = false;
+  // Store the MBRs of the column as floats, halving its size. The rounding
+  // only ever lets more entries through, which are then checked against
+  // their exact MBR. Ignored for kOneDRtreeSec.
+  bool quantize_sec_attribute_column = false;
+
+  // The domain kRtreeSec lays its z-order curve over to pack the data block
+  // MBRs into index partitions. Left empty, each table uses the bounding box
+  // of the centers of its own data block MBRs. Either way the table records
+  // the domain it used in its properties (rocksdb.spatial.domain).
+  SpatialDomain sec_index_domain;
+
   // The index type that will be used for the data block.
   enum DataBlockIndexType : char {
     kDataBlockBinarySearch = 0,   // traditional block type
@@ -398,7 +415,20 @@ struct BlockBasedTableOptions {
   // (iii) Compatible existing behavior:
   // Same as kDisabled.
   //
-  // (e) Other CacheEntryRole
+  // (e) CacheEntryRole::kGlobalSecIndex
+  // (i) If kEnabled:
+  // Charge memory usage of the nodes of the in-memory global secondary
+  // index (see `global_sec_index`), using the block cache of the first
+  // column family that has the global secondary index enabled.
+  // A cache full under `LRUCacheOptions::strict_capacity_limit` = true is
+  // logged and does not fail the write; use
+  // `global_sec_index_memory_budget` to bound the index instead.
+  // (ii) If kDisabled:
+  // Does not charge the memory usage mentioned above.
+  // (iii) Compatible existing behavior:
+  // Same as kDisabled.
+  //
+  // (f) Other CacheEntryRole
   // Not supported.
   // `Status::kNotSupported` will be returned if
   // `CacheEntryRoleOptions::charged` is set to {`kEnabled`, `kDisabled`}.
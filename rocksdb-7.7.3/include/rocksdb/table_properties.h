@@ -70,6 +70,7 @@ struct TablePropertiesNames {
   static const std::string kSlowCompressionEstimatedDataSize;
   static const std::string kFastCompressionEstimatedDataSize;
   static const std::string kSequenceNumberTimeMapping;
+  static const std::string kSpatialDomain;
 };
 
 // `TablePropertiesCollector` provides the mechanism for users to collect
@@ -289,6 +290,10 @@ struct TableProperties {
   // Sequence number to time mapping, delta encoded.
   std::string seqno_to_time_mapping;
 
+  // The SpatialDomain the secondary index was packed with, encoded by
+  // SpatialDomain::EncodeTo(). Empty without an R-tree secondary index.
+  std::string spatial_domain;
+
   // user collected properties
   UserCollectedProperties user_collected_properties;
   UserCollectedProperties readable_properties;
@@ -29,7 +29,9 @@ class MemoryUtil {
     kTableReadersTotal = 2,
     // Memory usage by Cache.
     kCacheTotal = 3,
-    kNumUsageTypes = 4
+    // Memory usage of the in-memory global secondary indexes.
+    kGlobalSecIndexTotal = 4,
+    kNumUsageTypes = 5
   };
 
   // Returns the approximate memory usage of different types in the input
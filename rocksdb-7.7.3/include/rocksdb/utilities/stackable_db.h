@@ -225,6 +225,13 @@ class StackableDB : public DB {
     return db_->NewIterator(opts, column_family);
   }
 
+  using DB::NewSecondaryIndexIterator;
+  virtual Iterator* NewSecondaryIndexIterator(
+      const ReadOptions& opts, ColumnFamilyHandle* column_family,
+      const Slice& query) override {
+    return db_->NewSecondaryIndexIterator(opts, column_family, query);
+  }
+
   virtual Status NewIterators(
       const ReadOptions& options,
       const std::vector<ColumnFamilyHandle*>& column_families,
@@ -1,258 +1,234 @@
 // rtree_rep.cc is used to link the RTree_mem.h to the memtablerep.h
 // (i.e., to facilitate rocksdb memtable using the rtree template)
-
-#include <iostream>
+//
+// The entries are indexed twice: by the MBR of their key in the R-tree, for
+// spatial queries, and by their user key in a fixed array of buckets, for
+// point lookups. Both the tree nodes and the buckets are allocated from the
+// memtable's allocator. Inserts are not concurrent (the factory does not
+// support concurrent inserts), but they run concurrently with reads: the
+// R-tree is guarded by a read-write lock, while the buckets are lock-free
+// lists that the writer only ever prepends to.
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <vector>
 
 #include "db/memtable.h"
-#include "util/RTree_mem.h"
+#include "memtable/sorted_entries_iterator.h"
+#include "port/port.h"
 #include "rocksdb/memtablerep.h"
 #include "rocksdb/utilities/options_type.h"
-#include "util/string_util.h"
+#include "util/RTree_mem.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
 #include "util/rtree.h"
+#include "util/string_util.h"
 
 namespace ROCKSDB_NAMESPACE {
 namespace {
 
 class RtreeRep : public MemTableRep {
-    typedef char* ValueType;
-    typedef RTree<ValueType, double, 2, double> MyTree;
-    MyTree rtree_;
-
  public:
-    RtreeRep(Allocator* allocator);
-
-    // Insert key into the rtree.
-    // The parameter to insert is a single buffer contains key and value.
-    // The insert parameter here follow other data format.
-    void Insert(KeyHandle handle) override {
-        auto* key_ = static_cast<char*>(handle);
-        Slice internal_key = GetLengthPrefixedSlice(key_);
-        Slice key = ExtractUserKey(internal_key);
-        Mbr mbr = ReadKeyMbr(key);
-
-        Rect rect(mbr.first.min, mbr.second.min, mbr.first.max, mbr.second.max);
-        rtree_.Insert(rect.min, rect.max, key_);
-    }
-
-    bool Contains(const char* key) const override;
-
-    size_t ApproximateMemoryUsage() override {return 0;}
-
-    void Get(const LookupKey& k, void* callback_args,
-    bool (*callback_func)(void* arg, const char* entry)) override;
-
-    void SpatialRange(const LookupKey& k, void* callback_args,
-    bool (*callback_func)(void* arg, const char* entry)) override;    
-    
-    ~RtreeRep() override {}
-
-    class Iterator : public MemTableRep::Iterator {
-        // MyTree::Iterator iter_;
-     public:
-        
-        explicit Iterator( MyTree* rtree,
-        IteratorContext* iterator_context ) {
-            rtree_i = rtree;
-            if (iterator_context != nullptr) {
-                RtreeIteratorContext* context = 
-                reinterpret_cast<RtreeIteratorContext*>(iterator_context);
-                Slice query_slize = Slice(context->query_mbr);
-                query_mbr_ = ReadQueryMbr(query_slize);
-            }
-        }
-
-        ~Iterator() override {}
-
-        bool Valid() const override { 
-            return !iter_.IsNull(); 
-        }
-
-        const char* key() const override;
-
-        void Next() override { 
-            // rtree_i->GetNext(iter_);
-            
-            // std::cout << "Next()" << std::endl;
-            
-            ++iter_;
-            // bool rrrr = ++iter_; 
-            // std::cout << "++iter_: " << rrrr << std::endl;
-
-            // std::cout << "it->key(): " <<  ReadKeyMbr(ExtractUserKey(GetLengthPrefixedSlice(key()))) << std::endl;
-            NextIfDisjoint(); 
-            // Slice key_inter = GetLengthPrefixedSlice(key());
-            // Slice key_s = ExtractUserKey(key_inter);
-            // Mbr key_mbr = ReadKeyMbr(key_s);
-            // std::cout << "mbr after Rtreerep next: " << key_mbr << std::endl;
-        }
-
-        void Prev() override {} // not implemented for r-tree
-
-        void Seek(const Slice& user_key, const char* memtable_key) override {
-            // std::cout << "Rtreerep Seek" << std::endl;
-            (void) user_key;
-            (void) memtable_key;
-        } // not implemented for r-tree
-
-        void SeekForPrev(const Slice& user_key, const char* memtable_key) override {
-            (void) user_key;
-            (void) memtable_key;
-        } // not implemented for r-tree
-
-        void RandomSeek() override {} // not implemented yet for r-tree
-
-        void SeekToFirst() override { 
-            rtree_i->GetFirst(iter_); 
-            NextIfDisjoint();
-
-            // debug
-            // Slice key_inter = GetLengthPrefixedSlice(key());
-            // Slice key_s = ExtractUserKey(key_inter);
-            // Mbr key_mbr = ReadKeyMbr(key_s);
-            // std::cout << "mbr after Rtreerep seektofirst: " << key_mbr << std::endl;
-
-        }
-        
-        void SeekToLast() override {} // not implemented yet for r-tree
-
-     private:
-        MyTree::Iterator iter_;
-        MyTree* rtree_i;
-        Mbr query_mbr_;
-        void NextIfDisjoint() {
-            
-            if (Valid()) {
-                Slice key_inter = GetLengthPrefixedSlice(key());
-                Slice key_s = ExtractUserKey(key_inter);
-                Mbr key_mbr = ReadKeyMbr(key_s);
-
-                // Mbr key_mbr;
-
-                // int boundsMin[2] = {0,0};
-                // int boundsMax[2] = {0,0};
-                // iter_.GetBounds(boundsMin, boundsMax);
-                // key_mbr.set_iid(boundsMin[0], boundsMin[1]);
-                // key_mbr.set_first(boundsMax[0], boundsMax[1]);
-                // key_mbr.set_second(boundsMax[0], boundsMax[1]);
-                
-                // //debug
-                // std::cout << "disjoint check: " << IntersectMbr(key_mbr, query_mbr_) << std::endl;
-                // std::cout << "key mbr: " << key_mbr << std::endl;
-                // std::cout << "query mbr: " << query_mbr_ << std::endl;
-
-                while (!IntersectMbr(key_mbr, query_mbr_)){
-                    
-                    std::cout << "!IntersectMbr => Next()" << std::endl;
-                    // Next();
-                    ++iter_;
-
-                    key_inter = GetLengthPrefixedSlice(key());
-                    key_s = ExtractUserKey(key_inter);
-                    key_mbr = ReadKeyMbr(key_s);
-                } 
-
-            
-            
-            }
-
-        }
-
-    };
-
-    // Returns an iterator over the keys
-    MemTableRep::Iterator* GetIterator(IteratorContext* iterator_context, Arena* arena = nullptr) override;
-
-
+  RtreeRep(const MemTableRep::KeyComparator& compare, Allocator* allocator,
+           size_t bucket_count);
+
+  // Insert key into the rtree.
+  // The parameter to insert is a single buffer contains key and value.
+  // The insert parameter here follow other data format.
+  void Insert(KeyHandle handle) override;
+
+  bool Contains(const char* key) const override;
+
+  // The tree nodes and the buckets live in the memtable's allocator, which
+  // the memtable accounts for
+  size_t ApproximateMemoryUsage() override { return 0; }
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override;
+
+  // Calls callback_func on the entries whose key MBR overlaps the one of
+  // `k`, from the first one >= `k` in the order of the memtable, until it
+  // returns false
+  void SpatialRange(const LookupKey& k, void* callback_args,
+                    bool (*callback_func)(void* arg, const char* entry)) override;
+
+  ~RtreeRep() override {}
+
+  // Returns an iterator over the keys intersecting the query MBR of the
+  // context, or over all keys without one. Either way the keys are sorted.
+  MemTableRep::Iterator* GetIterator(IteratorContext* iterator_context,
+                                     Arena* arena = nullptr) override;
+
+ private:
+  typedef char* ValueType;
+  typedef RTree<ValueType, double, 2, double> MyTree;
+
+  // An entry in the list of a bucket
+  struct BucketNode {
+    const char* entry;
+    BucketNode* next;
+  };
+
+  // A key holds the iid (8 bytes) and the MBR (4 doubles)
+  static constexpr size_t kKeyMbrSize = sizeof(uint64_t) + 4 * sizeof(double);
+  // A query holds the iid range (16 bytes) and the MBR
+  static constexpr size_t kQueryMbrSize =
+      2 * sizeof(uint64_t) + 4 * sizeof(double);
+
+  std::atomic<BucketNode*>& Bucket(const Slice& user_key) const {
+    return buckets_[GetSliceHash(user_key) % bucket_count_];
+  }
+
+  // Calls `visitor` on the entries whose key MBR overlaps `rect`
+  template <class VISITOR>
+  void Visit(const Rect& rect, VISITOR&& visitor) const {
+    ReadLock l(&rtree_mutex_);
+    rtree_.Visit(rect.min, rect.max, visitor);
+  }
+
+  // Sorts `entries` in the order of the memtable
+  void SortEntries(std::vector<const char*>* entries) const {
+    std::sort(entries->begin(), entries->end(),
+              [this](const char* a, const char* b) { return cmp_(a, b) < 0; });
+  }
+
+  const MemTableRep::KeyComparator& cmp_;
+  mutable port::RWMutex rtree_mutex_;
+  MyTree rtree_;
+  const size_t bucket_count_;
+  std::atomic<BucketNode*>* buckets_;
 };
 
-// void RTreeRep::Insert(KeyHandle handle) {
-//     auto* key_ = static_cast<char*>(handle);
-//     Slice internal_key = GetLengthPrefixedSlice(key_);
-//     Slice key = ExtractUserKey(internal_key);
-//     Mbr mbr = ReadKeyMbr(key);
-
-//     Rect rect(mbr.first.min, mbr.first.max, mbr.second.min, mbr.second.max);
-//     rtree_.Insert(rect.min, rect.max, mbr.iid.min);
-// }
-
-RtreeRep::RtreeRep (Allocator* allocator) 
-    : MemTableRep (allocator), 
-      rtree_() {}
-
-bool MySearchCallback(char* id)
-{
-    (void) id;
-    return true; // keep going
+RtreeRep::RtreeRep(const MemTableRep::KeyComparator& compare,
+                   Allocator* allocator, size_t bucket_count)
+    : MemTableRep(allocator),
+      cmp_(compare),
+      rtree_(allocator),
+      bucket_count_(std::max<size_t>(bucket_count, 1)) {
+  char* mem = allocator->AllocateAligned(sizeof(std::atomic<BucketNode*>) *
+                                         bucket_count_);
+  buckets_ = reinterpret_cast<std::atomic<BucketNode*>*>(mem);
+  for (size_t i = 0; i < bucket_count_; i++) {
+    new (&buckets_[i]) std::atomic<BucketNode*>(nullptr);
+  }
 }
 
+void RtreeRep::Insert(KeyHandle handle) {
+  auto* key_ = static_cast<char*>(handle);
+  Slice internal_key = GetLengthPrefixedSlice(key_);
+  Slice key = ExtractUserKey(internal_key);
+  Mbr mbr = ReadKeyMbr(key);
+
+  Rect rect(mbr.first.min, mbr.second.min, mbr.first.max, mbr.second.max);
+  {
+    WriteLock l(&rtree_mutex_);
+    rtree_.Insert(rect.min, rect.max, key_);
+  }
+
+  auto* node = reinterpret_cast<BucketNode*>(
+      allocator_->AllocateAligned(sizeof(BucketNode)));
+  std::atomic<BucketNode*>& bucket = Bucket(key);
+  node->entry = key_;
+  node->next = bucket.load(std::memory_order_relaxed);
+  // Publishes the node to the readers
+  bucket.store(node, std::memory_order_release);
+}
 
 bool RtreeRep::Contains(const char* key) const {
-    Slice internal_key = GetLengthPrefixedSlice(key);
-    Slice user_key = ExtractUserKey(internal_key);
-    Mbr key_mbr = ReadKeyMbr(user_key);
-    Rect key_rect(key_mbr.first.min, key_mbr.second.min, key_mbr.first.max, key_mbr.second.max);
-
-    std::vector<char*> nhits;
-    nhits = rtree_.Search(key_rect.min, key_rect.max, MySearchCallback);
-    
-    if (nhits.size() > 0) {
-        return true;
-    } else {
-        return false;
+  Slice user_key = ExtractUserKey(GetLengthPrefixedSlice(key));
+  for (const BucketNode* node =
+           Bucket(user_key).load(std::memory_order_acquire);
+       node != nullptr; node = node->next) {
+    if (cmp_(node->entry, key) == 0) {
+      return true;
     }
-
-}
-
-const char* RtreeRep::Iterator::key() const {
-    
-    // int key_iid = rtree_i->GetAt(iter_);
-
-    // int boundsMin[2] = {0,0};
-    // int boundsMax[2] = {0,0};
-    // iter_.GetBounds(boundsMin, boundsMax);
-
-    // //debug
-    // std::cout << "key()" << std::endl;
-    // std::cout << "Bounds :" << boundsMin[0] << " , " << boundsMax[0] << std::endl;
-    // std::cout << "key: " << iter_.operator*() << std::endl;
-    // //debug
-
-    // const char* key = serialize_key(boundsMin[0], boundsMax[0]).c_str();
-    return iter_.operator*();
-
-    // return key;
+  }
+  return false;
 }
 
 void RtreeRep::Get(const LookupKey& k, void* callback_args,
-    bool (*callback_func)(void* arg, const char* entry)) {
-        (void) k;
-        (void) callback_args;
-        (void) callback_func;
+                   bool (*callback_func)(void* arg, const char* entry)) {
+  Slice user_key = k.user_key();
+  const char* target = k.memtable_key().data();
+  std::vector<const char*> entries;
+  for (const BucketNode* node =
+           Bucket(user_key).load(std::memory_order_acquire);
+       node != nullptr; node = node->next) {
+    if (ExtractUserKey(GetLengthPrefixedSlice(node->entry)) == user_key &&
+        cmp_(node->entry, target) >= 0) {
+      entries.push_back(node->entry);
     }
+  }
+  SortEntries(&entries);
+  for (const char* entry : entries) {
+    if (!callback_func(callback_args, entry)) {
+      break;
+    }
+  }
+}
 
 void RtreeRep::SpatialRange(const LookupKey& k, void* callback_args,
-    bool (*callback_func)(void* arg, const char* entry)) {
-        
-        (void) k;
-        (void) callback_args;
-        (void) callback_func;
+                            bool (*callback_func)(void* arg,
+                                                  const char* entry)) {
+  Slice user_key = k.user_key();
+  if (user_key.size() < kKeyMbrSize) {
+    return;
+  }
+  Mbr mbr = ReadKeyMbr(user_key);
+  Rect rect(mbr.first.min, mbr.second.min, mbr.first.max, mbr.second.max);
+  const char* target = k.memtable_key().data();
+  std::vector<const char*> entries;
+  Visit(rect, [&](const char* entry) {
+    if (cmp_(entry, target) >= 0) {
+      entries.push_back(entry);
     }
-
-MemTableRep::Iterator* RtreeRep::GetIterator(IteratorContext* iterator_context, Arena* arena) { 
-    void *mem = arena ? arena->AllocateAligned(sizeof(RtreeRep::Iterator))
-    : operator new(sizeof(RtreeRep::Iterator));
-    return new (mem) RtreeRep::Iterator(&rtree_, iterator_context);
+    return true;
+  });
+  SortEntries(&entries);
+  for (const char* entry : entries) {
+    if (!callback_func(callback_args, entry)) {
+      break;
+    }
+  }
 }
 
+MemTableRep::Iterator* RtreeRep::GetIterator(IteratorContext* iterator_context,
+                                             Arena* arena) {
+  std::vector<const char*> entries;
+  RtreeIteratorContext* context =
+      reinterpret_cast<RtreeIteratorContext*>(iterator_context);
+  if (context != nullptr && context->query_mbr.size() >= kQueryMbrSize) {
+    Mbr query_mbr = ReadQueryMbr(Slice(context->query_mbr));
+    Rect rect(query_mbr.first.min, query_mbr.second.min, query_mbr.first.max,
+              query_mbr.second.max);
+    // The tree only indexes the MBR, the iid is checked on the key
+    Visit(rect, [&](const char* entry) {
+      Slice user_key = ExtractUserKey(GetLengthPrefixedSlice(entry));
+      if (IntersectMbr(ReadKeyMbr(user_key), query_mbr)) {
+        entries.push_back(entry);
+      }
+      return true;
+    });
+  } else {
+    const double inf = std::numeric_limits<double>::infinity();
+    Visit(Rect(-inf, -inf, inf, inf), [&](const char* entry) {
+      entries.push_back(entry);
+      return true;
+    });
+  }
+  SortEntries(&entries);
+  void* mem = arena ? arena->AllocateAligned(sizeof(SortedEntriesIterator))
+                    : operator new(sizeof(SortedEntriesIterator));
+  return new (mem) SortedEntriesIterator(cmp_, std::move(entries));
 }
 
+}  // namespace
+
 MemTableRep* RTreeFactory::CreateMemTableRep(
-        const MemTableRep::KeyComparator&, Allocator* allocator,
-        const SliceTransform*, Logger* /*logger*/) {
-    // std::cout << "new memtable" << std::endl;
-    return new RtreeRep(allocator);
+    const MemTableRep::KeyComparator& compare, Allocator* allocator,
+    const SliceTransform*, Logger* /*logger*/) {
+  return new RtreeRep(compare, allocator, bucket_count_);
 }
 
-
-
-} //namespace ROCKSDB_NAMESPACE
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,361 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// Tests of the secondary index of the SkipListSecFactory memtables: the
+// per-core shards written by concurrent inserts, the packed index that
+// replaces them once the memtable is immutable, and the job packing it.
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "memory/concurrent_arena.h"
+#include "port/port.h"
+#include "port/stack_trace.h"
+#include "rocksdb/env.h"
+#include "rocksdb/memtablerep.h"
+#include "test_util/sync_point.h"
+#include "test_util/testharness.h"
+#include "test_util/testutil.h"
+#include "util/coding.h"
+#include "util/random.h"
+#include "util/rtree.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class SkipListSecRepTest
+    : public testing::Test,
+      public testing::WithParamInterface<SkipListSecFactory::SecAttributeType> {
+ public:
+  SkipListSecRepTest()
+      : env_(Env::Default()),
+        icmp_(BytewiseComparator()),
+        cmp_(icmp_),
+        factory_(0 /* lookahead */, GetParam()) {
+    // The pack jobs and the tasks the tests use to wait for them run one
+    // after the other
+    env_->SetBackgroundThreads(1, Env::Priority::LOW);
+  }
+
+  ~SkipListSecRepTest() override {
+    SyncPoint::GetInstance()->DisableProcessing();
+    SyncPoint::GetInstance()->ClearAllCallBacks();
+    SyncPoint::GetInstance()->LoadDependency({});
+  }
+
+  bool value_attribute() const {
+    return GetParam() == SkipListSecFactory::kSecValue;
+  }
+
+  MemTableRep* NewRep() {
+    return factory_.CreateMemTableRep(cmp_, &arena_, nullptr, nullptr);
+  }
+
+  // Adds key `i` with a random attribute. A few values are too short to
+  // hold an attribute and a few have NaN coordinates, which every query
+  // returns.
+  void Add(MemTableRep* rep, int i, Random* rnd, bool concurrently) {
+    std::string value;
+    if (i % 50 != 49) {
+      double attribute[4];
+      for (int axis = 0; axis < 2; axis++) {
+        attribute[2 * axis] = rnd->Uniform(100000) / 1000.0;
+        attribute[2 * axis + 1] =
+            attribute[2 * axis] + rnd->Uniform(2000) / 1000.0;
+      }
+      if (i % 97 == 96) {
+        attribute[0] = std::nan("");
+      }
+      value.assign(reinterpret_cast<const char*>(attribute),
+                   (value_attribute() ? 1 : 4) * sizeof(double));
+    }
+    value.append("payload");
+
+    char user_key[16];
+    snprintf(user_key, sizeof(user_key), "key%08d", i);
+    std::string internal_key(user_key);
+    PutFixed64(&internal_key, PackSequenceAndType(i, kTypeValue));
+    const size_t len = VarintLength(internal_key.size()) +
+                       internal_key.size() + VarintLength(value.size()) +
+                       value.size();
+    char* buf = nullptr;
+    KeyHandle handle = rep->Allocate(len, &buf);
+    char* p = EncodeVarint32(buf, static_cast<uint32_t>(internal_key.size()));
+    memcpy(p, internal_key.data(), internal_key.size());
+    p = EncodeVarint32(p + internal_key.size(),
+                       static_cast<uint32_t>(value.size()));
+    memcpy(p, value.data(), value.size());
+    if (concurrently) {
+      ASSERT_TRUE(rep->InsertKeyConcurrently(handle));
+    } else {
+      rep->Insert(handle);
+    }
+  }
+
+  // A query of the attribute type of the memtables
+  std::string RandomQuery(Random* rnd) const {
+    const double min_x = rnd->Uniform(100000) / 1000.0;
+    const double max_x = min_x + rnd->Uniform(20000) / 1000.0;
+    if (value_attribute()) {
+      ValueRange range;
+      range.set_range(min_x, max_x);
+      return serializeValueRange(range);
+    }
+    const double min_y = rnd->Uniform(100000) / 1000.0;
+    Mbr mbr;
+    mbr.set_first(min_x, max_x);
+    mbr.set_second(min_y, min_y + rnd->Uniform(20000) / 1000.0);
+    return serializeMbrExcludeIID(mbr);
+  }
+
+  // The entries the secondary index returns for `query`
+  static std::vector<const char*> Query(MemTableRep* rep,
+                                        const std::string& query) {
+    RtreeIteratorContext context;
+    context.query_mbr = query;
+    std::unique_ptr<MemTableRep::Iterator> iter(rep->GetIterator(&context));
+    std::vector<const char*> entries;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      entries.push_back(iter->key());
+    }
+    return entries;
+  }
+
+  // The entries matching `query`, in order, by testing all of them
+  std::vector<const char*> Scan(MemTableRep* rep,
+                                const std::string& query) const {
+    double q[4];
+    memcpy(q, query.data(), query.size());
+    const size_t attribute_size = (value_attribute() ? 1 : 4) * sizeof(double);
+    std::unique_ptr<MemTableRep::Iterator> iter(rep->GetIterator(nullptr));
+    std::vector<const char*> entries;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      Slice internal_key = GetLengthPrefixedSlice(iter->key());
+      Slice value =
+          GetLengthPrefixedSlice(internal_key.data() + internal_key.size());
+      if (value.size() < attribute_size) {
+        continue;
+      }
+      double a[4];
+      memcpy(a, value.data(), attribute_size);
+      // Written as rejections, so that NaN coordinates match
+      const bool match =
+          value_attribute()
+              ? !(a[0] > q[1] || q[0] > a[0])
+              : !(a[0] > q[1] || q[0] > a[1] || a[2] > q[3] || q[2] > a[3]);
+      if (match) {
+        entries.push_back(iter->key());
+      }
+    }
+    return entries;
+  }
+
+  // As the memtable does once it is immutable
+  void MarkReadOnly(MemTableRep* rep) {
+    rep->MarkReadOnly();
+    rep->ScheduleReadOnlyWork(env_);
+  }
+
+  // Returns once the LOW priority jobs scheduled so far are done
+  void WaitForLowPriorityJobs() {
+    test::SleepingBackgroundTask task;
+    env_->Schedule(&test::SleepingBackgroundTask::DoSleepTask, &task,
+                   Env::Priority::LOW);
+    task.WakeUp();
+    task.WaitUntilDone();
+  }
+
+  Env* env_;
+  InternalKeyComparator icmp_;
+  MemTable::KeyComparator cmp_;
+  ConcurrentArena arena_;
+  SkipListSecFactory factory_;
+};
+
+TEST_P(SkipListSecRepTest, ConcurrentInserts) {
+  const int kThreads = 4;
+  const int kEntriesPerThread = 5000;
+  std::unique_ptr<MemTableRep> rep(NewRep());
+
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      Random rnd(301 + t);
+      for (int i = t; i < kThreads * kEntriesPerThread; i += kThreads) {
+        Add(rep.get(), i, &rnd, true /* concurrently */);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Every match exactly once, in the order of the memtable
+  Random rnd(42);
+  size_t matches = 0;
+  for (int i = 0; i < 100; i++) {
+    const std::string query = RandomQuery(&rnd);
+    const std::vector<const char*> expected = Scan(rep.get(), query);
+    ASSERT_EQ(expected, Query(rep.get(), query));
+    matches += expected.size();
+  }
+  ASSERT_GT(matches, 0u);
+}
+
+TEST_P(SkipListSecRepTest, QueryBeforeAndAfterPacking) {
+  std::unique_ptr<MemTableRep> rep(NewRep());
+  Random rnd(301);
+  for (int i = 0; i < 10000; i++) {
+    Add(rep.get(), i, &rnd, false /* concurrently */);
+  }
+
+  std::vector<std::string> queries;
+  std::vector<std::vector<const char*>> results;
+  for (int i = 0; i < 100; i++) {
+    queries.push_back(RandomQuery(&rnd));
+    results.push_back(Query(rep.get(), queries.back()));
+    ASSERT_EQ(Scan(rep.get(), queries.back()), results.back());
+  }
+  // The index is the only memory the rep accounts for itself. It does not
+  // change once the memtable is immutable.
+  const size_t bytes = rep->ApproximateMemoryUsage();
+  ASSERT_GT(bytes, 0u);
+
+  MarkReadOnly(rep.get());
+  WaitForLowPriorityJobs();
+  ASSERT_EQ(bytes, rep->ApproximateMemoryUsage());
+  for (size_t i = 0; i < queries.size(); i++) {
+    ASSERT_EQ(results[i], Query(rep.get(), queries[i]));
+  }
+}
+
+TEST_P(SkipListSecRepTest, PacksOnGivenEnv) {
+  // Counts the jobs scheduled on it
+  class CountingEnv : public EnvWrapper {
+   public:
+    explicit CountingEnv(Env* target) : EnvWrapper(target) {}
+    static const char* kClassName() { return "CountingEnv"; }
+    const char* Name() const override { return kClassName(); }
+
+    void Schedule(void (*function)(void* arg), void* arg, Priority pri,
+                  void* tag, void (*unschedFunction)(void* arg)) override {
+      scheduled.fetch_add(1);
+      target()->Schedule(function, arg, pri, tag, unschedFunction);
+    }
+
+    std::atomic<int> scheduled{0};
+  };
+  CountingEnv env(env_);
+
+  std::unique_ptr<MemTableRep> rep(NewRep());
+  Random rnd(301);
+  for (int i = 0; i < 1000; i++) {
+    Add(rep.get(), i, &rnd, false /* concurrently */);
+  }
+  const std::string query = RandomQuery(&rnd);
+  const std::vector<const char*> result = Query(rep.get(), query);
+  rep->MarkReadOnly();
+  rep->ScheduleReadOnlyWork(&env);
+  ASSERT_EQ(1, env.scheduled.load());
+  WaitForLowPriorityJobs();
+  ASSERT_EQ(result, Query(rep.get(), query));
+}
+
+TEST_P(SkipListSecRepTest, DestroyWithPackJobQueued) {
+  std::atomic<int> pack_jobs{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "SkipListSecRep::BGWorkPackSecIndex:Start",
+      [&](void*) { pack_jobs.fetch_add(1); });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  // Holds the thread of the pool, so that the pack job stays queued
+  test::SleepingBackgroundTask blocker;
+  env_->Schedule(&test::SleepingBackgroundTask::DoSleepTask, &blocker,
+                 Env::Priority::LOW);
+  blocker.WaitUntilSleeping();
+
+  std::unique_ptr<MemTableRep> rep(NewRep());
+  Random rnd(301);
+  for (int i = 0; i < 1000; i++) {
+    Add(rep.get(), i, &rnd, false /* concurrently */);
+  }
+  MarkReadOnly(rep.get());
+  ASSERT_EQ(1u, env_->GetThreadPoolQueueLen(Env::Priority::LOW));
+  // Unschedules the job
+  rep.reset();
+  ASSERT_EQ(0u, env_->GetThreadPoolQueueLen(Env::Priority::LOW));
+
+  blocker.WakeUp();
+  blocker.WaitUntilDone();
+  WaitForLowPriorityJobs();
+#ifndef NDEBUG
+  ASSERT_EQ(0, pack_jobs.load());
+#endif  // !NDEBUG
+}
+
+#ifndef NDEBUG
+TEST_P(SkipListSecRepTest, DestroyWhilePacking) {
+  // The rep is destroyed once the job packs it, and has to wait for it
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"SkipListSecRep::BGWorkPackSecIndex:Packing",
+        "SkipListSecRepTest::DestroyWhilePacking:Destroy"}});
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  std::unique_ptr<MemTableRep> rep(NewRep());
+  Random rnd(301);
+  for (int i = 0; i < 10000; i++) {
+    Add(rep.get(), i, &rnd, false /* concurrently */);
+  }
+  MarkReadOnly(rep.get());
+  TEST_SYNC_POINT("SkipListSecRepTest::DestroyWhilePacking:Destroy");
+  rep.reset();
+  WaitForLowPriorityJobs();
+}
+
+TEST_P(SkipListSecRepTest, DestroyBeforeStartedJobPacks) {
+  // The job is out of the queue, so it cannot be unscheduled any more, but
+  // only gets to the rep after it is destroyed
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"SkipListSecRep::BGWorkPackSecIndex:Start",
+        "SkipListSecRepTest::DestroyBeforeStartedJobPacks:Destroy"},
+       {"SkipListSecRepTest::DestroyBeforeStartedJobPacks:Destroyed",
+        "SkipListSecRep::BGWorkPackSecIndex:BeforeLock"}});
+  std::atomic<bool> packed{false};
+  SyncPoint::GetInstance()->SetCallBack(
+      "SkipListSecRep::BGWorkPackSecIndex:Packing",
+      [&](void*) { packed.store(true); });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  std::unique_ptr<MemTableRep> rep(NewRep());
+  Random rnd(301);
+  for (int i = 0; i < 1000; i++) {
+    Add(rep.get(), i, &rnd, false /* concurrently */);
+  }
+  MarkReadOnly(rep.get());
+  TEST_SYNC_POINT("SkipListSecRepTest::DestroyBeforeStartedJobPacks:Destroy");
+  rep.reset();
+  TEST_SYNC_POINT(
+      "SkipListSecRepTest::DestroyBeforeStartedJobPacks:Destroyed");
+  WaitForLowPriorityJobs();
+  ASSERT_FALSE(packed.load());
+}
+#endif  // !NDEBUG
+
+INSTANTIATE_TEST_CASE_P(
+    SkipListSecRepTest, SkipListSecRepTest,
+    ::testing::Values(SkipListSecFactory::kSecMbr,
+                      SkipListSecFactory::kSecValue));
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
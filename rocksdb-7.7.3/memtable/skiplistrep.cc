@@ -3,17 +3,29 @@
 //  COPYING file in the root directory) and Apache 2.0 License
 //  (found in the LICENSE.Apache file in the root directory).
 //
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
 #include <random>
+#include <vector>
 
 #include <iostream>
 
 #include "db/memtable.h"
 #include "memory/arena.h"
 #include "memtable/inlineskiplist.h"
+#include "memtable/sorted_entries_iterator.h"
+#include "rocksdb/env.h"
 #include "rocksdb/memtablerep.h"
 #include "rocksdb/utilities/options_type.h"
+#include "test_util/sync_point.h"
+#include "util/core_local.h"
+#include "util/mutexlock.h"
+#include "util/random.h"
 #include "util/string_util.h"
 #include "util/rtree.h"
+#include "util/RTree_mem.h"
 
 namespace ROCKSDB_NAMESPACE {
 namespace {
@@ -25,6 +37,7 @@ class SkipListRep : public MemTableRep {
 
   friend class LookaheadIterator;
   friend class SkipListMbrRep;
+  template <int NUMDIMS>
   friend class SkipListSecRep;
 
 public:
@@ -435,7 +448,28 @@ class SkipListMbrRep : public SkipListRep {
   }
 };
 
+// Keeps a secondary index next to the skip list: an R-tree over the
+// secondary attribute at the start of the values, either a 2D MBR
+// (NUMDIMS == 2) or a double (NUMDIMS == 1, indexed as the interval [v, v]),
+// whose entries point at the skip list entries. Queries then only visit the
+// entries they return instead of the whole memtable.
+// The index is sharded by core like ConcurrentArena: concurrent writers
+// insert into the skip list without locks and into the shard of their core,
+// so that they rarely wait for each other, while queries search all shards.
+// Once the memtable is immutable, a LOW priority job of the DB's Env packs
+// the shards into a single bulk loaded R-tree, which queries use instead from
+// then on, and frees the shards.
+template <int NUMDIMS>
 class SkipListSecRep : public SkipListRep {
+  static_assert(NUMDIMS == 1 || NUMDIMS == 2,
+                "the secondary attribute is a 2D MBR or a double");
+
+  using SecTree = RTree<const char*, double, NUMDIMS, double>;
+
+  // Bytes of the value holding the attribute
+  static constexpr size_t kSecAttributeSize =
+      NUMDIMS == 2 ? 4 * sizeof(double) : sizeof(double);
+
   public:
     explicit SkipListSecRep(const MemTableRep::KeyComparator& compare,
                                   Allocator* allocator,
@@ -443,6 +477,90 @@ class SkipListSecRep : public SkipListRep {
                                   const size_t lookahead) :
             SkipListRep(compare, allocator, transform, lookahead) {}
 
+  ~SkipListSecRep() override {
+    if (pack_state_ != nullptr) {
+      // Drops the job if it has not started and waits for it otherwise
+      pack_env_->UnSchedule(this, Env::Priority::LOW);
+      MutexLock l(&pack_state_->mutex);
+      pack_state_->rep = nullptr;
+    }
+  }
+
+  void ScheduleReadOnlyWork(Env* env) override {
+    if (pack_state_ != nullptr) {
+      return;
+    }
+    pack_env_ = env;
+    pack_state_ = std::make_shared<SecIndexPackState>();
+    pack_state_->rep = this;
+    pack_env_->Schedule(
+        &SkipListSecRep::BGWorkPackSecIndex,
+        new std::shared_ptr<SecIndexPackState>(pack_state_),
+        Env::Priority::LOW, this, &SkipListSecRep::UnschedulePackSecIndex);
+  }
+
+  // The index is allocated outside of the memtable allocator. Once the
+  // memtable is immutable, this stays what the shards took: the memtable
+  // list expects the usage of immutable memtables not to change, and the
+  // packed index takes about as much as the shards it replaces.
+  size_t ApproximateMemoryUsage() override {
+    return sec_index_bytes_.load(std::memory_order_relaxed);
+  }
+
+  void Insert(KeyHandle handle) override {
+    SkipListRep::Insert(handle);
+    AddToSecIndex(static_cast<const char*>(handle));
+  }
+
+  bool InsertKey(KeyHandle handle) override {
+    if (!SkipListRep::InsertKey(handle)) {
+      return false;
+    }
+    AddToSecIndex(static_cast<const char*>(handle));
+    return true;
+  }
+
+  void InsertWithHint(KeyHandle handle, void** hint) override {
+    SkipListRep::InsertWithHint(handle, hint);
+    AddToSecIndex(static_cast<const char*>(handle));
+  }
+
+  bool InsertKeyWithHint(KeyHandle handle, void** hint) override {
+    if (!SkipListRep::InsertKeyWithHint(handle, hint)) {
+      return false;
+    }
+    AddToSecIndex(static_cast<const char*>(handle));
+    return true;
+  }
+
+  void InsertWithHintConcurrently(KeyHandle handle, void** hint) override {
+    SkipListRep::InsertWithHintConcurrently(handle, hint);
+    AddToSecIndex(static_cast<const char*>(handle));
+  }
+
+  bool InsertKeyWithHintConcurrently(KeyHandle handle, void** hint) override {
+    if (!SkipListRep::InsertKeyWithHintConcurrently(handle, hint)) {
+      return false;
+    }
+    AddToSecIndex(static_cast<const char*>(handle));
+    return true;
+  }
+
+  void InsertConcurrently(KeyHandle handle) override {
+    SkipListRep::InsertConcurrently(handle);
+    AddToSecIndex(static_cast<const char*>(handle));
+  }
+
+  bool InsertKeyConcurrently(KeyHandle handle) override {
+    if (!SkipListRep::InsertKeyConcurrently(handle)) {
+      return false;
+    }
+    AddToSecIndex(static_cast<const char*>(handle));
+    return true;
+  }
+
+    // Scans the whole skip list, for flushes and for the queries the
+    // secondary index cannot answer, i.e. those of the other attribute type
     class Iterator : public SkipListRep::Iterator {
       public:
         explicit Iterator(
@@ -521,11 +639,243 @@ class SkipListSecRep : public SkipListRep {
   virtual MemTableRep::Iterator* GetIterator(
       IteratorContext* iterator_context,
       Arena* arena = nullptr) override {
+    double query_min[NUMDIMS];
+    double query_max[NUMDIMS];
+    if (iterator_context != nullptr &&
+        ReadSecQuery(*reinterpret_cast<RtreeIteratorContext*>(iterator_context),
+                     query_min, query_max)) {
+      std::vector<const char*> hits;
+      SecIndexSearch(query_min, query_max, &hits);
+      void* mem =
+          arena ? arena->AllocateAligned(sizeof(SortedEntriesIterator))
+                : operator new(sizeof(SortedEntriesIterator));
+      return new (mem) SortedEntriesIterator(cmp_, std::move(hits));
+    }
     void *mem =
         arena ? arena->AllocateAligned(sizeof(SkipListSecRep::Iterator))
               : operator new(sizeof(SkipListSecRep::Iterator));
     return new (mem) SkipListSecRep::Iterator(&skip_list_, iterator_context);
   }
+
+ private:
+  // Reads the attribute of the skip list entry `entry`. Returns false if the
+  // value is too short to hold one, e.g. for deletions.
+  static bool ReadSecAttribute(const char* entry, double* min, double* max) {
+    Slice internal_key = GetLengthPrefixedSlice(entry);
+    Slice value =
+        GetLengthPrefixedSlice(internal_key.data() + internal_key.size());
+    if (value.size() < kSecAttributeSize) {
+      return false;
+    }
+    double attribute[kSecAttributeSize / sizeof(double)];
+    memcpy(attribute, value.data(), kSecAttributeSize);
+    if (NUMDIMS == 2) {
+      // min_x, max_x, min_y, max_y
+      min[0] = attribute[0];
+      max[0] = attribute[1];
+      min[NUMDIMS - 1] = attribute[2];
+      max[NUMDIMS - 1] = attribute[3];
+    } else {
+      min[0] = max[0] = attribute[0];
+    }
+    return true;
+  }
+
+  // Reads the query of the iterator context into [min, max]. Returns false if
+  // the query is not one of the indexed attribute.
+  static bool ReadSecQuery(const RtreeIteratorContext& context, double* min,
+                           double* max) {
+    const Slice query(context.query_mbr);
+    if (NUMDIMS == 2 && query.size() == 32) {
+      const Mbr mbr = ReadSecQueryMbr(query);
+      min[0] = mbr.first.min;
+      max[0] = mbr.first.max;
+      min[NUMDIMS - 1] = mbr.second.min;
+      max[NUMDIMS - 1] = mbr.second.max;
+      return true;
+    } else if (NUMDIMS == 1 && query.size() == 16) {
+      const ValueRange range = ReadValueRange(query);
+      min[0] = range.range.min;
+      max[0] = range.range.max;
+      return true;
+    }
+    return false;
+  }
+
+  // Same test as IntersectMbrExcludeIID and IntersectValRangePoint
+  static bool Intersects(const double* a_min, const double* a_max,
+                         const double* b_min, const double* b_max) {
+    for (int axis = 0; axis < NUMDIMS; axis++) {
+      if (a_min[axis] > b_max[axis] || b_min[axis] > a_max[axis]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void AddToSecIndex(const char* entry) {
+    double min[NUMDIMS];
+    double max[NUMDIMS];
+    if (!ReadSecAttribute(entry, min, max)) {
+      return;
+    }
+    bool has_nan = false;
+    for (int axis = 0; axis < NUMDIMS; axis++) {
+      has_nan |= std::isnan(min[axis]) || std::isnan(max[axis]);
+    }
+    SecIndexShard* shard = sec_shards_.Access();
+    WriteLock l(&shard->mutex);
+    const size_t bytes = shard->ApproximateMemoryUsage();
+    if (has_nan) {
+      shard->unindexed.push_back(entry);
+    } else {
+      if (shard->tree == nullptr) {
+        shard->tree.reset(new SecTree());
+      }
+      shard->tree->Insert(min, max, entry);
+    }
+    sec_index_bytes_.fetch_add(shard->ApproximateMemoryUsage() - bytes,
+                               std::memory_order_relaxed);
+  }
+
+  // Adds the entries out of `unindexed` intersecting [min, max] to `*hits`
+  static void SearchUnindexed(const std::vector<const char*>& unindexed,
+                              const double* min, const double* max,
+                              std::vector<const char*>* hits) {
+    for (const char* entry : unindexed) {
+      double entry_min[NUMDIMS];
+      double entry_max[NUMDIMS];
+      if (ReadSecAttribute(entry, entry_min, entry_max) &&
+          Intersects(entry_min, entry_max, min, max)) {
+        hits->push_back(entry);
+      }
+    }
+  }
+
+  // Collects the entries intersecting [min, max] into `*hits`, in the order
+  // of the skip list
+  void SecIndexSearch(const double* min, const double* max,
+                      std::vector<const char*>* hits) {
+    auto add_hit = [hits](const char* entry) {
+      hits->push_back(entry);
+      return true;
+    };
+    ReadLock pack_lock(&pack_mutex_);
+    if (packed_) {
+      if (packed_tree_ != nullptr) {
+        packed_tree_->Visit(min, max, add_hit);
+      }
+      SearchUnindexed(packed_unindexed_, min, max, hits);
+    } else {
+      for (size_t i = 0; i < sec_shards_.Size(); i++) {
+        SecIndexShard* shard = sec_shards_.AccessAtCore(i);
+        ReadLock l(&shard->mutex);
+        if (shard->tree != nullptr) {
+          shard->tree->Visit(min, max, add_hit);
+        }
+        SearchUnindexed(shard->unindexed, min, max, hits);
+      }
+    }
+    std::sort(hits->begin(), hits->end(),
+              [this](const char* a, const char* b) { return cmp_(a, b) < 0; });
+  }
+
+  struct alignas(CACHE_LINE_SIZE) SecIndexShard {
+    // Taken by one writer at a time; readers only block the writers while
+    // they collect their hits
+    port::RWMutex mutex;
+    // Created by the first insert into the shard, so that idle shards take
+    // no node slab. The slabs are allocated on the heap, so that the shard
+    // can be freed once packed.
+    std::unique_ptr<SecTree> tree;
+    // Entries with NaN coordinates, which would corrupt the bounds of the
+    // R-tree nodes. Every query tests them; the comparisons never reject
+    // NaN, as for the full scan.
+    std::vector<const char*> unindexed;
+
+    size_t ApproximateMemoryUsage() const {
+      return (tree != nullptr ? tree->ApproximateMemoryUsage() : 0) +
+             unindexed.capacity() * sizeof(const char*);
+    }
+  };
+
+  // Shared by the rep and its packing job, so that the job can tell
+  // whether the rep still exists
+  struct SecIndexPackState {
+    // Held by the job while it packs
+    port::Mutex mutex;
+    SkipListSecRep* rep = nullptr;
+  };
+
+  static void BGWorkPackSecIndex(void* arg) {
+    std::unique_ptr<std::shared_ptr<SecIndexPackState>> state(
+        static_cast<std::shared_ptr<SecIndexPackState>*>(arg));
+    TEST_SYNC_POINT("SkipListSecRep::BGWorkPackSecIndex:Start");
+    TEST_SYNC_POINT("SkipListSecRep::BGWorkPackSecIndex:BeforeLock");
+    MutexLock l(&(*state)->mutex);
+    if ((*state)->rep != nullptr) {
+      TEST_SYNC_POINT("SkipListSecRep::BGWorkPackSecIndex:Packing");
+      (*state)->rep->PackSecIndex();
+    }
+  }
+
+  static void UnschedulePackSecIndex(void* arg) {
+    delete static_cast<std::shared_ptr<SecIndexPackState>*>(arg);
+  }
+
+  // Bulk loads the entries of all shards into packed_tree_, then frees the
+  // shards. The memtable is immutable, so the shards do not change any more.
+  void PackSecIndex() {
+    std::vector<typename SecTree::BulkEntry> entries;
+    std::vector<const char*> unindexed;
+    for (size_t i = 0; i < sec_shards_.Size(); i++) {
+      SecIndexShard* shard = sec_shards_.AccessAtCore(i);
+      ReadLock l(&shard->mutex);
+      unindexed.insert(unindexed.end(), shard->unindexed.begin(),
+                       shard->unindexed.end());
+      if (shard->tree == nullptr) {
+        continue;
+      }
+      typename SecTree::Iterator it;
+      for (shard->tree->GetFirst(it); !shard->tree->IsNull(it);
+           shard->tree->GetNext(it)) {
+        typename SecTree::BulkEntry entry;
+        it.GetBounds(entry.m_min, entry.m_max);
+        entry.m_data = *it;
+        entries.push_back(entry);
+      }
+    }
+    std::unique_ptr<SecTree> packed;
+    if (!entries.empty()) {
+      packed.reset(new SecTree(entries, SecTree::kSortTileRecursive));
+    }
+
+    WriteLock pack_lock(&pack_mutex_);
+    packed_tree_ = std::move(packed);
+    packed_unindexed_ = std::move(unindexed);
+    packed_ = true;
+    for (size_t i = 0; i < sec_shards_.Size(); i++) {
+      SecIndexShard* shard = sec_shards_.AccessAtCore(i);
+      WriteLock l(&shard->mutex);
+      shard->tree.reset();
+      std::vector<const char*>().swap(shard->unindexed);
+    }
+  }
+
+  CoreLocalArray<SecIndexShard> sec_shards_;
+  // Bytes taken by the shards, see ApproximateMemoryUsage()
+  std::atomic<size_t> sec_index_bytes_{0};
+  // Set once the memtable is immutable
+  Env* pack_env_ = nullptr;
+  std::shared_ptr<SecIndexPackState> pack_state_;
+  // Held shared by queries, and exclusively by the job to swap the shards
+  // for the packed index
+  port::RWMutex pack_mutex_;
+  // Whether queries search packed_tree_ and packed_unindexed_ instead of
+  // the shards, which are then empty. Never changes once set.
+  bool packed_ = false;
+  std::unique_ptr<SecTree> packed_tree_;
+  std::vector<const char*> packed_unindexed_;
 };
 
 }
@@ -566,7 +916,10 @@ MemTableRep* SkipListMbrFactory::CreateMemTableRep(
 MemTableRep* SkipListSecFactory::CreateMemTableRep(
         const MemTableRep::KeyComparator& compare, Allocator* allocator,
         const SliceTransform* transform, Logger* /*logger*/) {
-    return new SkipListSecRep(compare, allocator, transform, lookahead_);
+    if (attribute_ == SkipListSecFactory::kSecValue) {
+      return new SkipListSecRep<1>(compare, allocator, transform, lookahead_);
+    }
+    return new SkipListSecRep<2>(compare, allocator, transform, lookahead_);
 }
 
 }  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,91 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "db/memtable.h"
+#include "rocksdb/memtablerep.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Iterates a sorted vector of memtable entries, for the memtable reps that
+// answer a query by collecting its hits out of order, e.g. from an R-tree
+class SortedEntriesIterator : public MemTableRep::Iterator {
+ public:
+  // `entries` must be sorted by `cmp`
+  SortedEntriesIterator(const MemTableRep::KeyComparator& cmp,
+                        std::vector<const char*>&& entries)
+      : cmp_(cmp), entries_(std::move(entries)), pos_(entries_.size()) {}
+
+  bool Valid() const override { return pos_ < entries_.size(); }
+
+  const char* key() const override {
+    assert(Valid());
+    return entries_[pos_];
+  }
+
+  void Next() override {
+    assert(Valid());
+    pos_++;
+  }
+
+  void Prev() override {
+    assert(Valid());
+    pos_ = pos_ == 0 ? entries_.size() : pos_ - 1;
+  }
+
+  // Advance to the first entry with a key >= target
+  void Seek(const Slice& internal_key, const char* memtable_key) override {
+    const char* target = memtable_key != nullptr
+                             ? memtable_key
+                             : EncodeKey(&tmp_, internal_key);
+    pos_ = std::lower_bound(entries_.begin(), entries_.end(), target,
+                            [this](const char* entry, const char* t) {
+                              return cmp_(entry, t) < 0;
+                            }) -
+           entries_.begin();
+  }
+
+  // Retreat to the last entry with a key <= target
+  void SeekForPrev(const Slice& internal_key,
+                   const char* memtable_key) override {
+    const char* target = memtable_key != nullptr
+                             ? memtable_key
+                             : EncodeKey(&tmp_, internal_key);
+    const size_t end =
+        std::upper_bound(entries_.begin(), entries_.end(), target,
+                         [this](const char* t, const char* entry) {
+                           return cmp_(t, entry) < 0;
+                         }) -
+        entries_.begin();
+    pos_ = end == 0 ? entries_.size() : end - 1;
+  }
+
+  void RandomSeek() override {
+    pos_ = entries_.empty() ? 0
+                         : Random::GetTLSInstance()->Uniform(
+                               static_cast<int>(entries_.size()));
+  }
+
+  void SeekToFirst() override { pos_ = 0; }
+
+  void SeekToLast() override {
+    pos_ = entries_.empty() ? 0 : entries_.size() - 1;
+  }
+
+ private:
+  const MemTableRep::KeyComparator& cmp_;
+  std::vector<const char*> entries_;
+  // entries_.size() when not valid
+  size_t pos_;
+  std::string tmp_;  // For passing to EncodeKey
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -908,7 +908,13 @@ ImmutableCFOptions::ImmutableCFOptions(const ColumnFamilyOptions& cf_options)
       blob_cache(cf_options.blob_cache),
       global_sec_index(cf_options.create_global_sec_index),
       global_index_loc(cf_options.global_sec_index_loc),
-      global_sec_index_is_spatial(cf_options.global_sec_index_is_spatial) {}
+      global_sec_index_is_spatial(cf_options.global_sec_index_is_spatial),
+      global_sec_index_checkpoint_interval(
+          cf_options.global_sec_index_checkpoint_interval),
+      global_sec_index_repack_threshold(
+          cf_options.global_sec_index_repack_threshold),
+      global_sec_index_memory_budget(
+          cf_options.global_sec_index_memory_budget) {}
 
 ImmutableOptions::ImmutableOptions() : ImmutableOptions(Options()) {}
 
@@ -92,6 +92,10 @@ struct ImmutableCFOptions {
   bool global_sec_index;
   char* global_index_loc;
   bool global_sec_index_is_spatial;
+
+  uint64_t global_sec_index_checkpoint_interval;
+  uint64_t global_sec_index_repack_threshold;
+  uint64_t global_sec_index_memory_budget;
 };
 
 struct ImmutableOptions : public ImmutableDBOptions, public ImmutableCFOptions {
@@ -63,6 +63,7 @@ LIB_SOURCES =                                                   \
   db/flush_job.cc                                               \
   db/flush_scheduler.cc                                         \
   db/forward_iterator.cc                                        \
+  db/global_sec_index/global_sec_index_log.cc                   \
   db/import_column_family_job.cc                                \
   db/internal_stats.cc                                          \
   db/logs_with_prep_tracker.cc                                  \
@@ -78,6 +79,7 @@ LIB_SOURCES =                                                   \
   db/range_del_aggregator.cc                                    \
   db/range_tombstone_fragmenter.cc                              \
   db/repair.cc                                                  \
+  db/secondary_query_iterator.cc                                \
   db/seqno_to_time_mapping.cc                                   \
   db/snapshot_impl.cc                                           \
   db/table_cache.cc                                             \
@@ -193,6 +195,8 @@ LIB_SOURCES =                                                   \
   table/block_based/rtree_sec_index_iterator.cc                 \
   table/block_based/rtree_sec_index_reader.cc                   \
   table/block_based/reader_common.cc                            \
+  table/block_based/sec_attribute_column.cc                     \
+  table/block_based/sec_index_query_plan.cc                     \
   table/block_based/uncompression_dict_reader.cc                \
   table/block_fetcher.cc                                        \
   table/cuckoo/cuckoo_table_builder.cc                          \
@@ -202,6 +206,7 @@ LIB_SOURCES =                                                   \
   table/get_context.cc                                          \
   table/iterator.cc                                             \
   table/merging_iterator.cc                                     \
+  table/sec_fan_out_iterator.cc                                 \
   table/meta_blocks.cc                                          \
   table/persistent_cache_helper.cc                              \
   table/plain/plain_table_bloom.cc                              \
@@ -481,6 +486,7 @@ TEST_MAIN_SOURCES =                                                     \
   db/db_properties_test.cc                                              \
   db/db_range_del_test.cc                                               \
   db/db_rate_limiter_test.cc                                            \
+  db/db_secondary_index_test.cc                                         \
   db/db_secondary_test.cc                                               \
   db/db_sst_test.cc                                                     \
   db/db_statistics_test.cc                                              \
@@ -503,6 +509,7 @@ TEST_MAIN_SOURCES =                                                     \
   db/file_indexer_test.cc                                               \
   db/filename_test.cc                                                   \
   db/flush_job_test.cc                                                  \
+  db/global_sec_index/global_sec_index_log_test.cc                      \
   db/listener_test.cc                                                   \
   db/log_test.cc                                                        \
   db/manual_compaction_test.cc                                          \
@@ -542,6 +549,7 @@ TEST_MAIN_SOURCES =                                                     \
   memory/arena_test.cc                                                  \
   memory/memory_allocator_test.cc                                       \
   memtable/inlineskiplist_test.cc                                       \
+  memtable/skiplist_sec_rep_test.cc                                     \
   memtable/skiplist_test.cc                                             \
   memtable/rtreerep.cc                                                 \
   memtable/write_buffer_manager_test.cc                                 \
@@ -558,6 +566,7 @@ TEST_MAIN_SOURCES =                                                     \
   table/block_based/data_block_hash_index_test.cc                       \
   table/block_based/full_filter_block_test.cc                           \
   table/block_based/partitioned_filter_block_test.cc                    \
+  table/block_based/sec_index_query_plan_test.cc                        \
   table/cleanable_test.cc                                               \
   table/cuckoo/cuckoo_table_builder_test.cc                             \
   table/cuckoo/cuckoo_table_reader_test.cc                              \
@@ -575,6 +584,7 @@ TEST_MAIN_SOURCES =                                                     \
   trace_replay/block_cache_tracer_test.cc                               \
   trace_replay/io_tracer_test.cc                                        \
   util/autovector_test.cc                                               \
+  util/bounded_mpsc_queue_test.cc                                       \
   util/bloom_test.cc                                                    \
   util/coding_test.cc                                                   \
   util/crc32c_test.cc                                                   \
@@ -588,6 +598,7 @@ TEST_MAIN_SOURCES =                                                     \
   util/rate_limiter_test.cc                                             \
   util/repeatable_thread_test.cc                                        \
   util/ribbon_test.cc                                                   \
+  util/rtree_test.cc                                                    \
   util/slice_test.cc                                                    \
   util/slice_transform_test.cc                                          \
   util/timer_queue_test.cc                                              \
@@ -12,12 +12,17 @@
 #include "table/block_based/block.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <typeinfo>
 #include <unordered_map>
 #include <vector>
 
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
 #include "monitoring/perf_context_imp.h"
 #include "port/port.h"
 #include "port/stack_trace.h"
@@ -26,6 +31,7 @@
 #include "table/block_based/data_block_footer.h"
 #include "table/format.h"
 #include "util/coding.h"
+#include "util/math.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -683,18 +689,371 @@ bool DataBlockIter::ParseNextSpatialDataKey(bool* is_shared) {
   return ret;
 }
 
+namespace {
+// Coordinates are read with unaligned loads, as those of the attribute
+// columns are stored at any offset of the block, and widened to double
+template <typename T>
+inline double LoadSecCoordinate(const char* p) {
+  T coordinate;
+  memcpy(&coordinate, p, sizeof(T));
+  return coordinate;
+}
+
+#if defined(__AVX512F__)
+template <typename T>
+inline __m512d LoadSecCoordinates(const char* p);
+
+template <>
+inline __m512d LoadSecCoordinates<double>(const char* p) {
+  return _mm512_loadu_pd(p);
+}
+
+template <>
+inline __m512d LoadSecCoordinates<float>(const char* p) {
+  // The zero-masked form, as GCC warns about the undefined source operand of
+  // the unmasked one
+  return _mm512_maskz_cvtps_pd(
+      0xff, _mm256_loadu_ps(reinterpret_cast<const float*>(p)));
+}
+#elif defined(__AVX2__)
+template <typename T>
+inline __m256d LoadSecCoordinates(const char* p);
+
+template <>
+inline __m256d LoadSecCoordinates<double>(const char* p) {
+  return _mm256_loadu_pd(reinterpret_cast<const double*>(p));
+}
+
+template <>
+inline __m256d LoadSecCoordinates<float>(const char* p) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(reinterpret_cast<const float*>(p)));
+}
+#endif
+
+// Bit i is set if MBR i of the first `count`, at most 64, intersects
+// `query`. The tests are written as rejections, like the scalar test of the
+// R-tree blocks, so that both agree on NaN coordinates.
+template <typename T>
+uint64_t SecMbrHits(const char* min_x, const char* max_x, const char* min_y,
+                    const char* max_y, uint32_t count, const Mbr& query) {
+  uint64_t hits = 0;
+  uint32_t i = 0;
+#if defined(__AVX512F__)
+  const __m512d q_min_x = _mm512_set1_pd(query.first.min);
+  const __m512d q_max_x = _mm512_set1_pd(query.first.max);
+  const __m512d q_min_y = _mm512_set1_pd(query.second.min);
+  const __m512d q_max_y = _mm512_set1_pd(query.second.max);
+  for (; i + 8 <= count; i += 8) {
+    const size_t at = i * sizeof(T);
+    __mmask8 miss = _mm512_cmp_pd_mask(LoadSecCoordinates<T>(min_x + at),
+                                       q_max_x, _CMP_GT_OQ);
+    miss |= _mm512_cmp_pd_mask(q_min_x, LoadSecCoordinates<T>(max_x + at),
+                               _CMP_GT_OQ);
+    miss |= _mm512_cmp_pd_mask(LoadSecCoordinates<T>(min_y + at), q_max_y,
+                               _CMP_GT_OQ);
+    miss |= _mm512_cmp_pd_mask(q_min_y, LoadSecCoordinates<T>(max_y + at),
+                               _CMP_GT_OQ);
+    hits |= static_cast<uint64_t>(static_cast<uint8_t>(~miss)) << i;
+  }
+#elif defined(__AVX2__)
+  const __m256d q_min_x = _mm256_set1_pd(query.first.min);
+  const __m256d q_max_x = _mm256_set1_pd(query.first.max);
+  const __m256d q_min_y = _mm256_set1_pd(query.second.min);
+  const __m256d q_max_y = _mm256_set1_pd(query.second.max);
+  for (; i + 4 <= count; i += 4) {
+    const size_t at = i * sizeof(T);
+    __m256d miss =
+        _mm256_cmp_pd(LoadSecCoordinates<T>(min_x + at), q_max_x, _CMP_GT_OQ);
+    miss = _mm256_or_pd(miss, _mm256_cmp_pd(q_min_x,
+                                            LoadSecCoordinates<T>(max_x + at),
+                                            _CMP_GT_OQ));
+    miss = _mm256_or_pd(miss,
+                        _mm256_cmp_pd(LoadSecCoordinates<T>(min_y + at),
+                                      q_max_y, _CMP_GT_OQ));
+    miss = _mm256_or_pd(miss, _mm256_cmp_pd(q_min_y,
+                                            LoadSecCoordinates<T>(max_y + at),
+                                            _CMP_GT_OQ));
+    hits |= static_cast<uint64_t>(~_mm256_movemask_pd(miss) & 0xf) << i;
+  }
+#endif
+  // Scalar fallback, and the entries left over by the vector loop
+  for (; i < count; i++) {
+    const size_t at = i * sizeof(T);
+    const bool miss = LoadSecCoordinate<T>(min_x + at) > query.first.max ||
+                      query.first.min > LoadSecCoordinate<T>(max_x + at) ||
+                      LoadSecCoordinate<T>(min_y + at) > query.second.max ||
+                      query.second.min > LoadSecCoordinate<T>(max_y + at);
+    hits |= static_cast<uint64_t>(!miss) << i;
+  }
+  return hits;
+}
+
+// Bit i is set if value i of the first `count`, at most 64, lies in `query`
+uint64_t SecValueHits(const char* values, uint32_t count,
+                      const ValueRange& query) {
+  uint64_t hits = 0;
+  uint32_t i = 0;
+#if defined(__AVX512F__)
+  const __m512d q_min = _mm512_set1_pd(query.range.min);
+  const __m512d q_max = _mm512_set1_pd(query.range.max);
+  for (; i + 8 <= count; i += 8) {
+    const __m512d v = LoadSecCoordinates<double>(values + i * sizeof(double));
+    __mmask8 miss = _mm512_cmp_pd_mask(v, q_max, _CMP_GT_OQ);
+    miss |= _mm512_cmp_pd_mask(q_min, v, _CMP_GT_OQ);
+    hits |= static_cast<uint64_t>(static_cast<uint8_t>(~miss)) << i;
+  }
+#elif defined(__AVX2__)
+  const __m256d q_min = _mm256_set1_pd(query.range.min);
+  const __m256d q_max = _mm256_set1_pd(query.range.max);
+  for (; i + 4 <= count; i += 4) {
+    const __m256d v = LoadSecCoordinates<double>(values + i * sizeof(double));
+    const __m256d miss = _mm256_or_pd(_mm256_cmp_pd(v, q_max, _CMP_GT_OQ),
+                                      _mm256_cmp_pd(q_min, v, _CMP_GT_OQ));
+    hits |= static_cast<uint64_t>(~_mm256_movemask_pd(miss) & 0xf) << i;
+  }
+#endif
+  for (; i < count; i++) {
+    const double v = LoadSecCoordinate<double>(values + i * sizeof(double));
+    const bool miss = v > query.range.max || query.range.min > v;
+    hits |= static_cast<uint64_t>(!miss) << i;
+  }
+  return hits;
+}
+}  // namespace
+
+bool DataBlockIter::FillSecSpatialBatch(uint32_t offset) {
+  SecSpatialBatch& batch = *sec_batch_;
+  const char* limit = data_ + restarts_;
+  const char* p = data_ + offset;
+  uint32_t count = 0;
+  // Values too short for an MBR never match
+  uint64_t short_values = 0;
+  while (count < SecSpatialBatch::kMaxEntries && p < limit) {
+    uint32_t shared, non_shared, value_length;
+    const char* key =
+        DecodeEntry()(p, limit, &shared, &non_shared, &value_length);
+    if (key == nullptr) {
+      // Reported when the iterator gets there
+      break;
+    }
+    const char* value = key + non_shared;
+    batch.entry_offset[count] = static_cast<uint32_t>(p - data_);
+    batch.key_offset[count] = static_cast<uint32_t>(key - data_);
+    batch.shared[count] = shared;
+    batch.non_shared[count] = non_shared;
+    batch.value_length[count] = value_length;
+    if (value_length >= 4 * sizeof(double)) {
+      memcpy(&batch.min_x[count], value, sizeof(double));
+      memcpy(&batch.max_x[count], value + 8, sizeof(double));
+      memcpy(&batch.min_y[count], value + 16, sizeof(double));
+      memcpy(&batch.max_y[count], value + 24, sizeof(double));
+    } else {
+      short_values |= uint64_t{1} << count;
+      batch.min_x[count] = batch.max_x[count] = 0;
+      batch.min_y[count] = batch.max_y[count] = 0;
+    }
+    p = value + value_length;
+    count++;
+  }
+  batch.entry_offset[count] = static_cast<uint32_t>(p - data_);
+  batch.data = data_;
+  batch.count = count;
+  batch.pos = 0;
+  batch.hits = SecMbrHits<double>(reinterpret_cast<const char*>(batch.min_x),
+                                  reinterpret_cast<const char*>(batch.max_x),
+                                  reinterpret_cast<const char*>(batch.min_y),
+                                  reinterpret_cast<const char*>(batch.max_y),
+                                  count, query_mbr_) &
+               ~short_values;
+  return count > 0;
+}
+
 bool DataBlockIter::ParseNextSecSpatialDataKey(bool* is_shared) {
-  bool ret = false;
-  do {
-    // std::cout << *reinterpret_cast<const int*>(key().data()) << std::endl;
-    ret = ParseNextDataKey(is_shared);
+  if (query_mbr_.empty()) {
+    // Full scan
+    bool ret = ParseNextDataKey(is_shared);
     UpdateKey();
-    
-  } while (Valid() && !IntersectMbrExlucdeIID(value(), query_mbr_));
-  return ret;
+    return ret;
+  }
+  if (sec_column_.type == SecAttributeColumnType::kMbr ||
+      sec_column_.type == SecAttributeColumnType::kQuantizedMbr) {
+    return ParseNextSecColumnKey(is_shared);
+  }
+  if (sec_batch_ == nullptr) {
+    sec_batch_.reset(new SecSpatialBatch());
+  }
+  SecSpatialBatch& batch = *sec_batch_;
+  uint32_t offset = NextEntryOffset();
+  for (;;) {
+    // The batch only goes on from the entry following the iterator's, whose
+    // key the next keys are delta-encoded against
+    if (batch.data != data_ || batch.pos >= batch.count ||
+        batch.entry_offset[batch.pos] != offset) {
+      if (!FillSecSpatialBatch(offset)) {
+        break;
+      }
+    }
+    const uint64_t pending = batch.hits >> batch.pos;
+    const uint32_t last = pending != 0
+                              ? batch.pos + CountTrailingZeroBits(pending)
+                              : batch.count - 1;
+    // Rebuild the key of `last`, from the last entry before it that does not
+    // share a prefix with its predecessor
+    uint32_t first = last;
+    while (first > batch.pos && batch.shared[first] != 0) {
+      first--;
+    }
+    for (uint32_t i = first; i <= last; i++) {
+      const char* key = data_ + batch.key_offset[i];
+      if (batch.shared[i] == 0) {
+        raw_key_.SetKey(Slice(key, batch.non_shared[i]), false /* copy */);
+      } else if (raw_key_.Size() < batch.shared[i]) {
+        CorruptionError();
+        return false;
+      } else {
+        raw_key_.TrimAppend(batch.shared[i], key, batch.non_shared[i]);
+      }
+    }
+    batch.pos = last + 1;
+    offset = batch.entry_offset[batch.pos];
+    if (pending != 0) {
+      *is_shared = batch.shared[last] != 0;
+      current_ = batch.entry_offset[last];
+      value_ = Slice(data_ + batch.key_offset[last] + batch.non_shared[last],
+                     batch.value_length[last]);
+      while (restart_index_ + 1 < num_restarts_ &&
+             GetRestartPoint(restart_index_ + 1) < current_) {
+        ++restart_index_;
+      }
+      UpdateKey();
+      return true;
+    }
+  }
+  if (offset < restarts_) {
+    CorruptionError();
+  } else {
+    current_ = restarts_;
+    restart_index_ = num_restarts_;
+  }
+  return false;
+}
+
+void DataBlockIter::FillSecColumnHits(uint32_t first) {
+  const uint32_t count = std::min(sec_column_.count - first, uint32_t{64});
+  if (sec_column_.type == SecAttributeColumnType::kValue) {
+    sec_column_hits_ = SecValueHits(
+        sec_column_.Coordinate(0) + first * sizeof(double), count,
+        query_valrange_);
+  } else {
+    const size_t at = first * SecAttributeColumn::CoordinateSize(
+                                  sec_column_.type);
+    const char* min_x = sec_column_.Coordinate(0) + at;
+    const char* max_x = sec_column_.Coordinate(1) + at;
+    const char* min_y = sec_column_.Coordinate(2) + at;
+    const char* max_y = sec_column_.Coordinate(3) + at;
+    sec_column_hits_ =
+        sec_column_.type == SecAttributeColumnType::kQuantizedMbr
+            ? SecMbrHits<float>(min_x, max_x, min_y, max_y, count, query_mbr_)
+            : SecMbrHits<double>(min_x, max_x, min_y, max_y, count,
+                                 query_mbr_);
+  }
+  sec_column_hits_first_ = first;
+  sec_column_hits_count_ = count;
+}
+
+bool DataBlockIter::SeekToSecColumnEntry(uint32_t offset, bool* is_shared) {
+  if (offset >= restarts_) {
+    CorruptionError();
+    return false;
+  }
+  // The key of the entry is delta-encoded against those since the last
+  // restart point before it, so parse from there unless the iterator is
+  // already on the way
+  uint32_t left = 0;
+  uint32_t right = num_restarts_ - 1;
+  while (left < right) {
+    const uint32_t mid = left + (right - left + 1) / 2;
+    if (GetRestartPoint(mid) <= offset) {
+      left = mid;
+    } else {
+      right = mid - 1;
+    }
+  }
+  const uint32_t next = NextEntryOffset();
+  if (next > offset || next < GetRestartPoint(left)) {
+    SeekToRestartPoint(left);
+  }
+  do {
+    if (!ParseNextDataKey(is_shared)) {
+      if (status_.ok()) {
+        CorruptionError();
+      }
+      return false;
+    }
+  } while (current_ < offset);
+  if (current_ != offset) {
+    // The column does not point at an entry
+    CorruptionError();
+    return false;
+  }
+  return true;
+}
+
+bool DataBlockIter::ParseNextSecColumnKey(bool* is_shared) {
+  const uint32_t next = NextEntryOffset();
+  // The first column entry at or after the iterator's next entry. It is
+  // usually the one following the last the iterator moved to, unless the
+  // iterator was positioned otherwise since.
+  uint32_t i = sec_column_next_;
+  if (i > sec_column_.count ||
+      (i > 0 && sec_column_.EntryOffset(i - 1) >= next) ||
+      (i < sec_column_.count && sec_column_.EntryOffset(i) < next)) {
+    uint32_t left = 0;
+    uint32_t right = sec_column_.count;
+    while (left < right) {
+      const uint32_t mid = left + (right - left) / 2;
+      if (sec_column_.EntryOffset(mid) < next) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    i = left;
+  }
+  while (i < sec_column_.count) {
+    if (i < sec_column_hits_first_ ||
+        i >= sec_column_hits_first_ + sec_column_hits_count_) {
+      FillSecColumnHits(i);
+    }
+    const uint64_t pending = sec_column_hits_ >> (i - sec_column_hits_first_);
+    if (pending == 0) {
+      i = sec_column_hits_first_ + sec_column_hits_count_;
+      continue;
+    }
+    i += CountTrailingZeroBits(pending);
+    if (!SeekToSecColumnEntry(sec_column_.EntryOffset(i), is_shared)) {
+      return false;
+    }
+    sec_column_next_ = ++i;
+    // The quantized MBRs let more entries through than the exact ones
+    if (sec_column_.type != SecAttributeColumnType::kQuantizedMbr ||
+        SecMbrHits<double>(value_.data(), value_.data() + 8,
+                           value_.data() + 16, value_.data() + 24, 1,
+                           query_mbr_) != 0) {
+      UpdateKey();
+      return true;
+    }
+  }
+  current_ = restarts_;
+  restart_index_ = num_restarts_;
+  return false;
 }
 
 bool DataBlockIter::ParseNextSecDataKey(bool* is_shared) {
+  if (!query_valrange_.empty() &&
+      sec_column_.type == SecAttributeColumnType::kValue) {
+    return ParseNextSecColumnKey(is_shared);
+  }
   bool ret = false;
   do {
     ret = ParseNextDataKey(is_shared);
@@ -1007,7 +1366,7 @@ uint32_t Block::NumRestarts() const {
     // Such check is for backward compatibility. We can ensure legacy block
     // with a vary large num_restarts i.e. >= 0x80000000 can be interpreted
     // correctly as no HashIndex even if the MSB of num_restarts is set.
-    return num_restarts;
+    return ClearSecAttributeColumnFlag(num_restarts);
   }
   BlockBasedTableOptions::DataBlockIndexType index_type;
   UnPackIndexTypeAndNumRestarts(block_footer, &index_type, &num_restarts);
@@ -1046,30 +1405,32 @@ Block::Block(BlockContents&& contents, size_t read_amp_bytes_per_bit,
   } else {
     // Should only decode restart points for uncompressed blocks
     num_restarts_ = NumRestarts();
-    switch (IndexType()) {
+    // The end of the restarts, or of the hash index if there is one
+    uint32_t end = static_cast<uint32_t>(size_ - sizeof(uint32_t));
+    if (HasSecAttributeColumn(DecodeFixed32(data_ + end)) &&
+        !sec_column_.Parse(data_, &end)) {
+      size_ = 0;  // Error marker
+      end = 0;
+    }
+    switch (size_ == 0 ? BlockBasedTableOptions::kDataBlockBinarySearch
+                       : IndexType()) {
       case BlockBasedTableOptions::kDataBlockBinarySearch:
-        restart_offset_ = static_cast<uint32_t>(size_) -
-                          (1 + num_restarts_) * sizeof(uint32_t);
-        if (restart_offset_ > size_ - sizeof(uint32_t)) {
+        restart_offset_ = end - num_restarts_ * sizeof(uint32_t);
+        if (restart_offset_ > end) {
           // The size is too small for NumRestarts() and therefore
           // restart_offset_ wrapped around.
           size_ = 0;
         }
         break;
       case BlockBasedTableOptions::kDataBlockBinaryAndHash:
-        if (size_ < sizeof(uint32_t) /* block footer */ +
-                        sizeof(uint16_t) /* NUM_BUCK */) {
+        if (end < sizeof(uint16_t) /* NUM_BUCK */) {
           size_ = 0;
           break;
         }
 
         uint16_t map_offset;
-        data_block_hash_index_.Initialize(
-            contents.data.data(),
-            static_cast<uint16_t>(contents.data.size() -
-                                  sizeof(uint32_t)), /*chop off
-                                                 NUM_RESTARTS*/
-            &map_offset);
+        data_block_hash_index_.Initialize(data_, static_cast<uint16_t>(end),
+                                          &map_offset);
 
         restart_offset_ = map_offset - num_restarts_ * sizeof(uint32_t);
 
@@ -1218,6 +1579,9 @@ DataBlockIter* Block::NewSecondaryIndexDataIterator(const Comparator* raw_ucmp,
           data_block_hash_index_.Valid() ? &data_block_hash_index_ : nullptr, context->query_mbr,
           is_secondary_index_scan); 
     }
+    if (is_secondary_index_scan) {
+      ret_iter->sec_column_ = sec_column_;
+    }
 
     if (read_amp_bitmap_) {
       if (read_amp_bitmap_->GetStatistics() != stats) {
@@ -1271,6 +1635,9 @@ DataBlockIter* Block::NewSecondaryIndexDataIterator1D(const Comparator* raw_ucmp
           data_block_hash_index_.Valid() ? &data_block_hash_index_ : nullptr, context->query_mbr,
           is_secondary_index_scan, is_secondary_index_spatial);       
     }
+    if (is_secondary_index_scan) {
+      ret_iter->sec_column_ = sec_column_;
+    }
 
     if (read_amp_bitmap_) {
       if (read_amp_bitmap_->GetStatistics() != stats) {
@@ -1457,35 +1824,6 @@ bool DataBlockIter::IntersectValueRangePoint(
     return true;
 }
 
-bool DataBlockIter::IntersectMbrExlucdeIID(
-    const Slice& aa_orig,
-    Mbr bb) {
-  // If the query bounding box is empty, return true, which corresponds to a
-    // full table scan
-    if (bb.empty()) {
-      return true;
-    }
-
-    // Make a mutable copy of the slice
-    Slice aa = Slice(aa_orig);
-
-    double aa_min;
-    double aa_max;
-
-    aa_min = *reinterpret_cast<const double*>(aa.data());
-    aa_max = *reinterpret_cast<const double*>(aa.data() + 8);
-    if (aa_min > bb.first.max || bb.first.min > aa_max) {
-      return false;
-    }
-
-    aa_min = *reinterpret_cast<const double*>(aa.data() + 16);
-    aa_max = *reinterpret_cast<const double*>(aa.data() + 24);
-    if (aa_min > bb.second.max || bb.second.min > aa_max) {
-      return false;
-    }
-    return true;
-}
-
 bool RtreeBlockIter::IntersectMbr(
     const Slice& aa_orig,
     Mbr bb) {
@@ -12,6 +12,7 @@
 #include <stdint.h>
 
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -23,6 +24,7 @@
 #include "rocksdb/table.h"
 #include "table/block_based/block_prefix_index.h"
 #include "table/block_based/data_block_hash_index.h"
+#include "table/block_based/sec_attribute_column.h"
 #include "table/format.h"
 #include "table/internal_iterator.h"
 #include "test_util/sync_point.h"
@@ -277,6 +279,7 @@ class Block {
   uint32_t num_restarts_;
   std::unique_ptr<BlockReadAmpBitmap> read_amp_bitmap_;
   DataBlockHashIndex data_block_hash_index_;
+  SecAttributeColumn sec_column_;
 };
 
 // A `BlockIter` iterates over the entries in a `Block`'s data buffer. The
@@ -573,6 +576,7 @@ class DataBlockIter : public BlockIter<Slice> {
     read_amp_bitmap_ = read_amp_bitmap;
     last_bitmap_offset_ = current_ + 1;
     data_block_hash_index_ = data_block_hash_index;
+    ResetSecScanState();
     is_spatial_ = false;
     is_sec_index_scan_ = false;
   }
@@ -590,6 +594,7 @@ class DataBlockIter : public BlockIter<Slice> {
     read_amp_bitmap_ = read_amp_bitmap;
     last_bitmap_offset_ = current_ + 1;
     data_block_hash_index_ = data_block_hash_index;
+    ResetSecScanState();
     Slice query_slice(query);
     query_mbr_ = ReadQueryMbr(query_slice);
     is_spatial_ = true;
@@ -611,6 +616,7 @@ class DataBlockIter : public BlockIter<Slice> {
     read_amp_bitmap_ = read_amp_bitmap;
     last_bitmap_offset_ = current_ + 1;
     data_block_hash_index_ = data_block_hash_index;
+    ResetSecScanState();
     Slice query_slice(query);
     query_mbr_ = ReadValueMbr(query_slice);
     is_spatial_ = true;
@@ -633,6 +639,7 @@ class DataBlockIter : public BlockIter<Slice> {
     read_amp_bitmap_ = read_amp_bitmap;
     last_bitmap_offset_ = current_ + 1;
     data_block_hash_index_ = data_block_hash_index;
+    ResetSecScanState();
     Slice query_slice(query);
     query_valrange_ = ReadValueRange(query_slice);
     is_spatial_ = is_secondary_index_spatial;
@@ -722,10 +729,68 @@ class DataBlockIter : public BlockIter<Slice> {
   bool IntersectMbr(
         const Slice& aa_orig,
         Mbr bb);
-  
-  bool IntersectMbrExlucdeIID(
-        const Slice& aa_orig,
-        Mbr bb);
+
+  // Secondary spatial scans decode the entries following the current one
+  // ahead of the iterator, gather their MBRs per coordinate and test up to
+  // kMaxEntries of them against the query at once with vector compares. The
+  // iterator then walks the hit bitmap, only rebuilding the keys the entries
+  // it steps over are needed for.
+  struct SecSpatialBatch {
+    static constexpr uint32_t kMaxEntries = 64;
+
+    // The block the entries were decoded from, or nullptr
+    const char* data = nullptr;
+    uint32_t count = 0;
+    // The next entry to move to
+    uint32_t pos = 0;
+    // Bit i is set if the MBR of entry i intersects the query
+    uint64_t hits = 0;
+    // Entry offsets in the block, followed by the offset of the entry after
+    // the last one
+    uint32_t entry_offset[kMaxEntries + 1];
+    uint32_t key_offset[kMaxEntries];
+    uint32_t shared[kMaxEntries];
+    uint32_t non_shared[kMaxEntries];
+    uint32_t value_length[kMaxEntries];
+    // The MBRs, one array per coordinate
+    alignas(64) double min_x[kMaxEntries];
+    alignas(64) double max_x[kMaxEntries];
+    alignas(64) double min_y[kMaxEntries];
+    alignas(64) double max_y[kMaxEntries];
+  };
+  std::unique_ptr<SecSpatialBatch> sec_batch_;
+
+  // Decodes the entries from `offset` on into sec_batch_. Returns false at
+  // the end of the block or on a corrupted entry.
+  bool FillSecSpatialBatch(uint32_t offset);
+
+  // The secondary attribute column of the block, if it has one and the
+  // iterator is a secondary index scan. Scans then test the column instead
+  // of decoding the entries, and only decode those that pass along with the
+  // ones their keys are delta-encoded against.
+  SecAttributeColumn sec_column_;
+  // Column entries [sec_column_hits_first_, + sec_column_hits_count_) were
+  // tested against the query, bit i of sec_column_hits_ is set if the entry
+  // sec_column_hits_first_ + i passed
+  uint32_t sec_column_hits_first_ = 0;
+  uint32_t sec_column_hits_count_ = 0;
+  uint64_t sec_column_hits_ = 0;
+  // The column entry after the one the iterator last moved to
+  uint32_t sec_column_next_ = 0;
+
+  void FillSecColumnHits(uint32_t first);
+  // Moves to the entry at `offset`. Returns false on a corrupted entry.
+  bool SeekToSecColumnEntry(uint32_t offset, bool* is_shared);
+  bool ParseNextSecColumnKey(bool* is_shared);
+
+  void ResetSecScanState() {
+    if (sec_batch_ != nullptr) {
+      sec_batch_->data = nullptr;
+    }
+    sec_column_ = SecAttributeColumn();
+    sec_column_hits_count_ = 0;
+    sec_column_next_ = 0;
+  }
 
   bool IntersectValueRangePoint(
         const Slice& aa_orig,
@@ -113,6 +113,20 @@ bool GoodCompressionRatio(size_t compressed_size, size_t raw_size) {
   return compressed_size < raw_size - (raw_size / 8u);
 }
 
+SecAttributeColumnType GetSecAttributeColumnType(
+    const BlockBasedTableOptions& table_opt) {
+  if (!table_opt.create_secondary_index || !table_opt.sec_attribute_column) {
+    return SecAttributeColumnType::kNone;
+  } else if (table_opt.sec_index_type ==
+             BlockBasedTableOptions::kOneDRtreeSec) {
+    return SecAttributeColumnType::kValue;
+  } else if (table_opt.quantize_sec_attribute_column) {
+    return SecAttributeColumnType::kQuantizedMbr;
+  } else {
+    return SecAttributeColumnType::kMbr;
+  }
+}
+
 }  // namespace
 
 // format_version is the block format as defined in include/rocksdb/table.h
@@ -422,7 +436,8 @@ struct BlockBasedTableBuilder::Rep {
                            ->CanKeysWithDifferentByteContentsBeEqual()
                        ? BlockBasedTableOptions::kDataBlockBinarySearch
                        : table_options.data_block_index_type,
-                   table_options.data_block_hash_table_util_ratio),
+                   table_options.data_block_hash_table_util_ratio,
+                   GetSecAttributeColumnType(table_options)),
         range_del_block(1 /* block_restart_interval */),
         internal_prefix_transform(tbo.moptions.prefix_extractor.get()),
         compression_type(tbo.compression_type),
@@ -1810,6 +1825,12 @@ void BlockBasedTableBuilder::WritePropertiesBlock(
         !rep_->index_builder->seperator_is_key_plus_seq();
     rep_->props.index_value_is_delta_encoded =
         rep_->use_delta_encoding_for_index_values;
+    if (rep_->table_options.create_secondary_index) {
+      const SpatialDomain domain = rep_->sec_index_builder->spatial_domain();
+      if (!domain.empty()) {
+        domain.EncodeTo(&rep_->props.spatial_domain);
+      }
+    }
     if (rep_->sampled_input_data_bytes > 0) {
       rep_->props.slow_compression_estimated_data_size = static_cast<uint64_t>(
           static_cast<double>(rep_->sampled_output_slow_data_bytes) /
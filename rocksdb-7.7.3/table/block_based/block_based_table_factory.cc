@@ -702,7 +702,7 @@ Status BlockBasedTableFactory::ValidateOptions(
         CacheEntryRole::kCompressionDictionaryBuildingBuffer,
         CacheEntryRole::kFilterConstruction,
         CacheEntryRole::kBlockBasedTableReader, CacheEntryRole::kFileMetadata,
-        CacheEntryRole::kBlobCache};
+        CacheEntryRole::kBlobCache, CacheEntryRole::kGlobalSecIndex};
     if (options.charged != CacheEntryRoleOptions::Decision::kFallback &&
         kMemoryChargingSupported.count(role) == 0) {
       return Status::NotSupported(
@@ -118,7 +118,9 @@ void BlockBasedTableIterator::SeekImpl(const Slice* target,
     } else {
       block_iter_.SeekToFirst();
     }
+    fprintf(stderr, "DBG data valid %d %s handle %d\n", (int)block_iter_.Valid(), block_iter_.status().ToString().c_str(), (int)v.handle.offset());
     FindKeyForward();
+    fprintf(stderr, "DBG after fwd valid %d oob %d\n", (int)Valid(), (int)is_out_of_bound_);
   }
 
   CheckOutOfBound();
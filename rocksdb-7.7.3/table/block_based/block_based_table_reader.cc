@@ -1265,6 +1265,16 @@ size_t BlockBasedTable::ApproximateMemoryUsage() const {
   return usage;
 }
 
+Status BlockBasedTable::GetSecondaryEntries(
+    const ReadOptions& read_options,
+    std::vector<std::pair<std::string, BlockHandle>>* sec_entries) {
+  if (rep_->sec_index_reader == nullptr) {
+    return Status::NotSupported("Table has no secondary index reader");
+  }
+  return rep_->sec_index_reader->GetSecondaryEntries(read_options,
+                                                     sec_entries);
+}
+
 // Load the meta-index-block from the file. On success, return the loaded
 // metaindex
 // block and its iterator.
@@ -2015,6 +2025,151 @@ template Status BlockBasedTable::RetrieveBlock<UncompressionDict>(
     bool for_compaction, bool use_cache, bool wait_for_cache,
     bool async_read) const;
 
+bool BlockBasedTable::MultiReadBlocksIntoCache(
+    const ReadOptions& ro, const BlockHandle* handles, size_t num_handles,
+    BlockType block_type, size_t max_queue_depth,
+    BlockCacheLookupContext* lookup_context) const {
+  Cache* const block_cache = rep_->table_options.block_cache.get();
+  if (block_cache == nullptr || !ro.fill_cache ||
+      ro.read_tier == kBlockCacheTier || rep_->ioptions.allow_mmap_reads ||
+      max_queue_depth == 0) {
+    return false;
+  }
+
+  CachableEntry<UncompressionDict> uncompression_dict;
+  if (rep_->uncompression_dict_reader && block_type == BlockType::kData) {
+    Status s =
+        rep_->uncompression_dict_reader->GetOrReadUncompressionDictionary(
+            /*prefetch_buffer=*/nullptr, /*no_io=*/false, ro.verify_checksums,
+            /*get_context=*/nullptr, lookup_context, &uncompression_dict);
+    if (!s.ok()) {
+      return false;
+    }
+  }
+  const UncompressionDict& dict = uncompression_dict.GetValue()
+                                      ? *uncompression_dict.GetValue()
+                                      : UncompressionDict::GetEmptyDict();
+
+  std::vector<BlockHandle> missing;
+  missing.reserve(num_handles);
+  for (size_t i = 0; i < num_handles; i++) {
+    assert(i == 0 || handles[i - 1].offset() <= handles[i].offset());
+    if (i > 0 && handles[i - 1].offset() == handles[i].offset()) {
+      continue;
+    }
+    CacheKey key = GetCacheKey(rep_->base_cache_key, handles[i]);
+    Cache::Handle* const cache_handle = block_cache->Lookup(key.AsSlice());
+    if (cache_handle != nullptr) {
+      block_cache->Release(cache_handle);
+      continue;
+    }
+    missing.push_back(handles[i]);
+  }
+
+  RandomAccessFileReader* file = rep_->file.get();
+  MemoryAllocator* memory_allocator = GetMemoryAllocator(rep_->table_options);
+  std::vector<FSReadRequest> read_reqs;
+  // Index of the first block of each request in `missing`
+  std::vector<size_t> req_first_block;
+  size_t next = 0;
+  while (next < missing.size()) {
+    read_reqs.clear();
+    req_first_block.clear();
+    size_t end = next;
+    for (; end < missing.size(); end++) {
+      const BlockHandle& handle = missing[end];
+      // In direct IO mode the requests are realigned and merged by the reader
+      if (!read_reqs.empty() && !file->use_direct_io() &&
+          read_reqs.back().offset + read_reqs.back().len == handle.offset()) {
+        read_reqs.back().len += BlockSizeWithTrailer(handle);
+        continue;
+      }
+      if (read_reqs.size() == max_queue_depth) {
+        break;
+      }
+      FSReadRequest req;
+      req.offset = handle.offset();
+      req.len = BlockSizeWithTrailer(handle);
+      req.scratch = nullptr;
+      read_reqs.emplace_back(std::move(req));
+      req_first_block.push_back(end);
+    }
+    req_first_block.push_back(end);
+
+    std::unique_ptr<char[]> scratch;
+    if (!file->use_direct_io()) {
+      size_t total_len = 0;
+      for (const FSReadRequest& req : read_reqs) {
+        total_len += req.len;
+      }
+      scratch.reset(new char[total_len]);
+      char* buf = scratch.get();
+      for (FSReadRequest& req : read_reqs) {
+        req.scratch = buf;
+        buf += req.len;
+      }
+    }
+
+    AlignedBuf direct_io_buf;
+    IOOptions opts;
+    IOStatus io_s = file->PrepareIOOptions(ro, opts);
+    if (io_s.ok()) {
+      io_s = file->MultiRead(opts, read_reqs.data(), read_reqs.size(),
+                             &direct_io_buf, ro.rate_limiter_priority);
+    }
+    if (!io_s.ok()) {
+      io_s.PermitUncheckedError();
+      return true;
+    }
+
+    for (size_t r = 0; r < read_reqs.size(); r++) {
+      const FSReadRequest& req = read_reqs[r];
+      if (!req.status.ok() || req.result.size() != req.len) {
+        continue;
+      }
+      for (size_t b = req_first_block[r]; b < req_first_block[r + 1]; b++) {
+        const BlockHandle& handle = missing[b];
+        const char* data = req.result.data() + (handle.offset() - req.offset);
+        PERF_COUNTER_ADD(block_read_count, 1);
+        PERF_COUNTER_ADD(block_read_byte, BlockSizeWithTrailer(handle));
+        if (ro.verify_checksums) {
+          PERF_TIMER_GUARD(block_checksum_time);
+          Status s = VerifyBlockChecksum(rep_->footer.checksum_type(), data,
+                                         handle.size(), file->file_name(),
+                                         handle.offset());
+          if (!s.ok()) {
+            continue;
+          }
+        }
+        // The request buffers are reused by the next batch, so the cache
+        // must own what it keeps. A compressed block is only kept after being
+        // uncompressed, unless there is a compressed block cache.
+        BlockContents raw_block_contents(Slice(data, handle.size()));
+        const bool keep_raw =
+            GetBlockCompressionType(data, handle.size()) == kNoCompression ||
+            rep_->table_options.block_cache_compressed;
+        if (keep_raw) {
+          Slice raw(data, BlockSizeWithTrailer(handle));
+          raw_block_contents = BlockContents(
+              CopyBufferToHeap(memory_allocator, raw), handle.size());
+        }
+#ifndef NDEBUG
+        raw_block_contents.is_raw_block = true;
+#endif
+        CachableEntry<Block> block_entry;
+        MaybeReadBlockAndLoadToCache(
+            /*prefetch_buffer=*/nullptr, ro, handle, dict, /*wait=*/true,
+            /*for_compaction=*/false, &block_entry, block_type,
+            /*get_context=*/nullptr, lookup_context, &raw_block_contents,
+            /*async_read=*/false)
+            .PermitUncheckedError();
+      }
+    }
+    next = end;
+  }
+  return true;
+}
+
 BlockBasedTable::PartitionedIndexIteratorState::PartitionedIndexIteratorState(
     const BlockBasedTable* table,
     UnorderedMap<uint64_t, CachableEntry<Block>>* block_map)
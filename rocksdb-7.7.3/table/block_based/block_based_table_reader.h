@@ -187,6 +187,10 @@ class BlockBasedTable : public TableReader {
 
   size_t ApproximateMemoryUsage() const override;
 
+  Status GetSecondaryEntries(
+      const ReadOptions& read_options,
+      std::vector<std::pair<std::string, BlockHandle>>* sec_entries) override;
+
   // convert SST file to a human readable form
   Status DumpTable(WritableFile* out_file) override;
 
@@ -225,6 +229,14 @@ class BlockBasedTable : public TableReader {
                                      bool /* pin */) {
       return Status::OK();
     }
+
+    // Recompute the global secondary index entries of the table from the
+    // secondary index blocks. Only supported by secondary index readers.
+    virtual Status GetSecondaryEntries(
+        const ReadOptions& /*ro*/,
+        std::vector<std::pair<std::string, BlockHandle>>* /*sec_entries*/) {
+      return Status::NotSupported("Not a secondary index reader");
+    }
   };
 
   class IndexReaderCommon;
@@ -288,6 +300,19 @@ class BlockBasedTable : public TableReader {
                                    CachableEntry<Block>& block,
                                    TBlockIter* input_iter, Status s) const;
 
+  // Reads the blocks that are not in the block cache yet with batched
+  // MultiRead calls and inserts them into the block cache, so that the
+  // following NewDataBlockIterator() calls on them hit the cache. `handles`
+  // must be sorted by offset. Adjacent blocks are coalesced into one request
+  // and each MultiRead carries at most `max_queue_depth` requests. Returns
+  // false without reading anything if the blocks cannot be cached (no block
+  // cache, mmap reads, or ReadOptions not filling the cache). Read errors are
+  // ignored: the affected blocks are read again one by one when used.
+  bool MultiReadBlocksIntoCache(const ReadOptions& ro,
+                                const BlockHandle* handles, size_t num_handles,
+                                BlockType block_type, size_t max_queue_depth,
+                                BlockCacheLookupContext* lookup_context) const;
+
   class PartitionedIndexIteratorState;
 
   template <typename TBlocklike>
@@ -30,6 +30,9 @@
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+// Data blocks may put a hash index and a secondary attribute column (see
+// sec_attribute_column.h) between the restarts and the footer that packs
+// num_restarts.
 
 #include "table/block_based/block_builder.h"
 
@@ -46,13 +49,15 @@ BlockBuilder::BlockBuilder(
     int block_restart_interval, bool use_delta_encoding,
     bool use_value_delta_encoding,
     BlockBasedTableOptions::DataBlockIndexType index_type,
-    double data_block_hash_table_util_ratio)
+    double data_block_hash_table_util_ratio,
+    SecAttributeColumnType sec_column_type)
     : block_restart_interval_(block_restart_interval),
       use_delta_encoding_(use_delta_encoding),
       use_value_delta_encoding_(use_value_delta_encoding),
       restarts_(1, 0),  // First restart point is at offset 0
       counter_(0),
-      finished_(false) {
+      finished_(false),
+      sec_column_builder_(sec_column_type) {
   switch (index_type) {
     case BlockBasedTableOptions::kDataBlockBinarySearch:
       break;
@@ -78,6 +83,7 @@ void BlockBuilder::Reset() {
   if (data_block_hash_index_builder_.Valid()) {
     data_block_hash_index_builder_.Reset();
   }
+  sec_column_builder_.Reset();
 #ifndef NDEBUG
   add_with_last_key_called_ = false;
 #endif
@@ -134,6 +140,11 @@ Slice BlockBuilder::Finish() {
   // footer is a packed format of data_block_index_type and num_restarts
   uint32_t block_footer = PackIndexTypeAndNumRestarts(index_type, num_restarts);
 
+  if (sec_column_builder_.enabled()) {
+    sec_column_builder_.Finish(&buffer_);
+    block_footer = SetSecAttributeColumnFlag(block_footer);
+  }
+
   PutFixed32(&buffer_, block_footer);
   finished_ = true;
   return Slice(buffer_);
@@ -225,6 +236,10 @@ inline void BlockBuilder::AddWithLastKeyImpl(const Slice& key,
                                        restarts_.size() - 1);
   }
 
+  if (sec_column_builder_.enabled()) {
+    sec_column_builder_.Add(static_cast<uint32_t>(buffer_size), value);
+  }
+
   counter_++;
   estimate_ += buffer_.size() - buffer_size;
 }
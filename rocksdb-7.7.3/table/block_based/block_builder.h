@@ -14,6 +14,7 @@
 #include "rocksdb/slice.h"
 #include "rocksdb/table.h"
 #include "table/block_based/data_block_hash_index.h"
+#include "table/block_based/sec_attribute_column.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -27,7 +28,9 @@ class BlockBuilder {
                         bool use_value_delta_encoding = false,
                         BlockBasedTableOptions::DataBlockIndexType index_type =
                             BlockBasedTableOptions::kDataBlockBinarySearch,
-                        double data_block_hash_table_util_ratio = 0.75);
+                        double data_block_hash_table_util_ratio = 0.75,
+                        SecAttributeColumnType sec_column_type =
+                            SecAttributeColumnType::kNone);
 
   // Reset the contents as if the BlockBuilder was just constructed.
   void Reset();
@@ -63,9 +66,11 @@ class BlockBuilder {
   // Returns an estimate of the current (uncompressed) size of the block
   // we are building.
   inline size_t CurrentSizeEstimate() const {
-    return estimate_ + (data_block_hash_index_builder_.Valid()
-                            ? data_block_hash_index_builder_.EstimateSize()
-                            : 0);
+    return estimate_ +
+           (data_block_hash_index_builder_.Valid()
+                ? data_block_hash_index_builder_.EstimateSize()
+                : 0) +
+           sec_column_builder_.CurrentSizeEstimate();
   }
 
   // Returns an estimated block size after appending key and value.
@@ -93,6 +98,7 @@ class BlockBuilder {
   bool finished_;  // Has Finish() been called?
   std::string last_key_;
   DataBlockHashIndexBuilder data_block_hash_index_builder_;
+  SecAttributeColumnBuilder sec_column_builder_;
 #ifndef NDEBUG
   bool add_with_last_key_called_ = false;
 #endif
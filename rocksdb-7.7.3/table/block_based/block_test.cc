@@ -25,6 +25,7 @@
 #include "rocksdb/table.h"
 #include "table/block_based/block_based_table_reader.h"
 #include "table/block_based/block_builder.h"
+#include "table/block_based/data_block_footer.h"
 #include "table/format.h"
 #include "test_util/testharness.h"
 #include "test_util/testutil.h"
@@ -618,6 +619,183 @@ INSTANTIATE_TEST_CASE_P(P, IndexBlockTest,
                                           std::make_tuple(true, false),
                                           std::make_tuple(true, true)));
 
+// Values that start with an MBR (min_x, max_x, min_y, max_y) followed by a
+// payload, except for every 13th which is too short to carry one. With
+// `value_only`, the values start with a single double instead.
+void GenerateSecAttributeKVs(std::vector<std::string> *keys,
+                             std::vector<std::string> *values, int len,
+                             bool value_only) {
+  Random rnd(303);
+  for (int i = 0; i < len; i++) {
+    keys->emplace_back(GenerateInternalKey(i, 0, 0, &rnd));
+    std::string value;
+    if (i % 13 != 12) {
+      // Not representable as floats, so that quantizing them matters
+      const double x = rnd.Uniform(1000) / 10.0 + 0.01;
+      const double y = rnd.Uniform(1000) / 10.0 + 0.01;
+      const double coordinates[4] = {x, x + rnd.Uniform(50) / 10.0, y,
+                                     y + rnd.Uniform(50) / 10.0};
+      value.append(reinterpret_cast<const char *>(coordinates),
+                   (value_only ? 1 : 4) * sizeof(double));
+    }
+    value.append(rnd.RandomString(10));
+    values->emplace_back(value);
+  }
+}
+
+double GetCoordinate(const std::string &value, int i) {
+  double coordinate;
+  memcpy(&coordinate, value.data() + i * sizeof(double), sizeof(double));
+  return coordinate;
+}
+
+class SecAttributeColumnBlockTest
+    : public testing::Test,
+      public testing::WithParamInterface<
+          std::tuple<SecAttributeColumnType,
+                     BlockBasedTableOptions::DataBlockIndexType>> {
+ public:
+  SecAttributeColumnType column_type() const { return std::get<0>(GetParam()); }
+  BlockBasedTableOptions::DataBlockIndexType index_type() const {
+    return std::get<1>(GetParam());
+  }
+};
+
+// Builds the same entries with the column of the parameter, reads them back
+// and runs secondary scans against it: blocks without a column have to read
+// as they always did, and the scans, whether they use the column or not,
+// have to find exactly the entries matching the query.
+TEST_P(SecAttributeColumnBlockTest, ReadBack) {
+  const bool value_only = column_type() == SecAttributeColumnType::kValue;
+  const int num_records = 500;
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  GenerateSecAttributeKVs(&keys, &values, num_records, value_only);
+
+  BlockBuilder builder(16, true /* use_delta_encoding */,
+                       false /* use_value_delta_encoding */, index_type(),
+                       0.75, column_type());
+  BlockBuilder plain_builder(16, true /* use_delta_encoding */,
+                             false /* use_value_delta_encoding */,
+                             index_type(), 0.75);
+  for (int i = 0; i < num_records; i++) {
+    builder.Add(keys[i], values[i]);
+    plain_builder.Add(keys[i], values[i]);
+  }
+  const std::string plain_block = plain_builder.Finish().ToString();
+  Slice rawblock = builder.Finish();
+
+  // The column only appends to the block and sets bit 30 of the footer
+  const uint32_t footer =
+      DecodeFixed32(rawblock.data() + rawblock.size() - sizeof(uint32_t));
+  const uint32_t plain_footer = DecodeFixed32(
+      plain_block.data() + plain_block.size() - sizeof(uint32_t));
+  ASSERT_FALSE(HasSecAttributeColumn(plain_footer));
+  if (column_type() == SecAttributeColumnType::kNone) {
+    ASSERT_EQ(plain_block, rawblock.ToString());
+  } else {
+    ASSERT_TRUE(HasSecAttributeColumn(footer));
+    ASSERT_EQ(plain_footer, ClearSecAttributeColumnFlag(footer));
+    ASSERT_GT(rawblock.size(), plain_block.size());
+    ASSERT_EQ(Slice(plain_block.data(), plain_block.size() - sizeof(uint32_t)),
+              Slice(rawblock.data(), plain_block.size() - sizeof(uint32_t)));
+  }
+
+  BlockContents contents;
+  contents.data = rawblock;
+  Block reader(std::move(contents));
+  ASSERT_EQ(index_type(), reader.IndexType());
+  Options options;
+
+  // Plain reads ignore the column
+  DataBlockIter *iter =
+      reader.NewDataIterator(options.comparator, kDisableGlobalSequenceNumber);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); count++, iter->Next()) {
+    ASSERT_EQ(keys[count], iter->key().ToString());
+    ASSERT_EQ(values[count], iter->value().ToString());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(num_records, count);
+  for (int i = 0; i < num_records; i += 7) {
+    ASSERT_TRUE(iter->SeekForGet(keys[i]));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(values[i], iter->value().ToString());
+  }
+  delete iter;
+
+  // Queries matching nothing, a few entries, and more than a column word
+  // of entries. The bounds fall on coordinates of entries, so that the
+  // rounding of the quantized column is exercised at the edges.
+  const double min_x = GetCoordinate(values[3], 0);
+  const double min_y = value_only ? 0 : GetCoordinate(values[3], 2);
+  const double queries[][4] = {{-10, -5, -10, -5},
+                               {min_x, min_x + 10, min_y, min_y + 10},
+                               {min_x, min_x, min_y, min_y},
+                               {10, 80, 10, 80}};
+  for (const auto &q : queries) {
+    std::vector<int> expected;
+    for (int i = 0; i < num_records; i++) {
+      if (i % 13 == 12) {
+        continue;
+      }
+      bool match;
+      if (value_only) {
+        const double v = GetCoordinate(values[i], 0);
+        match = !(v > q[1] || q[0] > v);
+      } else {
+        match = !(GetCoordinate(values[i], 0) > q[1] ||
+                  q[0] > GetCoordinate(values[i], 1) ||
+                  GetCoordinate(values[i], 2) > q[3] ||
+                  q[2] > GetCoordinate(values[i], 3));
+      }
+      if (match) {
+        expected.push_back(i);
+      }
+    }
+
+    RtreeIteratorContext context;
+    if (value_only) {
+      ValueRange range;
+      range.set_range(q[0], q[1]);
+      context.query_mbr = serializeValueRange(range);
+      iter = reader.NewSecondaryIndexDataIterator1D(
+          options.comparator, kDisableGlobalSequenceNumber, nullptr, nullptr,
+          false, &context, true /* is_secondary_index_scan */,
+          false /* is_secondary_index_spatial */);
+    } else {
+      Mbr mbr;
+      mbr.set_first(q[0], q[1]);
+      mbr.set_second(q[2], q[3]);
+      context.query_mbr = serializeMbrExcludeIID(mbr);
+      iter = reader.NewSecondaryIndexDataIterator(
+          options.comparator, kDisableGlobalSequenceNumber, nullptr, nullptr,
+          false, &context, true /* is_secondary_index_scan */);
+    }
+
+    std::vector<int> found;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      found.push_back(static_cast<int>(
+          std::find(keys.begin(), keys.end(), iter->key().ToString()) -
+          keys.begin()));
+      ASSERT_EQ(values[found.back()], iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(expected, found);
+    delete iter;
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    P, SecAttributeColumnBlockTest,
+    ::testing::Combine(
+        ::testing::Values(SecAttributeColumnType::kNone,
+                          SecAttributeColumnType::kMbr,
+                          SecAttributeColumnType::kQuantizedMbr,
+                          SecAttributeColumnType::kValue),
+        ::testing::Values(BlockBasedTableOptions::kDataBlockBinarySearch,
+                          BlockBasedTableOptions::kDataBlockBinaryAndHash)));
+
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char **argv) {
@@ -15,11 +15,13 @@ namespace ROCKSDB_NAMESPACE {
 
 const int kDataBlockIndexTypeBitShift = 31;
 
-// 0x7FFFFFFF
-const uint32_t kMaxNumRestarts = (1u << kDataBlockIndexTypeBitShift) - 1u;
+const int kSecAttributeColumnBitShift = 30;
 
-// 0x7FFFFFFF
-const uint32_t kNumRestartsMask = (1u << kDataBlockIndexTypeBitShift) - 1u;
+// 0x3FFFFFFF
+const uint32_t kMaxNumRestarts = (1u << kSecAttributeColumnBitShift) - 1u;
+
+// 0x3FFFFFFF
+const uint32_t kNumRestartsMask = (1u << kSecAttributeColumnBitShift) - 1u;
 
 uint32_t PackIndexTypeAndNumRestarts(
     BlockBasedTableOptions::DataBlockIndexType index_type,
@@ -56,4 +58,16 @@ void UnPackIndexTypeAndNumRestarts(
   }
 }
 
+uint32_t SetSecAttributeColumnFlag(uint32_t block_footer) {
+  return block_footer | 1u << kSecAttributeColumnBitShift;
+}
+
+bool HasSecAttributeColumn(uint32_t block_footer) {
+  return (block_footer & 1u << kSecAttributeColumnBitShift) != 0;
+}
+
+uint32_t ClearSecAttributeColumnFlag(uint32_t block_footer) {
+  return block_footer & ~(1u << kSecAttributeColumnBitShift);
+}
+
 }  // namespace ROCKSDB_NAMESPACE
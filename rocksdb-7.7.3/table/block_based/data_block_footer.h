@@ -22,4 +22,14 @@ void UnPackIndexTypeAndNumRestarts(
     BlockBasedTableOptions::DataBlockIndexType* index_type,
     uint32_t* num_restarts);
 
+// Bit 30 of the footer is set if the block carries a secondary attribute
+// column, see sec_attribute_column.h. It is independent of the index type
+// and of the block size.
+uint32_t SetSecAttributeColumnFlag(uint32_t block_footer);
+
+bool HasSecAttributeColumn(uint32_t block_footer);
+
+// Clears the flag from a footer
+uint32_t ClearSecAttributeColumnFlag(uint32_t block_footer);
+
 }  // namespace ROCKSDB_NAMESPACE
@@ -726,42 +726,33 @@ Status RtreeSecondaryIndexBuilder::Finish(
 
   if (finishing_indexes == false) {
     
-    data_block_entries_.sort([](const DataBlockEntry& a, const DataBlockEntry& b){
+    domain_ = table_opt_.sec_index_domain;
+    if (domain_.empty()) {
+      // Fit the curve to the data blocks of this table
+      for (const DataBlockEntry& entry : data_block_entries_) {
+        Mbr mbr = ReadSecQueryMbr(entry.subindexenclosingmbr);
+        domain_.Extend((mbr.first.min + mbr.first.max) / 2,
+                       (mbr.second.min + mbr.second.max) / 2);
+      }
+    }
+
+    // Sort the data blocks by the z-value of the centre point of their MBR
+    // on a grid over the domain
+    data_block_entries_.sort([this](const DataBlockEntry& a,
+                                    const DataBlockEntry& b) {
       Mbr a_mbr = ReadSecQueryMbr(a.subindexenclosingmbr);
       Mbr b_mbr = ReadSecQueryMbr(b.subindexenclosingmbr);
 
-      // defining z-curve based on grid cells on data space
-      // for dataset Tweet
-      // double x_min = -179.9942;
-      // double x_max = 179.9868;
-      // double y_min = -90;
-      // double y_max = 90;
-      // for dataset buildings
-      double x_min = -179.7582827;
-      double x_max = 179.8440789;
-      double y_min = -89.9678358;
-      double y_max = 82.5114551;
-      int n = 262144;
-
-      // using the centre point of each mbr for z-value computation
+      const uint32_t n = 262144;
       double x_a = (a_mbr.first.min + a_mbr.first.max) / 2;
       double y_a = (a_mbr.second.min + a_mbr.second.max) / 2;
       double x_b = (b_mbr.first.min + b_mbr.first.max) / 2;
       double y_b = (b_mbr.second.min + b_mbr.second.max) / 2;
-      // double x_a = a_mbr.first.min;
-      // double y_a = a_mbr.second.min;
-      // double x_b = b_mbr.first.min;
-      // double y_b = b_mbr.second.min;
-
-      // compute the z-values
-      uint32_t x_a_int = std::min(int(floor((x_a - x_min)  / ((x_max - x_min) / n))), n-1);
-      uint32_t y_a_int = std::min(int(floor((y_a - y_min)  / ((y_max - y_min) / n))), n-1);
-      uint32_t x_b_int = std::min(int(floor((x_b - x_min)  / ((x_max - x_min) / n))), n-1);
-      uint32_t y_b_int = std::min(int(floor((y_b - y_min)  / ((y_max - y_min) / n))), n-1);
 
       // compare the z-values
-      int comp = comp_z_order(x_a_int, y_a_int, x_b_int, y_b_int);
-      return comp <= 0;     
+      int comp = comp_z_order(domain_.CellX(x_a, n), domain_.CellY(y_a, n),
+                              domain_.CellX(x_b, n), domain_.CellY(y_b, n));
+      return comp < 0;
     });
     
     std::list<DataBlockEntry>::iterator it;
@@ -188,6 +188,11 @@ class SecondaryIndexBuilder {
     (void) sec_entries;
   }
 
+  // The domain the index laid its space-filling curve over, recorded in the
+  // table properties. Empty if the index does not use one. Valid after the
+  // first call to ::Finish.
+  virtual SpatialDomain spatial_domain() const { return SpatialDomain(); }
+
  protected:
   const InternalKeyComparator* comparator_;
   // const Comparator* comparator_;
@@ -941,6 +946,8 @@ class RtreeSecondaryIndexBuilder : public SecondaryIndexBuilder {
 
   void get_Secondary_Entries(std::vector<std::pair<std::string, BlockHandle>>* sec_entries) override;
 
+  SpatialDomain spatial_domain() const override { return domain_; }
+
   size_t TopLevelIndexSize(uint64_t) const { return top_level_index_size_; }
   size_t NumPartitions() const;
 
@@ -1020,6 +1027,9 @@ class RtreeSecondaryIndexBuilder : public SecondaryIndexBuilder {
   Mbr temp_sec_mbr_;
   uint32_t rtree_level_;
   std::string rtree_height_str_;
+  // The domain of the z-order curve the data blocks are sorted by, either
+  // table_opt_.sec_index_domain or learned from the data blocks
+  SpatialDomain domain_;
   void expandMbrExcludeIID(Mbr& to_expand, Mbr expander) {
     if (to_expand.empty()) {
       to_expand = expander;
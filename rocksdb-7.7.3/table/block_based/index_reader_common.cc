@@ -7,6 +7,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 #include "table/block_based/index_reader_common.h"
+
+#include "table/block_based/block_based_table_reader_impl.h"
 #include "table/meta_blocks.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -106,4 +108,66 @@ Status BlockBasedTable::IndexReaderCommon::GetOrReadSecIndexBlock(
                         index_block, meta_index_iter);
 }
 
+Status BlockBasedTable::IndexReaderCommon::GetSecIndexLeafHandles(
+    const ReadOptions& ro, uint32_t rtree_height,
+    InternalIterator* meta_index_iter,
+    std::vector<BlockHandle>* leaf_handles) const {
+  assert(leaf_handles != nullptr);
+
+  // The top-level block directly points at the leaf partitions when the
+  // R-tree has two levels.
+  if (rtree_height < 2) {
+    return Status::NotSupported("Secondary index is not partitioned");
+  }
+
+  CachableEntry<Block> index_block;
+  Status s = GetOrReadSecIndexBlock(/*no_io=*/false, ro.rate_limiter_priority,
+                                    /*get_context=*/nullptr,
+                                    /*lookup_context=*/nullptr, &index_block,
+                                    meta_index_iter);
+  if (!s.ok()) {
+    return s;
+  }
+
+  const BlockBasedTable::Rep* rep = table_->get_rep();
+  std::vector<BlockHandle> handles;
+  {
+    std::unique_ptr<IndexBlockIter> top_iter(
+        index_block.GetValue()->NewIndexIterator(
+            internal_comparator()->user_comparator(),
+            rep->get_global_seqno(BlockType::kIndex), nullptr,
+            /*stats=*/nullptr, true, index_has_first_key(),
+            index_key_includes_seq(), index_value_is_full()));
+    for (top_iter->SeekToFirst(); top_iter->Valid(); top_iter->Next()) {
+      handles.push_back(top_iter->value().handle);
+    }
+    s = top_iter->status();
+  }
+
+  for (uint32_t level = 2; s.ok() && level < rtree_height; level++) {
+    std::vector<BlockHandle> children;
+    for (const BlockHandle& handle : handles) {
+      IndexBlockIter block_iter;
+      table_->NewDataBlockIterator<IndexBlockIter>(
+          ro, handle, &block_iter, BlockType::kIndex,
+          /*get_context=*/nullptr, /*lookup_context=*/nullptr,
+          /*prefetch_buffer=*/nullptr, /*for_compaction=*/false,
+          /*async_read=*/false, s);
+      for (block_iter.SeekToFirst(); block_iter.Valid(); block_iter.Next()) {
+        children.push_back(block_iter.value().handle);
+      }
+      s = block_iter.status();
+      if (!s.ok()) {
+        break;
+      }
+    }
+    handles.swap(children);
+  }
+
+  if (s.ok()) {
+    leaf_handles->swap(handles);
+  }
+  return s;
+}
+
 }  // namespace ROCKSDB_NAMESPACE
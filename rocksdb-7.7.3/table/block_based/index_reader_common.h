@@ -85,6 +85,12 @@ class BlockBasedTable::IndexReaderCommon : public BlockBasedTable::IndexReader {
                              CachableEntry<Block>* index_block,
                              InternalIterator* meta_index_iter) const;
 
+  // Collect the handles of the leaf partitions of an R-tree secondary index,
+  // i.e. of the index blocks whose entries point at data blocks.
+  Status GetSecIndexLeafHandles(const ReadOptions& ro, uint32_t rtree_height,
+                                InternalIterator* meta_index_iter,
+                                std::vector<BlockHandle>* leaf_handles) const;
+
   size_t ApproximateIndexBlockMemoryUsage() const {
     assert(!index_block_.GetOwnValue() || index_block_.GetValue() != nullptr);
     return index_block_.GetOwnValue()
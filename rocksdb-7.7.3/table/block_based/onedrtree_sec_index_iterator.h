@@ -12,10 +12,13 @@
 #include "table/block_based/block_based_table_reader_impl.h"
 #include "table/block_based/block_prefetcher.h"
 #include "table/block_based/reader_common.h"
+#include "table/block_based/sec_index_query_plan.h"
 #include "util/rtree.h"
 
 #include <iostream>
+#include <memory>
 #include <stack>
+#include <vector>
 
 namespace ROCKSDB_NAMESPACE {
 // Iterator that iterates over partitioned index.
@@ -50,10 +53,9 @@ class OneDRtreeSecIndexIterator : public InternalIteratorBase<IndexValue> {
       Slice query_slice(context->query_mbr);
       query_valrange_ = ReadValueRange(query_slice);
 
-      for (const std::pair<uint64_t, u_int64_t>& fsbh: *read_options.found_sec_blkhandle) {
-        found_sec_handles_->emplace_back(fsbh);
+      if (read_options.sec_index_plan != nullptr) {
+        sec_plan_ = *read_options.sec_index_plan;
       }
-      sec_blk_iter_ = found_sec_handles_->begin();
       // std::cout << "query_mbr_: " << query_mbr_ << std::endl;
       // std::cout << "rtree_index_iterator rtree_height_: " << rtree_height_ << std::endl;
     }
@@ -174,15 +176,26 @@ class OneDRtreeSecIndexIterator : public InternalIteratorBase<IndexValue> {
   BlockPrefetcher block_prefetcher_;
   ValueRange query_valrange_;
   uint32_t rtree_height_;
-  std::vector<std::pair<uint64_t, uint64_t>>* found_sec_handles_ = new std::vector<std::pair<uint64_t, uint64_t>>();
-  std::vector<std::pair<uint64_t, uint64_t>>::iterator sec_blk_iter_;
-  std::stack<StackElement*> iterator_stack_;
+  // The partitions picked by the global secondary index, read in order
+  SecIndexFilePlanRef sec_plan_;
+  size_t sec_block_idx_ = 0;
+  // Extent holding the current partition
+  size_t sec_extent_idx_ = 0;
+  // True if the partitions were read into the block cache by SeekImpl(), in
+  // which case the data blocks are batched the same way
+  bool sec_blocks_cached_ = false;
+  std::vector<BlockHandle> sec_data_handles_;
+  // The R-tree path from the root, down to the node above the current
+  // partition
+  std::stack<std::unique_ptr<StackElement>> iterator_stack_;
 
   // If `target` is null, seek to first.
   void SeekImpl(const Slice* target);
 
   void InitPartitionedIndexBlock(IndexBlockIter* block_iter=nullptr);
   void InitPartitionedSecIndexBlock();
+  void PrefetchSecIndexExtent();
+  void MultiReadSecDataBlocks();
   void InitRtreeIntermediateIndexBlock(IndexBlockIter* block_iter);
   void InitRtreeIntermediateIndexBlock(IndexBlockIter* input_block_iter, IndexBlockIter* block_iter);
   void FindKeyForward();
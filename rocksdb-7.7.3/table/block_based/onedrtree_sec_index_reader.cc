@@ -161,7 +161,7 @@ InternalIteratorBase<IndexValue>* OneDRtreeSecIndexReader::NewIterator(
     ro.iterator_context = read_options.iterator_context;
     ro.is_secondary_index_scan = read_options.is_secondary_index_scan;
     ro.is_secondary_index_spatial = read_options.is_secondary_index_spatial;
-    ro.found_sec_blkhandle = read_options.found_sec_blkhandle;
+    ro.sec_index_plan = read_options.sec_index_plan;
     // std::cout << "rtree_sec_index_reader::" << (ro.iterator_context == nullptr) << std::endl;
     // RtreeIteratorContext* context =
     //     reinterpret_cast<RtreeIteratorContext*>(ro.iterator_context);
@@ -307,4 +307,44 @@ Status OneDRtreeSecIndexReader::CacheDependencies(const ReadOptions& ro,
   return s;
 }
 
+
+// Same grouping as OneDRtreeSecondaryIndexBuilder: consecutive entries of a
+// leaf partition are merged until their value range would be wider than
+// 0.005, and each group becomes one entry pointing at the partition.
+Status OneDRtreeSecIndexReader::GetSecondaryEntries(
+    const ReadOptions& ro,
+    std::vector<std::pair<std::string, BlockHandle>>* sec_entries) {
+  assert(sec_entries != nullptr);
+  std::vector<BlockHandle> leaf_handles;
+  Status s = GetSecIndexLeafHandles(ro, rtree_height_, meta_index_iterator_,
+                                    &leaf_handles);
+  for (const BlockHandle& handle : leaf_handles) {
+    if (!s.ok()) {
+      break;
+    }
+    IndexBlockIter block_iter;
+    table()->NewDataBlockIterator<IndexBlockIter>(
+        ro, handle, &block_iter, BlockType::kIndex, /*get_context=*/nullptr,
+        /*lookup_context=*/nullptr, /*prefetch_buffer=*/nullptr,
+        /*for_compaction=*/false, /*async_read=*/false, s);
+    ValueRange group_range;
+    for (block_iter.SeekToFirst(); block_iter.Valid(); block_iter.Next()) {
+      const ValueRange entry_range = ReadValueRange(block_iter.key());
+      ValueRange expanded = group_range;
+      expandSecValueRange(expanded, entry_range);
+      if (!group_range.empty() &&
+          expanded.range.max - expanded.range.min > 0.005) {
+        sec_entries->emplace_back(serializeValueRange(group_range), handle);
+        group_range.clear();
+      }
+      expandSecValueRange(group_range, entry_range);
+    }
+    s = block_iter.status();
+    if (s.ok() && !group_range.empty()) {
+      sec_entries->emplace_back(serializeValueRange(group_range), handle);
+    }
+  }
+  return s;
+}
+
 }  // namespace ROCKSDB_NAMESPACE
@@ -31,6 +31,10 @@ class OneDRtreeSecIndexReader : public BlockBasedTable::IndexReaderCommon {
       BlockCacheLookupContext* lookup_context) override;
 
   Status CacheDependencies(const ReadOptions& ro, bool pin) override;
+
+  Status GetSecondaryEntries(
+      const ReadOptions& ro,
+      std::vector<std::pair<std::string, BlockHandle>>* sec_entries) override;
   size_t ApproximateMemoryUsage() const override {
     size_t usage = ApproximateIndexBlockMemoryUsage();
 #ifdef ROCKSDB_MALLOC_USABLE_SIZE
@@ -3,6 +3,7 @@
 #include "logging/log_buffer.h"
 #include "logging/logging.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace ROCKSDB_NAMESPACE {
@@ -98,10 +99,15 @@ void RtreeSecIndexIterator::SeekImpl(const Slice* target) {
 
   // ================================================================================================
 
-  if (sec_blk_iter_ == found_sec_handles_->end()) {
+  sec_block_idx_ = 0;
+  sec_extent_idx_ = 0;
+  if (sec_plan_.num_blocks == 0) {
     ResetPartitionedIndexIter();
     return;
   }
+  sec_blocks_cached_ = table_->MultiReadBlocksIntoCache(
+      read_options_, sec_plan_.blocks, sec_plan_.num_blocks,
+      BlockType::kIndex, kSecIndexMaxQueueDepth, &lookup_context_);
 
   
   InitPartitionedSecIndexBlock();
@@ -223,11 +229,39 @@ void RtreeSecIndexIterator::InitPartitionedIndexBlock(IndexBlockIter* block_iter
   }
 }
 
+void RtreeSecIndexIterator::PrefetchSecIndexExtent() {
+  // The partitions are read in offset order: when reaching the first
+  // partition of a run of adjacent ones, read the whole run with one I/O so
+  // that the following partitions come from the OS page cache. Errors are
+  // ignored, the partitions are then read one by one. Not needed when the
+  // partitions were already read into the block cache.
+  if (sec_blocks_cached_) {
+    return;
+  }
+  while (sec_extent_idx_ < sec_plan_.num_extents &&
+         sec_plan_.extents[sec_extent_idx_].first_block +
+                 sec_plan_.extents[sec_extent_idx_].num_blocks <=
+             sec_block_idx_) {
+    sec_extent_idx_++;
+  }
+  if (sec_extent_idx_ == sec_plan_.num_extents) {
+    return;
+  }
+  const SecIndexReadExtent& extent = sec_plan_.extents[sec_extent_idx_];
+  if (extent.first_block == sec_block_idx_ && extent.num_blocks > 1) {
+    table_->get_rep()
+        ->file
+        ->Prefetch(extent.offset, static_cast<size_t>(extent.size),
+                   read_options_.rate_limiter_priority)
+        .PermitUncheckedError();
+  }
+}
+
 void RtreeSecIndexIterator::InitPartitionedSecIndexBlock() {
   // std::cout << "InitPartitionedSecIndexBlock()" << std::endl;
-  uint64_t pi_handle_offset = sec_blk_iter_->first;
-  uint64_t pi_handle_size = sec_blk_iter_->second;
-  BlockHandle partitioned_index_handle(pi_handle_offset, pi_handle_size);
+  const BlockHandle& partitioned_index_handle =
+      sec_plan_.blocks[sec_block_idx_];
+  PrefetchSecIndexExtent();
   
   if (!block_iter_points_to_real_block_ ||
       partitioned_index_handle.offset() != prev_block_offset_ ||
@@ -256,6 +290,9 @@ void RtreeSecIndexIterator::InitPartitionedSecIndexBlock() {
         block_prefetcher_.prefetch_buffer(),
         /*for_compaction=*/is_for_compaction, /*async_read=*/false, s);
     block_iter_points_to_real_block_ = true;
+    if (sec_blocks_cached_ && block_iter_.status().ok()) {
+      MultiReadSecDataBlocks();
+    }
     // We could check upper bound here but it is complicated to reason about
     // upper bound in index iterator. On the other than, in large scans, index
     // iterators are moved much less frequently compared to data blocks. So
@@ -263,6 +300,28 @@ void RtreeSecIndexIterator::InitPartitionedSecIndexBlock() {
   }
 }
 
+void RtreeSecIndexIterator::MultiReadSecDataBlocks() {
+  // Read the data blocks of the partition's entries matching the query in
+  // batches before the table iterator visits them one by one. The callers
+  // reposition block_iter_ afterwards.
+  sec_data_handles_.clear();
+  for (block_iter_.SeekToFirst(); block_iter_.Valid(); block_iter_.Next()) {
+    if (IntersectMbrExcludeIID(ReadValueMbr(block_iter_.key()), query_mbr_)) {
+      sec_data_handles_.push_back(block_iter_.value().handle);
+    }
+  }
+  if (sec_data_handles_.empty()) {
+    return;
+  }
+  std::sort(sec_data_handles_.begin(), sec_data_handles_.end(),
+            [](const BlockHandle& a, const BlockHandle& b) {
+              return a.offset() < b.offset();
+            });
+  table_->MultiReadBlocksIntoCache(
+      read_options_, sec_data_handles_.data(), sec_data_handles_.size(),
+      BlockType::kData, kSecIndexMaxQueueDepth, &lookup_context_);
+}
+
 void RtreeSecIndexIterator::InitRtreeIntermediateIndexBlock(IndexBlockIter* block_iter) {
   block_iter->Invalidate(Status::OK());
   BlockHandle partitioned_index_handle = index_iter_->value().handle;
@@ -304,23 +363,23 @@ void RtreeSecIndexIterator::InitRtreeIntermediateIndexBlock(IndexBlockIter* inpu
 
 void RtreeSecIndexIterator::AddChildToStack() {
   // std::cout << "AddChildToStack" << std::endl;
-  StackElement* new_element = new StackElement;
+  std::unique_ptr<StackElement> new_element(new StackElement);
   InitRtreeIntermediateIndexBlock(&(new_element->block_iter));
   RtreeIndexIterSeekToFirst(&(new_element->block_iter));
   if (new_element->block_iter.Valid()) {
     new_element->level = rtree_height_ - 1;
-    iterator_stack_.push(new_element);
+    iterator_stack_.push(std::move(new_element));
     // std::cout << "added iterator to stack, mbr: " << ReadValueMbr(new_element->block_iter.key()) << " level: " << new_element->level << std::endl;
   }
 }
 
 void RtreeSecIndexIterator::AddChildToStack(StackElement* current_top) {
-  StackElement* new_element = new StackElement;
+  std::unique_ptr<StackElement> new_element(new StackElement);
   InitRtreeIntermediateIndexBlock(&(current_top->block_iter), &(new_element->block_iter));
   RtreeIndexIterSeekToFirst(&(new_element->block_iter));
   if (new_element->block_iter.Valid()) {
     new_element->level = current_top->level - 1;
-    iterator_stack_.push(new_element);
+    iterator_stack_.push(std::move(new_element));
     // std:: cout << "added iterator to stack, mbr: " << ReadValueMbr(new_element->block_iter.key()) << "level: " << new_element->level << std::endl;
   }
 }
@@ -367,11 +426,11 @@ void RtreeSecIndexIterator::FindBlockForwardSec() {
     }
     ResetPartitionedIndexIter();
 
-    if (sec_blk_iter_ == --found_sec_handles_->end()) {
+    if (sec_block_idx_ + 1 >= sec_plan_.num_blocks) {
       return;
     }
 
-    sec_blk_iter_++;
+    sec_block_idx_++;
 
     // std::cout << "Leaf block Mbr: " << block_iter_mbr_ << std::endl;
 
@@ -406,7 +465,7 @@ void RtreeSecIndexIterator::FindBlockForward() {
     }
 
     if (rtree_height_ > 2) {
-      StackElement* current_top = iterator_stack_.top();
+      StackElement* current_top = iterator_stack_.top().get();
       RtreeIndexIterNext(&(current_top->block_iter));
       if (!current_top->block_iter.Valid()) {
         iterator_stack_.pop();
@@ -425,7 +484,7 @@ void RtreeSecIndexIterator::FindBlockForward() {
         }
       }
       while(!iterator_stack_.empty() && iterator_stack_.top()->level > 2){
-        current_top = iterator_stack_.top();
+        current_top = iterator_stack_.top().get();
         if (!current_top->block_iter.Valid()) {
           iterator_stack_.pop();
         }
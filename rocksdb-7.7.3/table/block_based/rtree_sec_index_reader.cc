@@ -160,7 +160,7 @@ InternalIteratorBase<IndexValue>* RtreeSecIndexReader::NewIterator(
     // std::cout << "adding iterator context" << std::endl;
     ro.iterator_context = read_options.iterator_context;
     ro.is_secondary_index_scan = read_options.is_secondary_index_scan;
-    ro.found_sec_blkhandle = read_options.found_sec_blkhandle;
+    ro.sec_index_plan = read_options.sec_index_plan;
     // std::cout << "rtree_sec_index_reader::" << (ro.iterator_context == nullptr) << std::endl;
     // RtreeIteratorContext* context =
     //     reinterpret_cast<RtreeIteratorContext*>(ro.iterator_context);
@@ -306,4 +306,43 @@ Status RtreeSecIndexReader::CacheDependencies(const ReadOptions& ro,
   return s;
 }
 
+
+// Same grouping as RtreeSecondaryIndexBuilder: consecutive entries of a leaf
+// partition are merged until the area of their MBR would exceed 0.005, and
+// each group becomes one entry pointing at the partition.
+Status RtreeSecIndexReader::GetSecondaryEntries(
+    const ReadOptions& ro,
+    std::vector<std::pair<std::string, BlockHandle>>* sec_entries) {
+  assert(sec_entries != nullptr);
+  std::vector<BlockHandle> leaf_handles;
+  Status s = GetSecIndexLeafHandles(ro, rtree_height_, meta_index_iterator_,
+                                    &leaf_handles);
+  for (const BlockHandle& handle : leaf_handles) {
+    if (!s.ok()) {
+      break;
+    }
+    IndexBlockIter block_iter;
+    table()->NewDataBlockIterator<IndexBlockIter>(
+        ro, handle, &block_iter, BlockType::kIndex, /*get_context=*/nullptr,
+        /*lookup_context=*/nullptr, /*prefetch_buffer=*/nullptr,
+        /*for_compaction=*/false, /*async_read=*/false, s);
+    Mbr group_mbr;
+    for (block_iter.SeekToFirst(); block_iter.Valid(); block_iter.Next()) {
+      const Mbr entry_mbr = ReadValueMbr(block_iter.key());
+      Mbr expanded = group_mbr;
+      expandMbrExcludeIID(expanded, entry_mbr);
+      if (!group_mbr.empty() && GetMbrArea(expanded) > 0.005) {
+        sec_entries->emplace_back(serializeMbrExcludeIID(group_mbr), handle);
+        group_mbr.clear();
+      }
+      expandMbrExcludeIID(group_mbr, entry_mbr);
+    }
+    s = block_iter.status();
+    if (s.ok() && !group_mbr.empty()) {
+      sec_entries->emplace_back(serializeMbrExcludeIID(group_mbr), handle);
+    }
+  }
+  return s;
+}
+
 }  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,131 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/block_based/sec_attribute_column.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+// The largest float not above `d`
+float FloorToFloat(double d) {
+  if (d > std::numeric_limits<float>::max()) {
+    return std::numeric_limits<float>::max();
+  } else if (d < std::numeric_limits<float>::lowest()) {
+    return -std::numeric_limits<float>::infinity();
+  }
+  float f = static_cast<float>(d);
+  if (static_cast<double>(f) > d) {
+    f = std::nextafter(f, -std::numeric_limits<float>::infinity());
+  }
+  return f;
+}
+
+// The smallest float not below `d`
+float CeilToFloat(double d) {
+  if (d < std::numeric_limits<float>::lowest()) {
+    return std::numeric_limits<float>::lowest();
+  } else if (d > std::numeric_limits<float>::max()) {
+    return std::numeric_limits<float>::infinity();
+  }
+  float f = static_cast<float>(d);
+  if (static_cast<double>(f) < d) {
+    f = std::nextafter(f, std::numeric_limits<float>::infinity());
+  }
+  return f;
+}
+
+template <typename T>
+void AppendCoordinate(std::string* buffer, T coordinate) {
+  buffer->append(reinterpret_cast<const char*>(&coordinate), sizeof(T));
+}
+}  // namespace
+
+void SecAttributeColumnBuilder::Reset() {
+  offsets_.clear();
+  for (std::string& coordinate : coordinates_) {
+    coordinate.clear();
+  }
+}
+
+void SecAttributeColumnBuilder::Add(uint32_t offset, const Slice& value) {
+  const uint32_t num_coordinates = SecAttributeColumn::NumCoordinates(type_);
+  if (!enabled() || value.size() < num_coordinates * sizeof(double)) {
+    return;
+  }
+  offsets_.push_back(offset);
+  for (uint32_t i = 0; i < num_coordinates; i++) {
+    double coordinate;
+    memcpy(&coordinate, value.data() + i * sizeof(double), sizeof(double));
+    if (type_ != SecAttributeColumnType::kQuantizedMbr) {
+      AppendCoordinate(&coordinates_[i], coordinate);
+    } else if (i % 2 == 0) {
+      // min_x and min_y
+      AppendCoordinate(&coordinates_[i], FloorToFloat(coordinate));
+    } else {
+      AppendCoordinate(&coordinates_[i], CeilToFloat(coordinate));
+    }
+  }
+}
+
+size_t SecAttributeColumnBuilder::CurrentSizeEstimate() const {
+  if (!enabled()) {
+    return 0;
+  }
+  size_t size = offsets_.size() * sizeof(uint32_t) + 2 * sizeof(uint32_t);
+  for (const std::string& coordinate : coordinates_) {
+    size += coordinate.size();
+  }
+  return size;
+}
+
+void SecAttributeColumnBuilder::Finish(std::string* buffer) const {
+  assert(enabled());
+  for (uint32_t offset : offsets_) {
+    PutFixed32(buffer, offset);
+  }
+  for (const std::string& coordinate : coordinates_) {
+    buffer->append(coordinate);
+  }
+  PutFixed32(buffer, static_cast<uint32_t>(offsets_.size()));
+  PutFixed32(buffer, static_cast<uint32_t>(type_));
+}
+
+bool SecAttributeColumn::Parse(const char* data, uint32_t* end) {
+  *this = SecAttributeColumn();
+  if (*end < 2 * sizeof(uint32_t)) {
+    return false;
+  }
+  const uint32_t trailer = *end - 2 * sizeof(uint32_t);
+  const uint32_t num_entries = DecodeFixed32(data + trailer);
+  const uint32_t column_type = DecodeFixed32(data + trailer + sizeof(uint32_t));
+  if (column_type != static_cast<uint32_t>(SecAttributeColumnType::kMbr) &&
+      column_type !=
+          static_cast<uint32_t>(SecAttributeColumnType::kQuantizedMbr) &&
+      column_type != static_cast<uint32_t>(SecAttributeColumnType::kValue)) {
+    return false;
+  }
+  const auto parsed_type = static_cast<SecAttributeColumnType>(column_type);
+  const uint64_t entry_size =
+      sizeof(uint32_t) +
+      NumCoordinates(parsed_type) * CoordinateSize(parsed_type);
+  if (num_entries * entry_size > trailer) {
+    return false;
+  }
+  const uint32_t start =
+      trailer - static_cast<uint32_t>(num_entries * entry_size);
+  type = parsed_type;
+  count = num_entries;
+  offsets = data + start;
+  coordinates = offsets + num_entries * sizeof(uint32_t);
+  *end = start;
+  return true;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,104 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// The secondary attribute column of a data block holds the secondary
+// attribute of the block's entries contiguously, one array per coordinate,
+// so that secondary index scans can test the entries against the query
+// before decoding any of them. A data block carrying a column has bit 30 of
+// its footer set and ends with
+//
+//   [entry offsets: uint32[n]]
+//   [coordinate 0: T[n]] ... [coordinate k-1: T[n]]
+//   [n: uint32]
+//   [column type: uint32]
+//   [block footer: uint32]
+//
+// following the restart array (and the hash index, if any). The MBR columns
+// store min_x, max_x, min_y and max_y, the value column the first 8 bytes
+// of the values as a double. T is double, except for the quantized MBR
+// column which rounds minimums down and maximums up to floats, so that it
+// never rejects a matching entry and the entries that pass have to be
+// checked against their exact MBR. Entries whose values are too short for
+// the attribute are left out of the column, they never match.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rocksdb/slice.h"
+#include "util/coding.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+enum class SecAttributeColumnType : uint32_t {
+  kNone = 0,
+  kMbr = 1,
+  kQuantizedMbr = 2,
+  kValue = 3,
+};
+
+class SecAttributeColumnBuilder {
+ public:
+  explicit SecAttributeColumnBuilder(
+      SecAttributeColumnType type = SecAttributeColumnType::kNone)
+      : type_(type) {}
+
+  bool enabled() const { return type_ != SecAttributeColumnType::kNone; }
+
+  void Reset();
+
+  // Adds the entry at `offset` in the block whose value is `value`
+  void Add(uint32_t offset, const Slice& value);
+
+  // The number of bytes Finish() appends
+  size_t CurrentSizeEstimate() const;
+
+  // Appends the column and its trailer, i.e. everything but the block footer
+  void Finish(std::string* buffer) const;
+
+ private:
+  const SecAttributeColumnType type_;
+  std::vector<uint32_t> offsets_;
+  // One buffer per coordinate
+  std::string coordinates_[4];
+};
+
+// The column of a block, pointing into the block's data
+struct SecAttributeColumn {
+  SecAttributeColumnType type = SecAttributeColumnType::kNone;
+  uint32_t count = 0;
+  const char* offsets = nullptr;
+  const char* coordinates = nullptr;
+
+  bool valid() const { return type != SecAttributeColumnType::kNone; }
+
+  // Reads the column of the block `data` whose trailer ends at `*end`, the
+  // offset of the block footer, and sets `*end` to the offset the column
+  // starts at. Returns false if the trailer is corrupted.
+  bool Parse(const char* data, uint32_t* end);
+
+  uint32_t EntryOffset(uint32_t i) const {
+    return DecodeFixed32(offsets + i * sizeof(uint32_t));
+  }
+
+  // The start of the array of coordinate `coordinate`
+  const char* Coordinate(uint32_t coordinate) const {
+    return coordinates + static_cast<size_t>(coordinate) * count *
+                             CoordinateSize(type);
+  }
+
+  static size_t CoordinateSize(SecAttributeColumnType type) {
+    return type == SecAttributeColumnType::kQuantizedMbr ? sizeof(float)
+                                                         : sizeof(double);
+  }
+
+  static uint32_t NumCoordinates(SecAttributeColumnType type) {
+    return type == SecAttributeColumnType::kValue ? 1 : 4;
+  }
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,100 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/block_based/sec_index_query_plan.h"
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
+#include "memory/arena.h"
+#include "table/block_based/block_based_table_reader.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+void SecIndexQueryPlan::Clear() {
+  candidates_.clear();
+  for (size_t i = 0; i < num_files_; i++) {
+    files_[i].blocks.clear();
+    files_[i].extents.clear();
+  }
+  num_files_ = 0;
+  num_blocks_ = 0;
+  num_extents_ = 0;
+}
+
+void SecIndexQueryPlan::Finish() {
+  std::sort(candidates_.begin(), candidates_.end(),
+            [](const Candidate& a, const Candidate& b) {
+              return std::tie(a.file_number, a.offset, a.size) <
+                     std::tie(b.file_number, b.offset, b.size);
+            });
+
+  SecIndexFilePlan* file = nullptr;
+  uint64_t extent_end = 0;
+  for (size_t i = 0; i < candidates_.size(); i++) {
+    const Candidate& candidate = candidates_[i];
+    if (file == nullptr || candidate.file_number != file->file_number) {
+      if (num_files_ == files_.size()) {
+        files_.emplace_back();
+      }
+      file = &files_[num_files_++];
+      file->file_number = candidate.file_number;
+    } else if (candidate.offset == file->blocks.back().offset()) {
+      // The same partition again. Partitions never share an offset, so a
+      // different size can only be a stale duplicate: keep the first one.
+      continue;
+    }
+    file->blocks.emplace_back(candidate.offset, candidate.size);
+    const uint64_t end =
+        candidate.offset + candidate.size + BlockBasedTable::kBlockTrailerSize;
+    const uint32_t block = static_cast<uint32_t>(file->blocks.size() - 1);
+    if (!file->extents.empty() && candidate.offset <= extent_end) {
+      SecIndexReadExtent& extent = file->extents.back();
+      extent_end = std::max(extent_end, end);
+      extent.size = extent_end - extent.offset;
+      extent.num_blocks++;
+    } else {
+      file->extents.push_back({candidate.offset, end - candidate.offset,
+                               block, 1});
+      extent_end = end;
+    }
+  }
+  candidates_.clear();
+
+  for (size_t i = 0; i < num_files_; i++) {
+    num_blocks_ += files_[i].blocks.size();
+    num_extents_ += files_[i].extents.size();
+  }
+}
+
+const SecIndexFilePlanRef* CopySecIndexFilePlan(const SecIndexFilePlan& plan,
+                                                Arena* arena) {
+  static_assert(std::is_trivially_destructible<BlockHandle>::value &&
+                    std::is_trivially_destructible<SecIndexReadExtent>::value,
+                "the arena copy of a plan is never destroyed");
+  auto ref = new (arena->AllocateAligned(sizeof(SecIndexFilePlanRef)))
+      SecIndexFilePlanRef();
+  ref->file_number = plan.file_number;
+  if (!plan.blocks.empty()) {
+    auto blocks = reinterpret_cast<BlockHandle*>(
+        arena->AllocateAligned(plan.blocks.size() * sizeof(BlockHandle)));
+    std::uninitialized_copy(plan.blocks.begin(), plan.blocks.end(), blocks);
+    ref->blocks = blocks;
+    ref->num_blocks = plan.blocks.size();
+  }
+  if (!plan.extents.empty()) {
+    auto extents = reinterpret_cast<SecIndexReadExtent*>(arena->AllocateAligned(
+        plan.extents.size() * sizeof(SecIndexReadExtent)));
+    std::uninitialized_copy(plan.extents.begin(), plan.extents.end(),
+                            extents);
+    ref->extents = extents;
+    ref->num_extents = plan.extents.size();
+  }
+  return ref;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
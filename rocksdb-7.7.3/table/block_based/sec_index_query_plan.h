@@ -0,0 +1,99 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// The secondary index partitions a query has to read, as selected by the
+// global secondary index, laid out for sequential reads: grouped by file,
+// sorted by offset, without duplicates, and merged into extents of adjacent
+// or overlapping partitions so that each extent is read with one I/O.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "table/format.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class Arena;
+
+// Most read requests a secondary index iterator submits with one MultiRead
+constexpr size_t kSecIndexMaxQueueDepth = 32;
+
+// A run of partitions that are contiguous on disk. The extent spans their
+// blocks including the block trailers.
+struct SecIndexReadExtent {
+  uint64_t offset;
+  uint64_t size;
+  // Partitions [first_block, first_block + num_blocks) of the file plan
+  uint32_t first_block;
+  uint32_t num_blocks;
+};
+
+// The partitions of one file
+struct SecIndexFilePlan {
+  uint64_t file_number = 0;
+  // Ascending offsets, no duplicates
+  std::vector<BlockHandle> blocks;
+  // Ascending and disjoint, covering all of `blocks`
+  std::vector<SecIndexReadExtent> extents;
+};
+
+// A file plan as handed to the secondary index iterator of the file through
+// ReadOptions::sec_index_plan. It lives in the arena of the query's
+// iterators, so that the table iterators can refer to it for their whole
+// life without copying it, while the SecIndexQueryPlan it was copied from
+// is reused by the next query of the thread.
+struct SecIndexFilePlanRef {
+  uint64_t file_number = 0;
+  const BlockHandle* blocks = nullptr;
+  size_t num_blocks = 0;
+  const SecIndexReadExtent* extents = nullptr;
+  size_t num_extents = 0;
+};
+
+// Copies `plan` into `arena`. Nothing has to be destroyed.
+const SecIndexFilePlanRef* CopySecIndexFilePlan(const SecIndexFilePlan& plan,
+                                                Arena* arena);
+
+class SecIndexQueryPlan {
+ public:
+  // Forgets the previous query but keeps the buffers, so that reusing a plan
+  // across queries saves the allocations
+  void Clear();
+
+  // Adds a partition of a file in any order; duplicates are allowed
+  void Add(uint64_t file_number, uint64_t offset, uint64_t size) {
+    candidates_.push_back({file_number, offset, size});
+  }
+
+  // Groups the partitions added since Clear() into the file plans. Files are
+  // ordered by ascending file number.
+  void Finish();
+
+  size_t num_files() const { return num_files_; }
+  const SecIndexFilePlan& file(size_t i) const { return files_[i]; }
+
+  // Partitions and extents of all files, for logging and statistics
+  size_t num_blocks() const { return num_blocks_; }
+  size_t num_extents() const { return num_extents_; }
+
+ private:
+  struct Candidate {
+    uint64_t file_number;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  std::vector<Candidate> candidates_;
+  // Only the first num_files_ are part of the plan, the others are kept for
+  // their buffers
+  std::vector<SecIndexFilePlan> files_;
+  size_t num_files_ = 0;
+  size_t num_blocks_ = 0;
+  size_t num_extents_ = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
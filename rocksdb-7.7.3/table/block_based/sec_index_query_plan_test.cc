@@ -0,0 +1,167 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/block_based/sec_index_query_plan.h"
+
+#include "memory/arena.h"
+#include "port/stack_trace.h"
+#include "table/block_based/block_based_table_reader.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+constexpr uint64_t kTrailer = BlockBasedTable::kBlockTrailerSize;
+
+void AssertBlock(const BlockHandle& block, uint64_t offset, uint64_t size) {
+  ASSERT_EQ(offset, block.offset());
+  ASSERT_EQ(size, block.size());
+}
+
+void AssertExtent(const SecIndexReadExtent& extent, uint64_t offset,
+                  uint64_t size, uint32_t first_block, uint32_t num_blocks) {
+  ASSERT_EQ(offset, extent.offset);
+  ASSERT_EQ(size, extent.size);
+  ASSERT_EQ(first_block, extent.first_block);
+  ASSERT_EQ(num_blocks, extent.num_blocks);
+}
+
+}  // anonymous namespace
+
+class SecIndexQueryPlanTest : public testing::Test {};
+
+TEST_F(SecIndexQueryPlanTest, Empty) {
+  SecIndexQueryPlan plan;
+  plan.Finish();
+  ASSERT_EQ(0u, plan.num_files());
+  ASSERT_EQ(0u, plan.num_blocks());
+  ASSERT_EQ(0u, plan.num_extents());
+}
+
+TEST_F(SecIndexQueryPlanTest, SortsAndDedupes) {
+  SecIndexQueryPlan plan;
+  plan.Add(9, 5000, 100);
+  plan.Add(7, 300, 100);
+  plan.Add(9, 0, 100);
+  plan.Add(7, 300, 100);
+  plan.Add(7, 0, 100);
+  plan.Add(9, 5000, 100);
+  plan.Finish();
+
+  ASSERT_EQ(2u, plan.num_files());
+  ASSERT_EQ(4u, plan.num_blocks());
+  const SecIndexFilePlan& first = plan.file(0);
+  ASSERT_EQ(7u, first.file_number);
+  ASSERT_EQ(2u, first.blocks.size());
+  AssertBlock(first.blocks[0], 0, 100);
+  AssertBlock(first.blocks[1], 300, 100);
+  const SecIndexFilePlan& second = plan.file(1);
+  ASSERT_EQ(9u, second.file_number);
+  ASSERT_EQ(2u, second.blocks.size());
+  AssertBlock(second.blocks[0], 0, 100);
+  AssertBlock(second.blocks[1], 5000, 100);
+}
+
+TEST_F(SecIndexQueryPlanTest, StaleDuplicateKeepsSmallerSize) {
+  SecIndexQueryPlan plan;
+  plan.Add(7, 0, 200);
+  plan.Add(7, 0, 100);
+  plan.Finish();
+
+  ASSERT_EQ(1u, plan.num_files());
+  ASSERT_EQ(1u, plan.file(0).blocks.size());
+  AssertBlock(plan.file(0).blocks[0], 0, 100);
+  ASSERT_EQ(1u, plan.file(0).extents.size());
+  AssertExtent(plan.file(0).extents[0], 0, 100 + kTrailer, 0, 1);
+}
+
+TEST_F(SecIndexQueryPlanTest, MergesAdjacentBlocks) {
+  SecIndexQueryPlan plan;
+  // Each block starts right after the trailer of the previous one
+  plan.Add(7, 0, 100);
+  plan.Add(7, 100 + kTrailer, 50);
+  plan.Add(7, 150 + 2 * kTrailer, 10);
+  // One byte after the trailer: a new extent
+  plan.Add(7, 160 + 3 * kTrailer + 1, 20);
+  // Blocks of another file are never merged with those of this one
+  plan.Add(8, 180 + 4 * kTrailer + 1, 20);
+  plan.Finish();
+
+  ASSERT_EQ(2u, plan.num_files());
+  ASSERT_EQ(5u, plan.num_blocks());
+  ASSERT_EQ(3u, plan.num_extents());
+  const SecIndexFilePlan& file = plan.file(0);
+  ASSERT_EQ(4u, file.blocks.size());
+  ASSERT_EQ(2u, file.extents.size());
+  AssertExtent(file.extents[0], 0, 160 + 3 * kTrailer, 0, 3);
+  AssertExtent(file.extents[1], 160 + 3 * kTrailer + 1, 20 + kTrailer, 3, 1);
+  ASSERT_EQ(1u, plan.file(1).extents.size());
+  AssertExtent(plan.file(1).extents[0], 180 + 4 * kTrailer + 1, 20 + kTrailer,
+               0, 1);
+}
+
+TEST_F(SecIndexQueryPlanTest, MergesOverlappingBlocks) {
+  SecIndexQueryPlan plan;
+  plan.Add(7, 0, 1000);
+  // Inside the first block: the extent does not grow
+  plan.Add(7, 200, 100);
+  // Starts in the trailer of the first block and ends past it
+  plan.Add(7, 1000 + kTrailer - 1, 100);
+  plan.Finish();
+
+  const SecIndexFilePlan& file = plan.file(0);
+  ASSERT_EQ(3u, file.blocks.size());
+  ASSERT_EQ(1u, file.extents.size());
+  AssertExtent(file.extents[0], 0, 1100 + 2 * kTrailer - 1, 0, 3);
+}
+
+TEST_F(SecIndexQueryPlanTest, Reuse) {
+  SecIndexQueryPlan plan;
+  plan.Add(7, 0, 100);
+  plan.Add(8, 0, 100);
+  plan.Finish();
+  ASSERT_EQ(2u, plan.num_files());
+
+  plan.Clear();
+  ASSERT_EQ(0u, plan.num_files());
+  ASSERT_EQ(0u, plan.num_blocks());
+  ASSERT_EQ(0u, plan.num_extents());
+  plan.Add(9, 500, 10);
+  plan.Finish();
+  ASSERT_EQ(1u, plan.num_files());
+  ASSERT_EQ(9u, plan.file(0).file_number);
+  ASSERT_EQ(1u, plan.file(0).blocks.size());
+  AssertBlock(plan.file(0).blocks[0], 500, 10);
+  ASSERT_EQ(1u, plan.file(0).extents.size());
+  AssertExtent(plan.file(0).extents[0], 500, 10 + kTrailer, 0, 1);
+}
+
+TEST_F(SecIndexQueryPlanTest, CopyFilePlan) {
+  SecIndexQueryPlan plan;
+  plan.Add(7, 0, 100);
+  plan.Add(7, 100 + kTrailer, 100);
+  plan.Add(7, 1000, 100);
+  plan.Finish();
+
+  Arena arena;
+  const SecIndexFilePlanRef* ref = CopySecIndexFilePlan(plan.file(0), &arena);
+  // The copy outlives the plan
+  plan.Clear();
+  ASSERT_EQ(7u, ref->file_number);
+  ASSERT_EQ(3u, ref->num_blocks);
+  AssertBlock(ref->blocks[2], 1000, 100);
+  ASSERT_EQ(2u, ref->num_extents);
+  AssertExtent(ref->extents[0], 0, 200 + 2 * kTrailer, 0, 2);
+  AssertExtent(ref->extents[1], 1000, 100 + kTrailer, 2, 1);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -160,6 +160,9 @@ void PropertyBlockBuilder::AddTableProperty(const TableProperties& props) {
     Add(TablePropertiesNames::kSequenceNumberTimeMapping,
         props.seqno_to_time_mapping);
   }
+  if (!props.spatial_domain.empty()) {
+    Add(TablePropertiesNames::kSpatialDomain, props.spatial_domain);
+  }
 }
 
 Slice PropertyBlockBuilder::Finish() {
@@ -377,6 +380,8 @@ Status ReadTablePropertiesHelper(
       new_table_properties->compression_options = raw_val.ToString();
     } else if (key == TablePropertiesNames::kSequenceNumberTimeMapping) {
       new_table_properties->seqno_to_time_mapping = raw_val.ToString();
+    } else if (key == TablePropertiesNames::kSpatialDomain) {
+      new_table_properties->spatial_domain = raw_val.ToString();
     } else {
       // handle user-collected properties
       new_table_properties->user_collected_properties.insert(
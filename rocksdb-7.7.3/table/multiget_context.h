@@ -38,6 +38,9 @@ struct KeyContext {
   PinnableSlice* value;
   std::string* timestamp;
   GetContext* get_context;
+  // If not null, set to the sequence number of the newest entry found for
+  // the key
+  SequenceNumber* seq;
 
   KeyContext(ColumnFamilyHandle* col_family, const Slice& user_key,
              PinnableSlice* val, std::string* ts, Status* stat)
@@ -51,7 +54,8 @@ struct KeyContext {
         cb_arg(nullptr),
         value(val),
         timestamp(ts),
-        get_context(nullptr) {}
+        get_context(nullptr),
+        seq(nullptr) {}
 
   KeyContext() = default;
 };
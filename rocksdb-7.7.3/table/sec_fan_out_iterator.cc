@@ -0,0 +1,373 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/sec_fan_out_iterator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "memory/arena.h"
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "table/internal_iterator.h"
+#include "util/bounded_mpsc_queue.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+struct SecFanOutEntry {
+  std::string key;
+  std::string value;
+};
+
+void swap(SecFanOutEntry& a, SecFanOutEntry& b) {
+  a.key.swap(b.key);
+  a.value.swap(b.value);
+}
+
+// Entries buffered between the jobs and the reader
+constexpr size_t kSecFanOutQueueCapacity = 1024;
+
+}  // anonymous namespace
+
+class SecFanOutIterator : public InternalIterator {
+ public:
+  SecFanOutIterator(Env* env, InternalIterator** children, size_t n,
+                    size_t parallelism, bool is_arena_mode)
+      : env_(env),
+        children_(children, children + n),
+        parallelism_(parallelism),
+        is_arena_mode_(is_arena_mode),
+        queue_(new BoundedMpscQueue<SecFanOutEntry>(
+            kSecFanOutQueueCapacity)),
+        jobs_cv_(&mutex_),
+        not_full_cv_(&mutex_),
+        not_empty_cv_(&mutex_) {}
+
+  ~SecFanOutIterator() override {
+    Stop();
+    for (InternalIterator* child : children_) {
+      if (is_arena_mode_) {
+        child->~InternalIterator();
+      } else {
+        delete child;
+      }
+    }
+  }
+
+  bool Valid() const override { return valid_; }
+
+  void SeekToFirst() override { Start(nullptr); }
+
+  void Seek(const Slice& target) override { Start(&target); }
+
+  void SeekToLast() override { NotSupported(); }
+
+  void SeekForPrev(const Slice& /*target*/) override { NotSupported(); }
+
+  void Next() override {
+    assert(valid_);
+    if (local_ != nullptr) {
+      local_->Next();
+      if (LocalValid()) {
+        return;
+      }
+    }
+    Advance();
+  }
+
+  void Prev() override { NotSupported(); }
+
+  Slice key() const override {
+    assert(valid_);
+    return local_ != nullptr ? local_->key() : Slice(entry_.key);
+  }
+
+  Slice value() const override {
+    assert(valid_);
+    return local_ != nullptr ? local_->value() : Slice(entry_.value);
+  }
+
+  Status status() const override {
+    MutexLock l(&mutex_);
+    return status_;
+  }
+
+ private:
+  static void BGWork(void* arg) {
+    static_cast<SecFanOutIterator*>(arg)->Work();
+  }
+
+  // Body of a job: scans unclaimed children until there are none left,
+  // pushing copies of their entries to the queue
+  void Work() {
+    SecFanOutEntry entry;
+    while (!cancelled_.load(std::memory_order_acquire)) {
+      const size_t i = next_child_.fetch_add(1, std::memory_order_relaxed);
+      if (i >= children_.size()) {
+        break;
+      }
+      InternalIterator* child = children_[i];
+      bool cancelled = false;
+      for (Position(child); child->Valid() && child->PrepareValue();
+           child->Next()) {
+        entry.key.assign(child->key().data(), child->key().size());
+        entry.value.assign(child->value().data(), child->value().size());
+        if (!Push(&entry)) {
+          cancelled = true;
+          break;
+        }
+      }
+      if (cancelled) {
+        break;
+      }
+      FinishChild(child);
+    }
+
+    MutexLock l(&mutex_);
+    finished_jobs_++;
+    jobs_cv_.SignalAll();
+  }
+
+  // Swaps `*entry` into the queue, blocking while it is full. Returns false
+  // if the scan is cancelled first.
+  bool Push(SecFanOutEntry* entry) {
+    if (!queue_->TryPush(entry)) {
+      MutexLock l(&mutex_);
+      waiting_producers_.fetch_add(1, std::memory_order_relaxed);
+      // Pairs with the fence in Pop(): either the retry below sees the slot
+      // it frees or it sees this producer waiting and signals it
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      bool pushed;
+      while (!(pushed = queue_->TryPush(entry)) &&
+             !cancelled_.load(std::memory_order_acquire)) {
+        not_full_cv_.Wait();
+      }
+      waiting_producers_.fetch_sub(1, std::memory_order_relaxed);
+      if (!pushed) {
+        return false;
+      }
+    }
+    WakeReader();
+    return true;
+  }
+
+  // Pops the oldest entry of the queue into entry_, waking up a producer
+  // waiting for room. Returns false if the queue is empty.
+  bool Pop() {
+    if (!queue_->TryPop(&entry_)) {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_producers_.load(std::memory_order_relaxed) > 0) {
+      MutexLock l(&mutex_);
+      not_full_cv_.Signal();
+    }
+    return true;
+  }
+
+  // Called after pushing an entry or finishing a child
+  void WakeReader() {
+    // Pairs with the fence in WaitForProgress()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (reader_waiting_.load(std::memory_order_relaxed)) {
+      MutexLock l(&mutex_);
+      not_empty_cv_.Signal();
+    }
+  }
+
+  // Blocks the reader until the queue has an entry, the jobs are done with
+  // every child or the scan is cancelled
+  void WaitForProgress() {
+    MutexLock l(&mutex_);
+    reader_waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (queue_->Empty() &&
+           done_children_.load(std::memory_order_acquire) < children_.size() &&
+           !cancelled_.load(std::memory_order_acquire)) {
+      not_empty_cv_.Wait();
+    }
+    reader_waiting_.store(false, std::memory_order_relaxed);
+  }
+
+  void Start(const Slice* target) {
+    Stop();
+    {
+      MutexLock l(&mutex_);
+      status_ = Status::OK();
+    }
+    has_target_ = target != nullptr;
+    if (has_target_) {
+      target_.assign(target->data(), target->size());
+    }
+    // Drop what is left of the previous scan
+    while (Pop()) {
+    }
+    local_ = nullptr;
+    next_child_.store(0, std::memory_order_relaxed);
+    done_children_.store(0, std::memory_order_relaxed);
+    cancelled_.store(false, std::memory_order_release);
+
+    if (env_ != nullptr &&
+        env_->GetBackgroundThreads(Env::Priority::USER) > 0) {
+      const size_t jobs = std::min(parallelism_, children_.size());
+      {
+        MutexLock l(&mutex_);
+        scheduled_jobs_ = jobs;
+      }
+      for (size_t i = 0; i < jobs; i++) {
+        env_->Schedule(&SecFanOutIterator::BGWork, this, Env::Priority::USER,
+                       this);
+      }
+    }
+    Advance();
+  }
+
+  // Cancels the jobs of the current scan and waits for the running ones
+  void Stop() {
+    cancelled_.store(true, std::memory_order_release);
+    MutexLock l(&mutex_);
+    not_full_cv_.SignalAll();
+    if (finished_jobs_ < scheduled_jobs_) {
+      mutex_.Unlock();
+      const int unscheduled = env_->UnSchedule(this, Env::Priority::USER);
+      mutex_.Lock();
+      scheduled_jobs_ -= static_cast<size_t>(unscheduled);
+      while (finished_jobs_ < scheduled_jobs_) {
+        jobs_cv_.Wait();
+      }
+    }
+    scheduled_jobs_ = 0;
+    finished_jobs_ = 0;
+  }
+
+  // Moves to the next entry of the queue. When the queue is empty, scans
+  // an unclaimed child on this thread rather than waiting for the jobs, and
+  // only blocks once every child is claimed.
+  void Advance() {
+    valid_ = false;
+    local_ = nullptr;
+    for (;;) {
+      if (Pop()) {
+        valid_ = true;
+        return;
+      }
+      if (cancelled_.load(std::memory_order_acquire)) {
+        return;
+      }
+      const size_t i = next_child_.fetch_add(1, std::memory_order_relaxed);
+      if (i < children_.size()) {
+        local_ = children_[i];
+        Position(local_);
+        if (LocalValid()) {
+          return;
+        }
+        continue;
+      }
+      if (done_children_.load(std::memory_order_acquire) == children_.size()) {
+        // All entries were pushed before the last child was done
+        valid_ = Pop();
+        return;
+      }
+      WaitForProgress();
+    }
+  }
+
+  bool LocalValid() {
+    if (local_->Valid() && local_->PrepareValue()) {
+      valid_ = true;
+      return true;
+    }
+    FinishChild(local_);
+    local_ = nullptr;
+    valid_ = false;
+    return false;
+  }
+
+  void Position(InternalIterator* child) const {
+    if (has_target_) {
+      child->Seek(target_);
+    } else {
+      child->SeekToFirst();
+    }
+  }
+
+  void FinishChild(InternalIterator* child) {
+    Status s = child->status();
+    if (!s.ok()) {
+      MutexLock l(&mutex_);
+      if (status_.ok()) {
+        status_ = s;
+      }
+      cancelled_.store(true, std::memory_order_release);
+      not_full_cv_.SignalAll();
+    }
+    done_children_.fetch_add(1, std::memory_order_release);
+    WakeReader();
+  }
+
+  void NotSupported() {
+    Stop();
+    valid_ = false;
+    local_ = nullptr;
+    MutexLock l(&mutex_);
+    status_ = Status::NotSupported(
+        "Secondary index fan-out only supports forward iteration");
+  }
+
+  Env* const env_;
+  const std::vector<InternalIterator*> children_;
+  const size_t parallelism_;
+  const bool is_arena_mode_;
+
+  // Allocated separately: its counters are cache line aligned, which arena
+  // allocations are not
+  std::unique_ptr<BoundedMpscQueue<SecFanOutEntry>> queue_;
+  // Next child to claim, by a job or by the reader
+  std::atomic<size_t> next_child_{0};
+  // Children scanned to the end and whose entries are all in the queue
+  std::atomic<size_t> done_children_{0};
+  std::atomic<bool> cancelled_{true};
+  // Producers blocked on a full queue, and whether the reader is blocked on
+  // an empty one: only then do pushes and pops take mutex_ to signal
+  std::atomic<size_t> waiting_producers_{0};
+  std::atomic<bool> reader_waiting_{false};
+  bool has_target_ = false;
+  std::string target_;
+
+  // The current entry comes from local_ if it is set, from entry_ otherwise
+  bool valid_ = false;
+  InternalIterator* local_ = nullptr;
+  SecFanOutEntry entry_;
+
+  mutable port::Mutex mutex_;
+  port::CondVar jobs_cv_;
+  // Signalled when the queue stops being full, and when it stops being
+  // empty or a child is done
+  port::CondVar not_full_cv_;
+  port::CondVar not_empty_cv_;
+  // Protected by mutex_
+  Status status_;
+  size_t scheduled_jobs_ = 0;
+  size_t finished_jobs_ = 0;
+};
+
+InternalIterator* NewSecFanOutIterator(Env* env, InternalIterator** children,
+                                       size_t n, size_t parallelism,
+                                       Arena* arena) {
+  if (arena == nullptr) {
+    return new SecFanOutIterator(env, children, n, parallelism, false);
+  } else {
+    auto mem = arena->AllocateAligned(sizeof(SecFanOutIterator));
+    return new (mem) SecFanOutIterator(env, children, n, parallelism, true);
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,42 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <cstddef>
+
+#include "rocksdb/slice.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class Arena;
+class Env;
+
+template <class TValue>
+class InternalIteratorBase;
+using InternalIterator = InternalIteratorBase<Slice>;
+
+// Return an iterator that yields the entries of children[0,n-1] in no
+// particular order, for secondary index queries whose results are unordered
+// anyway. After a seek, the children are scanned concurrently by up to
+// `parallelism` jobs scheduled in the Env's USER priority pool (sized with
+// Env::SetBackgroundThreads(n, Env::Priority::USER)), which stream copies of
+// the entries through a bounded lock-free queue. The calling thread scans
+// the children no job has picked up yet when the queue runs dry, so the
+// iterator also makes progress when the pool is empty or busy.
+//
+// Only forward iteration is supported: SeekToLast(), SeekForPrev() and
+// Prev() make the iterator invalid with a NotSupported status. Seek(target)
+// seeks every child to `target`.
+//
+// Takes ownership of the child iterators and will delete them when the
+// result iterator is deleted. The children must not be used by anyone else
+// while the result iterator is alive.
+extern InternalIterator* NewSecFanOutIterator(Env* env,
+                                              InternalIterator** children,
+                                              size_t n, size_t parallelism,
+                                              Arena* arena = nullptr);
+
+}  // namespace ROCKSDB_NAMESPACE
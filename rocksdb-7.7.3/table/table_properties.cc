@@ -238,7 +238,8 @@ std::size_t TableProperties::ApproximateMemoryUsage() const {
       column_family_name.size() + filter_policy_name.size() +
       comparator_name.size() + merge_operator_name.size() +
       prefix_extractor_name.size() + property_collectors_names.size() +
-      compression_name.size() + compression_options.size();
+      compression_name.size() + compression_options.size() +
+      spatial_domain.size();
   usage += string_props_mem_usage;
 
   for (auto iter = user_collected_properties.begin();
@@ -316,6 +317,8 @@ const std::string TablePropertiesNames::kFastCompressionEstimatedDataSize =
     "rocksdb.sample_for_compression.fast.data.size";
 const std::string TablePropertiesNames::kSequenceNumberTimeMapping =
     "rocksdb.seqno.time.map";
+const std::string TablePropertiesNames::kSpatialDomain =
+    "rocksdb.spatial.domain";
 
 #ifndef NDEBUG
 // WARNING: TEST_SetRandomTableProperties assumes the following layout of
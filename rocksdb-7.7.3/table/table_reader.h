@@ -112,6 +112,15 @@ class TableReader {
   // Report an approximation of how much memory has been used.
   virtual size_t ApproximateMemoryUsage() const = 0;
 
+  // Recompute the global secondary index entries of this table from its
+  // secondary index blocks, in the format of
+  // TableBuilder::GetSecondaryEntries().
+  virtual Status GetSecondaryEntries(
+      const ReadOptions& /*read_options*/,
+      std::vector<std::pair<std::string, BlockHandle>>* /*sec_entries*/) {
+    return Status::NotSupported("GetSecondaryEntries() not supported.");
+  }
+
   // Calls get_context->SaveValue() repeatedly, starting with
   // the entry found after a call to Seek(key), until it returns false.
   // May not make such a call if filter policy says that key is not present.
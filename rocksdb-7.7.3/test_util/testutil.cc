@@ -607,8 +607,9 @@ class SpecialMemTableRep : public MemTableRep {
     return memtable_->ApproximateNumEntries(start_ikey, end_ikey);
   }
 
-  virtual MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override {
-    return memtable_->GetIterator(arena);
+  virtual MemTableRep::Iterator* GetIterator(
+      IteratorContext* iterator_context, Arena* arena = nullptr) override {
+    return memtable_->GetIterator(iterator_context, arena);
   }
 
   virtual ~SpecialMemTableRep() override {}
@@ -1,7 +1,7 @@
 // Rtree template for memtable;
 // Source code is based on https://github.com/nushoin/RTree;
-// TODO: This version does not contain a fixed memory allocator as
-// other data structure format (i.e., arena);
+// Nodes come from a slab pool (RTreeNodePool), which may be backed by the
+// arena of the owner (i.e., memtable).
 
 #ifndef RTREE_H
 #define RTREE_H
@@ -12,10 +12,25 @@
 #include <stdlib.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_set>
 #include <vector>
 #include <iostream>
 
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "memory/allocator.h"
+#include "util/math.h"
+
 #define ASSERT assert // RTree uses ASSERT( condition )
 #ifndef Min
   #define Min std::min
@@ -28,10 +43,10 @@
 // RTree.h
 //
 
-#define RTREE_TEMPLATE template<class DATATYPE, class ELEMTYPE, int NUMDIMS, class ELEMTYPEREAL, int TMAXNODES, int TMINNODES>
-#define RTREE_QUAL RTree<DATATYPE, ELEMTYPE, NUMDIMS, ELEMTYPEREAL, TMAXNODES, TMINNODES>
+#define RTREE_TEMPLATE template<class DATATYPE, class ELEMTYPE, int NUMDIMS, class ELEMTYPEREAL, int TMAXNODES, int TMINNODES, bool TSOANODES>
+#define RTREE_QUAL RTree<DATATYPE, ELEMTYPE, NUMDIMS, ELEMTYPEREAL, TMAXNODES, TMINNODES, TSOANODES>
 
-#define RTREE_DONT_USE_MEMPOOLS // This version does not contain a fixed memory allocator, fill in lines with EXAMPLE to implement one.
+// Define RTREE_DONT_USE_MEMPOOLS to allocate every node with new/delete instead of RTreeNodePool.
 #define RTREE_USE_SPHERICAL_VOLUME // Better split classification, may be slower on some systems
 
 namespace ROCKSDB_NAMESPACE {
@@ -40,6 +55,247 @@ namespace ROCKSDB_NAMESPACE {
 class RTFileStream;  // File I/O helper class, look below for implementation and notes.
 
 
+/// Fixed size block allocator for R-tree nodes. Blocks are carved out of
+/// slabs and recycled through a free list, so inserting and removing
+/// entries does not hit the general purpose allocator for every node.
+/// Slabs are taken from a_allocator if given (they then live as long as the
+/// allocator, e.g. the arena of a memtable), otherwise from the heap and
+/// released with the pool.
+/// Thread-safe: trees sharing nodes share the pool, and a snapshot may give
+/// nodes back from a reader thread while the writer allocates.
+class RTreeNodePool
+{
+public:
+
+  RTreeNodePool(size_t a_blockSize, size_t a_blocksPerSlab, Allocator* a_allocator = nullptr)
+    : m_blockSize(RoundUp(Max(a_blockSize, sizeof(FreeBlock)))),
+      m_blocksPerSlab(a_blocksPerSlab),
+      m_allocator(a_allocator),
+      m_freeList(nullptr),
+      m_memoryUsage(0)
+  {
+  }
+
+  ~RTreeNodePool()
+  {
+    for(char* slab : m_slabs)
+    {
+      delete[] slab;
+    }
+  }
+
+  RTreeNodePool(const RTreeNodePool&) = delete;
+  RTreeNodePool& operator=(const RTreeNodePool&) = delete;
+
+  void* Allocate()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_freeList == nullptr)
+    {
+      AddSlab();
+    }
+    FreeBlock* block = m_freeList;
+    m_freeList = block->m_next;
+    return block;
+  }
+
+  void Deallocate(void* a_block)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FreeBlock* block = static_cast<FreeBlock*>(a_block);
+    block->m_next = m_freeList;
+    m_freeList = block;
+  }
+
+  /// Return every block to the free list at once. Only valid when no block
+  /// is in use any more.
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeList = nullptr;
+    for(char* slab : m_slabs)
+    {
+      PushSlab(slab);
+    }
+    for(char* slab : m_arenaSlabs)
+    {
+      PushSlab(slab);
+    }
+  }
+
+  /// Bytes held by the slabs, used or not
+  size_t ApproximateMemoryUsage() const
+  {
+    return m_memoryUsage.load(std::memory_order_relaxed);
+  }
+
+private:
+
+  struct FreeBlock
+  {
+    FreeBlock* m_next;
+  };
+
+  static size_t RoundUp(size_t a_size)
+  {
+    const size_t align = alignof(std::max_align_t);
+    return (a_size + align - 1) / align * align;
+  }
+
+  void AddSlab()
+  {
+    const size_t bytes = m_blockSize * m_blocksPerSlab;
+    char* slab;
+    if(m_allocator != nullptr)
+    {
+      slab = m_allocator->AllocateAligned(bytes);
+      m_arenaSlabs.push_back(slab);
+    }
+    else
+    {
+      // new[] of char is suitably aligned for any fundamental type
+      slab = new char[bytes];
+      m_slabs.push_back(slab);
+    }
+    m_memoryUsage.fetch_add(bytes, std::memory_order_relaxed);
+    PushSlab(slab);
+  }
+
+  void PushSlab(char* a_slab)
+  {
+    for(size_t index = m_blocksPerSlab; index > 0; --index)
+    {
+      FreeBlock* block = reinterpret_cast<FreeBlock*>(a_slab + (index - 1) * m_blockSize);
+      block->m_next = m_freeList;
+      m_freeList = block;
+    }
+  }
+
+  const size_t m_blockSize;
+  const size_t m_blocksPerSlab;
+  Allocator* const m_allocator;
+  std::mutex m_mutex;
+  FreeBlock* m_freeList;
+  std::vector<char*> m_slabs;                     ///< Owned slabs
+  std::vector<char*> m_arenaSlabs;                ///< Slabs owned by m_allocator
+  std::atomic<size_t> m_memoryUsage;
+};
+
+
+/// Branch bounds of a node laid out per dimension (structure of arrays), so
+/// that all branches of a node are tested against a query rectangle with a
+/// few vector compares instead of one branch at a time. Kept next to the
+/// regular branches, which the insert and split code works on.
+template<class ELEMTYPE, int NUMDIMS, int MAXNODES, bool ENABLED>
+struct RTreeNodeBounds
+{
+  static_assert(MAXNODES <= 64, "overlap masks are 64 bits wide");
+
+  /// Padded to whole AVX-512 vectors
+  enum { CAPACITY = (MAXNODES * sizeof(ELEMTYPE) + 63) / 64 * 64 / sizeof(ELEMTYPE) };
+
+  ELEMTYPE m_min[NUMDIMS][CAPACITY];
+  ELEMTYPE m_max[NUMDIMS][CAPACITY];
+
+  void Set(int a_index, const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS])
+  {
+    for(int axis = 0; axis < NUMDIMS; ++axis)
+    {
+      m_min[axis][a_index] = a_min[axis];
+      m_max[axis][a_index] = a_max[axis];
+    }
+  }
+
+  /// Bit i is set if branch i of the first a_count overlaps the query
+  uint64_t OverlapMask(int a_count, const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS]) const
+  {
+    uint64_t mask = 0;
+    int index = 0;
+#if defined(__AVX512F__)
+    if(std::is_same<ELEMTYPE, double>::value)
+    {
+      for(; index < a_count; index += 8)
+      {
+        __mmask8 hits = 0xff;
+        for(int axis = 0; axis < NUMDIMS; ++axis)
+        {
+          const __m512d qmin = _mm512_set1_pd((double)a_min[axis]);
+          const __m512d qmax = _mm512_set1_pd((double)a_max[axis]);
+          hits = _mm512_mask_cmp_pd_mask(hits, _mm512_loadu_pd((const double*)&m_max[axis][index]), qmin, _CMP_GE_OQ);
+          hits = _mm512_mask_cmp_pd_mask(hits, _mm512_loadu_pd((const double*)&m_min[axis][index]), qmax, _CMP_LE_OQ);
+        }
+        mask |= (uint64_t)hits << index;
+      }
+    }
+    else if(std::is_same<ELEMTYPE, float>::value)
+    {
+      for(; index < a_count; index += 16)
+      {
+        __mmask16 hits = 0xffff;
+        for(int axis = 0; axis < NUMDIMS; ++axis)
+        {
+          const __m512 qmin = _mm512_set1_ps((float)a_min[axis]);
+          const __m512 qmax = _mm512_set1_ps((float)a_max[axis]);
+          hits = _mm512_mask_cmp_ps_mask(hits, _mm512_loadu_ps((const float*)&m_max[axis][index]), qmin, _CMP_GE_OQ);
+          hits = _mm512_mask_cmp_ps_mask(hits, _mm512_loadu_ps((const float*)&m_min[axis][index]), qmax, _CMP_LE_OQ);
+        }
+        mask |= (uint64_t)hits << index;
+      }
+    }
+#elif defined(__AVX2__)
+    if(std::is_same<ELEMTYPE, double>::value)
+    {
+      for(; index < a_count; index += 4)
+      {
+        __m256d hits = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        for(int axis = 0; axis < NUMDIMS; ++axis)
+        {
+          const __m256d qmin = _mm256_set1_pd((double)a_min[axis]);
+          const __m256d qmax = _mm256_set1_pd((double)a_max[axis]);
+          hits = _mm256_and_pd(hits, _mm256_cmp_pd(_mm256_loadu_pd((const double*)&m_max[axis][index]), qmin, _CMP_GE_OQ));
+          hits = _mm256_and_pd(hits, _mm256_cmp_pd(_mm256_loadu_pd((const double*)&m_min[axis][index]), qmax, _CMP_LE_OQ));
+        }
+        mask |= (uint64_t)_mm256_movemask_pd(hits) << index;
+      }
+    }
+    else if(std::is_same<ELEMTYPE, float>::value)
+    {
+      for(; index < a_count; index += 8)
+      {
+        __m256 hits = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(int axis = 0; axis < NUMDIMS; ++axis)
+        {
+          const __m256 qmin = _mm256_set1_ps((float)a_min[axis]);
+          const __m256 qmax = _mm256_set1_ps((float)a_max[axis]);
+          hits = _mm256_and_ps(hits, _mm256_cmp_ps(_mm256_loadu_ps((const float*)&m_max[axis][index]), qmin, _CMP_GE_OQ));
+          hits = _mm256_and_ps(hits, _mm256_cmp_ps(_mm256_loadu_ps((const float*)&m_min[axis][index]), qmax, _CMP_LE_OQ));
+        }
+        mask |= (uint64_t)_mm256_movemask_ps(hits) << index;
+      }
+    }
+#endif
+    // Scalar fallback; the compiler can still vectorize it
+    for(; index < a_count; ++index)
+    {
+      bool hit = true;
+      for(int axis = 0; axis < NUMDIMS; ++axis)
+      {
+        hit &= (m_max[axis][index] >= a_min[axis]) & (m_min[axis][index] <= a_max[axis]);
+      }
+      mask |= (uint64_t)hit << index;
+    }
+    // The vector loops read the padding past a_count
+    return a_count >= 64 ? mask : mask & ((uint64_t(1) << a_count) - 1);
+  }
+};
+
+template<class ELEMTYPE, int NUMDIMS, int MAXNODES>
+struct RTreeNodeBounds<ELEMTYPE, NUMDIMS, MAXNODES, false>
+{
+  void Set(int, const ELEMTYPE*, const ELEMTYPE*) {}
+};
+
+
 /// \class RTree
 /// Implementation of RTree, a multidimensional bounding rectangle tree.
 /// Example usage: For a 3-dimensional tree use RTree<Object*, float, 3> myTree;
@@ -50,6 +306,7 @@ class RTFileStream;  // File I/O helper class, look below for implementation and
 /// ELEMTYPE Type of element such as int or float
 /// NUMDIMS Number of dimensions such as 2 or 3
 /// ELEMTYPEREAL Type of element that allows fractional and large values such as float or double, for use in volume calcs
+/// TSOANODES Also keep the branch bounds of every node per dimension (RTreeNodeBounds) for vectorized searches
 ///
 /// NOTES: Inserting and removing data requires the knowledge of its constant Minimal Bounding Rectangle.
 ///        This version uses new/delete for nodes, I recommend using a fixed size allocator for efficiency.
@@ -57,10 +314,12 @@ class RTFileStream;  // File I/O helper class, look below for implementation and
 ///        array similar to MFC CArray or STL Vector for returning search query result.
 ///
 template<class DATATYPE, class ELEMTYPE, int NUMDIMS,
-         class ELEMTYPEREAL = ELEMTYPE, int TMAXNODES = 50, int TMINNODES = TMAXNODES / 2>
+         class ELEMTYPEREAL = ELEMTYPE, int TMAXNODES = 50, int TMINNODES = TMAXNODES / 2,
+         bool TSOANODES = true>
 class RTree
 {
   static_assert(std::numeric_limits<ELEMTYPEREAL>::is_iec559, "'ELEMTYPEREAL' accepts floating-point types only");
+  static_assert(TMAXNODES <= 64, "searches track the overlapping branches of a node in 64 bits");
 
 protected:
 
@@ -74,12 +333,21 @@ public:
   {
     MAXNODES = TMAXNODES,                         ///< Max elements in node
     MINNODES = TMINNODES,                         ///< Min elements in node
+    DIMS = NUMDIMS,                               ///< Number of dimensions
   };
 
+  typedef ELEMTYPE ElemType;                      ///< Type of the stored bounds
+
 public:
 
   RTree();
+  /// Take the node slabs from a_allocator, which must outlive the tree
+  explicit RTree(Allocator* a_allocator);
   RTree(const RTree& other);
+  /// Snapshot of a_other, see ShareFrom. Takes no node of its own, so
+  /// publishing a snapshot does not allocate a slab.
+  struct ShareTag {};
+  RTree(const RTree& a_other, ShareTag);
   virtual ~RTree();
 
   /// Insert entry
@@ -94,6 +362,80 @@ public:
   /// \param a_dataId Positive Id of data.  Maybe zero, but negative numbers not allowed.
   void Remove(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], const DATATYPE& a_dataId);
 
+  /// Round a rect given in a wider type, e.g. double bounds for a tree of
+  /// floats, outward to ELEMTYPE. The result covers the original rect, so
+  /// searches with narrowed rects never miss an entry but may return some
+  /// that only overlap the query after rounding. Bounds out of the range of
+  /// ELEMTYPE saturate to its finite extremes, which keeps the overlap tests
+  /// conservative as long as both entries and queries are narrowed.
+  template<class WIDETYPE>
+  static void NarrowRect(const WIDETYPE a_min[NUMDIMS], const WIDETYPE a_max[NUMDIMS],
+                         ELEMTYPE r_min[NUMDIMS], ELEMTYPE r_max[NUMDIMS])
+  {
+    static_assert(std::numeric_limits<ELEMTYPE>::is_iec559, "rounding outward needs floating-point bounds");
+    const WIDETYPE lowest = std::numeric_limits<ELEMTYPE>::lowest();
+    const WIDETYPE highest = std::numeric_limits<ELEMTYPE>::max();
+    for(int axis=0; axis<NUMDIMS; ++axis)
+    {
+      const WIDETYPE lo = std::min(std::max(a_min[axis], lowest), highest);
+      r_min[axis] = static_cast<ELEMTYPE>(lo);
+      if(r_min[axis] > lo) { r_min[axis] = std::nextafter(r_min[axis], static_cast<ELEMTYPE>(lowest)); }
+      const WIDETYPE hi = std::min(std::max(a_max[axis], lowest), highest);
+      r_max[axis] = static_cast<ELEMTYPE>(hi);
+      if(r_max[axis] < hi) { r_max[axis] = std::nextafter(r_max[axis], static_cast<ELEMTYPE>(highest)); }
+    }
+  }
+
+  /// Remove every entry overlapping the given rect for which a_predicate
+  /// returns true, e.g. all the entries of one file. The tree is walked and
+  /// condensed once for the whole batch instead of once per entry.
+  /// \param a_predicate Called as a_predicate(const DATATYPE&)
+  /// \return Returns the number of entries removed
+  template<class PREDICATE>
+  int RemoveIf(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], PREDICATE&& a_predicate)
+  {
+    return RemoveIf(a_min, a_max, 1, a_predicate);
+  }
+
+  /// RemoveIf for the entries overlapping any of a_numRects rects, e.g. the
+  /// entries of a file by their own bounds. Only the branches leading to one
+  /// of the rects are visited, so the cost follows the number of rects
+  /// rather than the area they span.
+  /// \param a_mins, a_maxs Bounds of rect i start at index i * NUMDIMS
+  template<class PREDICATE>
+  int RemoveIf(const ELEMTYPE* a_mins, const ELEMTYPE* a_maxs, size_t a_numRects, PREDICATE&& a_predicate)
+  {
+    if(a_numRects == 0)
+    {
+      return 0;
+    }
+    std::vector<Rect> rects(a_numRects);
+    std::vector<const Rect*> rectPtrs(a_numRects);
+    for(size_t index = 0; index < a_numRects; ++index)
+    {
+      for(int axis=0; axis<NUMDIMS; ++axis)
+      {
+        rects[index].m_min[axis] = a_mins[index * NUMDIMS + axis];
+        rects[index].m_max[axis] = a_maxs[index * NUMDIMS + axis];
+      }
+      rectPtrs[index] = &rects[index];
+    }
+
+    // Copy the shared nodes leading to a match before modifying any of them
+    std::unordered_set<const Node*> matches;
+    if(!MarkMatches(m_root, rectPtrs.data(), a_numRects, a_predicate, &matches))
+    {
+      return 0;
+    }
+    MakeMatchesWritable(&m_root, matches);
+
+    ListNode* reInsertList = NULL;
+    int removed = RemoveIfRec(m_root, rectPtrs.data(), a_numRects, a_predicate, &reInsertList);
+    CondenseRoot(reInsertList);
+    m_size -= removed;
+    return removed;
+  }
+
   /// Find all within search rectangle
   /// \param a_min Min of search bounding rect
   /// \param a_max Max of search bounding rect
@@ -103,12 +445,94 @@ public:
   /// \return Returns the number of entries found
   std::vector<DATATYPE> Search(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], std::function<bool (const DATATYPE&)> callback) const;
 
+  /// Find all within search rectangle without allocating: every hit is
+  /// passed to a_visitor, which is inlined instead of called through
+  /// std::function.
+  /// \param a_visitor Called as a_visitor(const DATATYPE&). Return 'true' to continue searching
+  /// \return Returns false if a_visitor stopped the search
+  template<class VISITOR>
+  bool Visit(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMDIMS], VISITOR&& a_visitor) const
+  {
+    Rect rect;
+    for(int axis=0; axis<NUMDIMS; ++axis)
+    {
+      rect.m_min[axis] = a_min[axis];
+      rect.m_max[axis] = a_max[axis];
+    }
+    return VisitRec(m_root, &rect, a_visitor);
+  }
+
   /// Remove all entries from tree
   void RemoveAll();
 
+  /// Make this tree a snapshot of a_other in O(1). Nodes are reference
+  /// counted and shared between the trees; whichever tree modifies a shared
+  /// node first copies it (and only the path leading to it), so a snapshot
+  /// never changes and can be searched without locks while the other tree
+  /// keeps being updated by its single writer.
+  void ShareFrom(const RTree& a_other);
+
+  /// Entry for bulk loading
+  struct BulkEntry
+  {
+    ELEMTYPE m_min[NUMDIMS];                      ///< Min dimensions of bounding box
+    ELEMTYPE m_max[NUMDIMS];                      ///< Max dimensions of bounding box
+    DATATYPE m_data;                              ///< Data Id
+  };
+
+  /// Order in which BulkLoad packs entries into nodes
+  enum BulkLoadMethod
+  {
+    kSortTileRecursive,                           ///< Tile every level by the centers, axis by axis
+    kHilbert,                                     ///< Sort the entries along a Hilbert curve of their centers
+  };
+
+  /// Replace all entries of the tree with a_entries. The tree is packed
+  /// bottom-up, which is much faster than inserting the entries one by one
+  /// and yields less overlapping nodes.
+  /// a_entries is reordered in place.
+  void BulkLoad(std::vector<BulkEntry>& a_entries, BulkLoadMethod a_method = kSortTileRecursive);
+
+  /// Build a packed tree, see BulkLoad
+  RTree(std::vector<BulkEntry>& a_entries, BulkLoadMethod a_method) : RTree()
+  {
+    BulkLoad(a_entries, a_method);
+  }
+
+  /// Shape of the tree, to tell how much searches have to fan out
+  struct OverlapStats
+  {
+    size_t m_nodes;                               ///< All nodes, leaves included
+    size_t m_entries;                             ///< Data entries
+    int m_height;                                 ///< Levels, a lone leaf root is 1
+    ELEMTYPEREAL m_coverage;                      ///< Summed volume of the branches of internal nodes
+    ELEMTYPEREAL m_overlap;                       ///< Summed volume shared by sibling branches of internal nodes
+
+    /// Overlap relative to coverage; 0 means disjoint siblings
+    ELEMTYPEREAL OverlapRatio() const             { return m_coverage > 0 ? m_overlap / m_coverage : 0; }
+  };
+
+  /// Walk the tree and compute its OverlapStats. Linear in the tree size,
+  /// quadratic in the node fanout.
+  OverlapStats GetOverlapStats() const;
+
+  /// Bytes allocated for the nodes of this tree and of the trees sharing them
+  size_t ApproximateMemoryUsage() const;
+
+  /// Bytes of the nodes reachable from this tree. Unlike
+  /// ApproximateMemoryUsage() this shrinks with the tree and does not count
+  /// nodes only kept alive by snapshots or free blocks of the pool.
+  size_t NodeMemoryUsage() const                  { return m_nodeCount * sizeof(Node); }
+
   /// Count the data elements in this container.  This is slow as no internal counter is maintained.
   int Count();
 
+  /// Number of data elements, kept up to date by every update
+  size_t Size() const                             { return m_size; }
+
+  /// Number of node levels, 1 for a tree that is a single leaf
+  int Height() const                              { return m_root->m_level + 1; }
+
   /// Load tree contents from file
   bool Load(const char* a_fileName);
   /// Load tree contents from stream
@@ -250,7 +674,7 @@ public:
   };
 
   /// Get 'first' for iteration
-  void GetFirst(Iterator& a_it)
+  void GetFirst(Iterator& a_it) const
   {
     a_it.Init();
     Node* first = m_root;
@@ -273,15 +697,13 @@ public:
   }
 
   /// Get Next for iteration
-  void GetNext(Iterator& a_it)                         { ++a_it; }
+  void GetNext(Iterator& a_it) const                   { ++a_it; }
 
   /// Is iterator NULL, or at end?
   bool IsNull(Iterator& a_it) const                   { return a_it.IsNull(); }
 
   /// Get object at iterator position
-  DATATYPE& GetAt(Iterator& a_it)                { 
-    int& p_it = *a_it;
-    return p_it; }
+  DATATYPE& GetAt(Iterator& a_it)                { return *a_it; }
 
 protected:
 
@@ -310,7 +732,12 @@ protected:
 
     int m_count;                                  ///< Count
     int m_level;                                  ///< Leaf is zero, others positive
+    std::atomic<int> m_refs;                      ///< Trees or parent branches pointing here
     Branch m_branch[MAXNODES];                    ///< Branch
+    RTreeNodeBounds<ELEMTYPE, NUMDIMS, MAXNODES, TSOANODES> m_bounds; ///< Copy of the branch bounds per dimension
+
+    /// Must follow every change of m_branch[a_index].m_rect
+    void SyncBounds(int a_index)                  { m_bounds.Set(a_index, m_branch[a_index].m_rect.m_min, m_branch[a_index].m_rect.m_max); }
   };
 
   /// A link list of nodes for reinsertion after a delete operation
@@ -339,6 +766,7 @@ protected:
   };
 
   Node* AllocNode();
+  static ELEMTYPEREAL UnitSphereVolume();
   void FreeNode(Node* a_node);
   void InitNode(Node* a_node);
   void InitRect(Rect* a_rect);
@@ -363,11 +791,156 @@ protected:
   bool RemoveRectRec(Rect* a_rect, const DATATYPE& a_id, Node* a_node, ListNode** a_listNode);
   ListNode* AllocListNode();
   void FreeListNode(ListNode* a_listNode);
-  bool Overlap(Rect* a_rectA, Rect* a_rectB) const;
+  bool Overlap(const Rect* a_rectA, const Rect* a_rectB) const;
+  uint64_t OverlapMask(const Node* a_node, const Rect* a_rect) const;
   void ReInsert(Node* a_node, ListNode** a_listNode);
   bool Search(Node* a_node, Rect* a_rect, int& a_foundCount, std::function<bool (const DATATYPE&)> callback) const;
   bool Search(Node* a_node, Rect* a_rect, std::vector<DATATYPE>& a_returnres, std::function<bool (const DATATYPE&)> callback) const;
+  template<class VISITOR>
+  bool VisitRec(const Node* a_node, const Rect* a_rect, VISITOR& a_visitor) const
+  {
+    uint64_t mask = OverlapMask(a_node, a_rect);
+    if(a_node->m_level > 0)
+    {
+      for(; mask != 0; mask &= mask - 1)
+      {
+        if(!VisitRec(a_node->m_branch[CountTrailingZeroBits(mask)].m_child, a_rect, a_visitor))
+        {
+          return false;
+        }
+      }
+    }
+    else
+    {
+      for(; mask != 0; mask &= mask - 1)
+      {
+        if(!a_visitor(a_node->m_branch[CountTrailingZeroBits(mask)].m_data))
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+  /// The rects out of a_rects overlapping a_branchRect. A single rect is
+  /// known to overlap already.
+  const Rect* const* OverlappingRects(const Rect* a_branchRect, const Rect* const* a_rects, size_t* a_numRects,
+                                      std::vector<const Rect*>* a_buffer) const
+  {
+    if(*a_numRects == 1)
+    {
+      return a_rects;
+    }
+    a_buffer->clear();
+    for(size_t index = 0; index < *a_numRects; ++index)
+    {
+      if(Overlap(a_rects[index], a_branchRect))
+      {
+        a_buffer->push_back(a_rects[index]);
+      }
+    }
+    *a_numRects = a_buffer->size();
+    return a_buffer->data();
+  }
+
+  /// Collect the nodes under a_node whose subtree holds an entry RemoveIf
+  /// has to remove. Returns true if a_node is one of them.
+  template<class PREDICATE>
+  bool MarkMatches(const Node* a_node, const Rect* const* a_rects, size_t a_numRects, PREDICATE& a_predicate,
+                   std::unordered_set<const Node*>* a_matches) const
+  {
+    uint64_t mask = 0;
+    for(size_t index = 0; index < a_numRects; ++index)
+    {
+      mask |= OverlapMask(a_node, a_rects[index]);
+    }
+    bool found = false;
+    std::vector<const Rect*> buffer;
+    for(; mask != 0; mask &= mask - 1)
+    {
+      const Branch& branch = a_node->m_branch[CountTrailingZeroBits(mask)];
+      if(a_node->m_level == 0)
+      {
+        if(a_predicate(branch.m_data))
+        {
+          found = true;
+        }
+        continue;
+      }
+      size_t numRects = a_numRects;
+      const Rect* const* rects = OverlappingRects(&branch.m_rect, a_rects, &numRects, &buffer);
+      if(MarkMatches(branch.m_child, rects, numRects, a_predicate, a_matches))
+      {
+        found = true;
+      }
+    }
+    if(found)
+    {
+      a_matches->insert(a_node);
+    }
+    return found;
+  }
+
+  /// Remove the entries of a writable subtree matching a_predicate, merging
+  /// branches on the way back up like RemoveRectRec.
+  template<class PREDICATE>
+  int RemoveIfRec(Node* a_node, const Rect* const* a_rects, size_t a_numRects, PREDICATE& a_predicate,
+                  ListNode** a_listNode)
+  {
+    int removed = 0;
+    std::vector<const Rect*> buffer;
+    // Walk backwards, DisconnectBranch moves the last branch into the gap
+    for(int index = a_node->m_count - 1; index >= 0; --index)
+    {
+      Branch& branch = a_node->m_branch[index];
+      bool overlaps = false;
+      for(size_t rect = 0; rect < a_numRects && !overlaps; ++rect)
+      {
+        overlaps = Overlap(a_rects[rect], &branch.m_rect);
+      }
+      if(!overlaps)
+      {
+        continue;
+      }
+      if(a_node->IsInternalNode())
+      {
+        Node* child = branch.m_child;
+        size_t numRects = a_numRects;
+        const Rect* const* rects = OverlappingRects(&branch.m_rect, a_rects, &numRects, &buffer);
+        int childRemoved = RemoveIfRec(child, rects, numRects, a_predicate, a_listNode);
+        if(childRemoved == 0)
+        {
+          continue;
+        }
+        removed += childRemoved;
+        if(child->m_count >= MINNODES)
+        {
+          branch.m_rect = NodeCover(child);
+          a_node->SyncBounds(index);
+        }
+        else
+        {
+          ReInsert(child, a_listNode);
+          DisconnectBranch(a_node, index);
+        }
+      }
+      else if(a_predicate(branch.m_data))
+      {
+        ++removed;
+        DisconnectBranch(a_node, index);
+      }
+    }
+    return removed;
+  }
+
   void RemoveAllRec(Node* a_node);
+  void MakeWritable(Node** a_node);
+  void MakeMatchesWritable(Node** a_node, const std::unordered_set<const Node*>& a_matches);
+  void CondenseRoot(ListNode* a_reInsertList);
+  bool FindPath(Rect* a_rect, const DATATYPE& a_id, Node* a_node, std::vector<int>* a_path) const;
+  void StrSort(Branch* a_first, size_t a_count, int a_axis);
+  void HilbertSort(std::vector<Branch>* a_branches);
+  void OverlapStatsRec(const Node* a_node, OverlapStats* a_stats) const;
   void Reset();
   void CountRec(Node* a_node, int& a_count);
 
@@ -376,6 +949,10 @@ protected:
   void CopyRec(Node* current, Node* other);
 
   Node* m_root;                                    ///< Root of tree
+  size_t m_size;                                   ///< Number of data elements
+  size_t m_nodeCount;                              ///< Nodes reachable from m_root
+  std::shared_ptr<RTreeNodePool> m_nodePool;       ///< Shared by the trees sharing nodes
+  RTreeNodePool m_listNodePool;                    ///< Reinsertion list entries, private
   ELEMTYPEREAL m_unitSphereVolume;                 ///< Unit sphere constant for required number of dimensions
 
 public:
@@ -463,11 +1040,43 @@ public:
 
 
 RTREE_TEMPLATE
-RTREE_QUAL::RTree()
+RTREE_QUAL::RTree() : RTree(nullptr)
+{
+}
+
+
+RTREE_TEMPLATE
+RTREE_QUAL::RTree(Allocator* a_allocator)
+  : m_nodePool(std::make_shared<RTreeNodePool>(sizeof(Node), 64, a_allocator)),
+    m_listNodePool(sizeof(ListNode), 16)
 {
   ASSERT(MAXNODES > MINNODES);
   ASSERT(MINNODES > 0);
 
+  m_nodeCount = 0;
+  m_root = AllocNode();
+  m_root->m_level = 0;
+  m_size = 0;
+  m_unitSphereVolume = UnitSphereVolume();
+}
+
+
+RTREE_TEMPLATE
+RTREE_QUAL::RTree(const RTree& a_other, ShareTag)
+  : m_nodePool(a_other.m_nodePool),
+    m_listNodePool(sizeof(ListNode), 16)
+{
+  a_other.m_root->m_refs.fetch_add(1, std::memory_order_relaxed);
+  m_root = a_other.m_root;
+  m_size = a_other.m_size;
+  m_nodeCount = a_other.m_nodeCount;
+  m_unitSphereVolume = UnitSphereVolume();
+}
+
+
+RTREE_TEMPLATE
+ELEMTYPEREAL RTREE_QUAL::UnitSphereVolume()
+{
   // Precomputed volumes of the unit spheres for the first few dimensions
   const float UNIT_SPHERE_VOLUMES[] = {
     0.000000f, 2.000000f, 3.141593f, // Dimension  0,1,2
@@ -478,10 +1087,7 @@ RTREE_QUAL::RTree()
     0.381443f, 0.235331f, 0.140981f, // Dimension  15,16,17
     0.082146f, 0.046622f, 0.025807f, // Dimension  18,19,20
   };
-
-  m_root = AllocNode();
-  m_root->m_level = 0;
-  m_unitSphereVolume = (ELEMTYPEREAL)UNIT_SPHERE_VOLUMES[NUMDIMS];
+  return (ELEMTYPEREAL)UNIT_SPHERE_VOLUMES[NUMDIMS];
 }
 
 
@@ -489,6 +1095,7 @@ RTREE_TEMPLATE
 RTREE_QUAL::RTree(const RTree& other) : RTree()
 {
   CopyRec(m_root, other.m_root);
+  m_size = other.m_size;
 }
 
 
@@ -520,6 +1127,7 @@ void RTREE_QUAL::Insert(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMD
   }
 
   InsertRect(branch, &m_root, 0);
+  ++m_size;
 }
 
 
@@ -541,7 +1149,10 @@ void RTREE_QUAL::Remove(const ELEMTYPE a_min[NUMDIMS], const ELEMTYPE a_max[NUMD
     rect.m_max[axis] = a_max[axis];
   }
 
-  RemoveRect(&rect, a_dataId, &m_root);
+  if(!RemoveRect(&rect, a_dataId, &m_root))
+  {
+    --m_size;
+  }
 }
 
 
@@ -574,6 +1185,13 @@ std::vector<DATATYPE> RTREE_QUAL::Search(const ELEMTYPE a_min[NUMDIMS], const EL
 }
 
 
+RTREE_TEMPLATE
+size_t RTREE_QUAL::ApproximateMemoryUsage() const
+{
+  return m_nodePool->ApproximateMemoryUsage() + m_listNodePool.ApproximateMemoryUsage();
+}
+
+
 RTREE_TEMPLATE
 int RTREE_QUAL::Count()
 {
@@ -684,6 +1302,7 @@ bool RTREE_QUAL::LoadRec(Node* a_node, RTFileStream& a_stream)
 
       a_stream.ReadArray(curBranch->m_rect.m_min, NUMDIMS);
       a_stream.ReadArray(curBranch->m_rect.m_max, NUMDIMS);
+      a_node->SyncBounds(index);
 
       curBranch->m_child = AllocNode();
       LoadRec(curBranch->m_child, a_stream);
@@ -697,9 +1316,11 @@ bool RTREE_QUAL::LoadRec(Node* a_node, RTFileStream& a_stream)
 
       a_stream.ReadArray(curBranch->m_rect.m_min, NUMDIMS);
       a_stream.ReadArray(curBranch->m_rect.m_max, NUMDIMS);
+      a_node->SyncBounds(index);
 
       a_stream.Read(curBranch->m_data);
     }
+    m_size += a_node->m_count;
   }
 
   return true; // Should do more error checking on I/O operations
@@ -726,6 +1347,7 @@ void RTREE_QUAL::CopyRec(Node* current, Node* other)
       std::copy(otherBranch->m_rect.m_max,
                 otherBranch->m_rect.m_max + NUMDIMS,
                 currentBranch->m_rect.m_max);
+      current->SyncBounds(index);
 
       currentBranch->m_child = AllocNode();
       CopyRec(currentBranch->m_child, otherBranch->m_child);
@@ -745,6 +1367,7 @@ void RTREE_QUAL::CopyRec(Node* current, Node* other)
       std::copy(otherBranch->m_rect.m_max,
                 otherBranch->m_rect.m_max + NUMDIMS,
                 currentBranch->m_rect.m_max);
+      current->SyncBounds(index);
 
       currentBranch->m_data = otherBranch->m_data;
     }
@@ -839,6 +1462,241 @@ void RTREE_QUAL::RemoveAll()
 
   m_root = AllocNode();
   m_root->m_level = 0;
+  m_size = 0;
+}
+
+
+RTREE_TEMPLATE
+void RTREE_QUAL::ShareFrom(const RTree& a_other)
+{
+  if(m_root == a_other.m_root)
+  {
+    return;
+  }
+  a_other.m_root->m_refs.fetch_add(1, std::memory_order_relaxed);
+  Reset();
+  m_root = a_other.m_root;
+  m_size = a_other.m_size;
+  m_nodeCount = a_other.m_nodeCount;
+  // Whichever tree drops a node last gives it back to the pool it came from
+  m_nodePool = a_other.m_nodePool;
+}
+
+
+RTREE_TEMPLATE
+void RTREE_QUAL::BulkLoad(std::vector<BulkEntry>& a_entries, BulkLoadMethod a_method)
+{
+  RemoveAll();
+  if(a_entries.empty())
+  {
+    return;
+  }
+  m_size = a_entries.size();
+
+  std::vector<Branch> branches(a_entries.size());
+  for(size_t index = 0; index < a_entries.size(); ++index)
+  {
+    Branch& branch = branches[index];
+    for(int axis = 0; axis < NUMDIMS; ++axis)
+    {
+      branch.m_rect.m_min[axis] = a_entries[index].m_min[axis];
+      branch.m_rect.m_max[axis] = a_entries[index].m_max[axis];
+    }
+    branch.m_child = NULL;
+    branch.m_data = a_entries[index].m_data;
+  }
+
+  // Pack one level at a time; the branches of the next level point to the
+  // nodes just built. Nodes are filled up completely, except for the last
+  // two which share the remainder so that neither falls below MINNODES.
+  if(a_method == kHilbert)
+  {
+    // The upper levels keep the order of their children
+    HilbertSort(&branches);
+  }
+
+  int level = 0;
+  for(;;)
+  {
+    if(a_method == kSortTileRecursive)
+    {
+      StrSort(branches.data(), branches.size(), 0);
+    }
+
+    std::vector<Branch> parents;
+    size_t next = 0;
+    while(next < branches.size())
+    {
+      const size_t remaining = branches.size() - next;
+      size_t count = remaining;
+      if(remaining > (size_t)MAXNODES)
+      {
+        count = remaining < 2 * (size_t)MAXNODES ? remaining / 2 : (size_t)MAXNODES;
+      }
+      Node* node = AllocNode();
+      node->m_level = level;
+      for(size_t index = 0; index < count; ++index)
+      {
+        node->m_branch[node->m_count] = branches[next++];
+        node->SyncBounds(node->m_count++);
+      }
+      Branch parent;
+      parent.m_rect = NodeCover(node);
+      parent.m_child = node;
+      parents.push_back(parent);
+    }
+
+    if(parents.size() == 1)
+    {
+      FreeNode(m_root);
+      m_root = parents[0].m_child;
+      return;
+    }
+    branches.swap(parents);
+    ++level;
+  }
+}
+
+
+// Sort-Tile-Recursive: order a_count branches by the center of a_axis, cut
+// them into vertical slabs and sort each slab by the remaining axes.
+RTREE_TEMPLATE
+void RTREE_QUAL::StrSort(Branch* a_first, size_t a_count, int a_axis)
+{
+  std::sort(a_first, a_first + a_count,
+            [a_axis](const Branch& a_lhs, const Branch& a_rhs)
+            {
+              return (a_lhs.m_rect.m_min[a_axis] + a_lhs.m_rect.m_max[a_axis]) <
+                     (a_rhs.m_rect.m_min[a_axis] + a_rhs.m_rect.m_max[a_axis]);
+            });
+  if(a_axis == NUMDIMS - 1 || a_count <= (size_t)MAXNODES)
+  {
+    return;
+  }
+
+  const size_t numNodes = (a_count + MAXNODES - 1) / MAXNODES;
+  const size_t numSlabs = (size_t)ceil(pow((double)numNodes, 1.0 / (NUMDIMS - a_axis)));
+  const size_t slabSize = MAXNODES * ((numNodes + numSlabs - 1) / numSlabs);
+  for(size_t start = 0; start < a_count; start += slabSize)
+  {
+    StrSort(a_first + start, Min(slabSize, a_count - start), a_axis + 1);
+  }
+}
+
+
+// Hilbert packing: order the branches by the position of their center on a
+// Hilbert curve over the first two axes, scaled to the bounds of all centers.
+RTREE_TEMPLATE
+void RTREE_QUAL::HilbertSort(std::vector<Branch>* a_branches)
+{
+  const int axes = Min(NUMDIMS, 2);
+  const uint32_t side = 1u << 16;
+  ELEMTYPEREAL low[2] = {0, 0};
+  ELEMTYPEREAL high[2] = {0, 0};
+  for(int axis = 0; axis < axes; ++axis)
+  {
+    low[axis] = std::numeric_limits<ELEMTYPEREAL>::max();
+    high[axis] = std::numeric_limits<ELEMTYPEREAL>::lowest();
+    for(const Branch& branch : *a_branches)
+    {
+      const ELEMTYPEREAL center = ((ELEMTYPEREAL)branch.m_rect.m_min[axis] + (ELEMTYPEREAL)branch.m_rect.m_max[axis]) / 2;
+      low[axis] = Min(low[axis], center);
+      high[axis] = Max(high[axis], center);
+    }
+  }
+
+  std::vector<std::pair<uint64_t, size_t>> keys(a_branches->size());
+  for(size_t index = 0; index < a_branches->size(); ++index)
+  {
+    const Branch& branch = (*a_branches)[index];
+    uint32_t cell[2] = {0, 0};
+    for(int axis = 0; axis < axes; ++axis)
+    {
+      const ELEMTYPEREAL center = ((ELEMTYPEREAL)branch.m_rect.m_min[axis] + (ELEMTYPEREAL)branch.m_rect.m_max[axis]) / 2;
+      const ELEMTYPEREAL extent = high[axis] - low[axis];
+      cell[axis] = extent > 0 ? (uint32_t)Min((ELEMTYPEREAL)(side - 1), (center - low[axis]) / extent * (side - 1)) : 0;
+    }
+
+    // Distance along the curve of cell (x, y), see "Hacker's Delight" 16-2
+    uint32_t x = cell[0];
+    uint32_t y = cell[1];
+    uint64_t distance = 0;
+    for(uint32_t half = side / 2; half > 0; half /= 2)
+    {
+      const uint32_t rx = (x & half) ? 1 : 0;
+      const uint32_t ry = (y & half) ? 1 : 0;
+      distance += (uint64_t)half * half * ((3 * rx) ^ ry);
+      if(ry == 0)
+      {
+        if(rx == 1)
+        {
+          x = side - 1 - x;
+          y = side - 1 - y;
+        }
+        std::swap(x, y);
+      }
+    }
+    keys[index] = std::make_pair(distance, index);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<Branch> sorted;
+  sorted.reserve(a_branches->size());
+  for(const auto& key : keys)
+  {
+    sorted.push_back((*a_branches)[key.second]);
+  }
+  a_branches->swap(sorted);
+}
+
+
+RTREE_TEMPLATE
+typename RTREE_QUAL::OverlapStats RTREE_QUAL::GetOverlapStats() const
+{
+  OverlapStats stats;
+  stats.m_nodes = 0;
+  stats.m_entries = 0;
+  stats.m_height = m_root->m_level + 1;
+  stats.m_coverage = 0;
+  stats.m_overlap = 0;
+  OverlapStatsRec(m_root, &stats);
+  return stats;
+}
+
+
+RTREE_TEMPLATE
+void RTREE_QUAL::OverlapStatsRec(const Node* a_node, OverlapStats* a_stats) const
+{
+  ++a_stats->m_nodes;
+  if(a_node->m_level == 0)
+  {
+    a_stats->m_entries += a_node->m_count;
+    return;
+  }
+
+  for(int index = 0; index < a_node->m_count; ++index)
+  {
+    const Rect& rect = a_node->m_branch[index].m_rect;
+    ELEMTYPEREAL volume = 1;
+    for(int axis = 0; axis < NUMDIMS; ++axis)
+    {
+      volume *= (ELEMTYPEREAL)rect.m_max[axis] - (ELEMTYPEREAL)rect.m_min[axis];
+    }
+    a_stats->m_coverage += volume;
+
+    for(int other = index + 1; other < a_node->m_count; ++other)
+    {
+      const Rect& otherRect = a_node->m_branch[other].m_rect;
+      ELEMTYPEREAL shared = 1;
+      for(int axis = 0; axis < NUMDIMS && shared > 0; ++axis)
+      {
+        shared *= Max((ELEMTYPEREAL)0, (ELEMTYPEREAL)Min(rect.m_max[axis], otherRect.m_max[axis]) -
+                                       (ELEMTYPEREAL)Max(rect.m_min[axis], otherRect.m_min[axis]));
+      }
+      a_stats->m_overlap += shared;
+    }
+    OverlapStatsRec(a_node->m_branch[index].m_child, a_stats);
+  }
 }
 
 
@@ -849,9 +1707,18 @@ void RTREE_QUAL::Reset()
   // Delete all existing nodes
   RemoveAllRec(m_root);
 #else // RTREE_DONT_USE_MEMPOOLS
-  // Just reset memory pools.  We are not using complex types
-  // EXAMPLE
+  if(m_nodePool.use_count() == 1)
+  {
+    // No other tree can hold any of the nodes, so give all of them back at
+    // once instead of walking the tree. Node destructors have nothing to do.
+    m_nodePool->Clear();
+  }
+  else
+  {
+    RemoveAllRec(m_root);
+  }
 #endif // RTREE_DONT_USE_MEMPOOLS
+  m_nodeCount = 0;
 }
 
 
@@ -861,6 +1728,12 @@ void RTREE_QUAL::RemoveAllRec(Node* a_node)
   ASSERT(a_node);
   ASSERT(a_node->m_level >= 0);
 
+  // Still in use by another tree
+  if(a_node->m_refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+  {
+    return;
+  }
+
   if(a_node->IsInternalNode()) // This is an internal node in the tree
   {
     for(int index=0; index < a_node->m_count; ++index)
@@ -872,6 +1745,150 @@ void RTREE_QUAL::RemoveAllRec(Node* a_node)
 }
 
 
+// Copy-on-write: replace *a_node by a private copy if another tree shares
+// it. The caller must have made the parent writable already, so a tree only
+// ever modifies nodes that no snapshot can reach.
+RTREE_TEMPLATE
+void RTREE_QUAL::MakeWritable(Node** a_node)
+{
+  Node* node = *a_node;
+  if(node->m_refs.load(std::memory_order_acquire) == 1)
+  {
+    return;
+  }
+
+  Node* copy = AllocNode();
+  // The original leaves this tree whether or not it is freed below
+  const size_t nodeCount = m_nodeCount - 1;
+  copy->m_count = node->m_count;
+  copy->m_level = node->m_level;
+  for(int index = 0; index < node->m_count; ++index)
+  {
+    copy->m_branch[index] = node->m_branch[index];
+    copy->SyncBounds(index);
+    if(node->IsInternalNode())
+    {
+      node->m_branch[index].m_child->m_refs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  RemoveAllRec(node);
+  m_nodeCount = nodeCount;
+  *a_node = copy;
+}
+
+
+// Copy-on-write for RemoveIf: make every node MarkMatches collected
+// writable, top down. Copies keep the child pointers of the original, so the
+// marks still identify the children.
+RTREE_TEMPLATE
+void RTREE_QUAL::MakeMatchesWritable(Node** a_node, const std::unordered_set<const Node*>& a_matches)
+{
+  MakeWritable(a_node);
+  Node* node = *a_node;
+  if(node->IsInternalNode())
+  {
+    for(int index = 0; index < node->m_count; ++index)
+    {
+      Node** child = &node->m_branch[index].m_child;
+      if(a_matches.count(*child) != 0)
+      {
+        MakeMatchesWritable(child, a_matches);
+      }
+    }
+  }
+}
+
+
+// Reinsert the branches of the nodes eliminated by RemoveIfRec and drop
+// redundant roots.
+RTREE_TEMPLATE
+void RTREE_QUAL::CondenseRoot(ListNode* a_reInsertList)
+{
+  if(m_root->IsInternalNode() && m_root->m_count == 0)
+  {
+    // Everything under the root went away. The highest eliminated node
+    // that still has branches becomes the root, so that all the others can
+    // be reinserted below it.
+    ListNode** highest = NULL;
+    for(ListNode** it = &a_reInsertList; *it; it = &(*it)->m_next)
+    {
+      if((*it)->m_node->m_count > 0 &&
+         (highest == NULL || (*it)->m_node->m_level > (*highest)->m_node->m_level))
+      {
+        highest = it;
+      }
+    }
+    FreeNode(m_root);
+    if(highest)
+    {
+      ListNode* found = *highest;
+      m_root = found->m_node;
+      *highest = found->m_next;
+      FreeListNode(found);
+    }
+    else
+    {
+      m_root = AllocNode();
+      m_root->m_level = 0;
+    }
+  }
+
+  while(a_reInsertList)
+  {
+    Node* tempNode = a_reInsertList->m_node;
+    for(int index = 0; index < tempNode->m_count; ++index)
+    {
+      InsertRect(tempNode->m_branch[index], &m_root, tempNode->m_level);
+    }
+
+    ListNode* remLNode = a_reInsertList;
+    a_reInsertList = a_reInsertList->m_next;
+
+    FreeNode(remLNode->m_node);
+    FreeListNode(remLNode);
+  }
+
+  while(m_root->IsInternalNode() && m_root->m_count == 1)
+  {
+    Node* tempNode = m_root->m_branch[0].m_child;
+    FreeNode(m_root);
+    m_root = tempNode;
+  }
+}
+
+
+// Find the branches leading to a_id, in the order RemoveRectRec visits them.
+RTREE_TEMPLATE
+bool RTREE_QUAL::FindPath(Rect* a_rect, const DATATYPE& a_id, Node* a_node, std::vector<int>* a_path) const
+{
+  if(a_node->IsInternalNode())
+  {
+    for(int index = 0; index < a_node->m_count; ++index)
+    {
+      if(Overlap(a_rect, &(a_node->m_branch[index].m_rect)))
+      {
+        a_path->push_back(index);
+        if(FindPath(a_rect, a_id, a_node->m_branch[index].m_child, a_path))
+        {
+          return true;
+        }
+        a_path->pop_back();
+      }
+    }
+    return false;
+  }
+
+  for(int index = 0; index < a_node->m_count; ++index)
+  {
+    if(a_node->m_branch[index].m_data == a_id)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
 RTREE_TEMPLATE
 typename RTREE_QUAL::Node* RTREE_QUAL::AllocNode()
 {
@@ -879,9 +1896,10 @@ typename RTREE_QUAL::Node* RTREE_QUAL::AllocNode()
 #ifdef RTREE_DONT_USE_MEMPOOLS
   newNode = new Node;
 #else // RTREE_DONT_USE_MEMPOOLS
-  // EXAMPLE
+  newNode = new (m_nodePool->Allocate()) Node;
 #endif // RTREE_DONT_USE_MEMPOOLS
   InitNode(newNode);
+  ++m_nodeCount;
   return newNode;
 }
 
@@ -894,8 +1912,10 @@ void RTREE_QUAL::FreeNode(Node* a_node)
 #ifdef RTREE_DONT_USE_MEMPOOLS
   delete a_node;
 #else // RTREE_DONT_USE_MEMPOOLS
-  // EXAMPLE
+  a_node->~Node();
+  m_nodePool->Deallocate(a_node);
 #endif // RTREE_DONT_USE_MEMPOOLS
+  --m_nodeCount;
 }
 
 
@@ -907,7 +1927,7 @@ typename RTREE_QUAL::ListNode* RTREE_QUAL::AllocListNode()
 #ifdef RTREE_DONT_USE_MEMPOOLS
   return new ListNode;
 #else // RTREE_DONT_USE_MEMPOOLS
-  // EXAMPLE
+  return new (m_listNodePool.Allocate()) ListNode;
 #endif // RTREE_DONT_USE_MEMPOOLS
 }
 
@@ -918,7 +1938,7 @@ void RTREE_QUAL::FreeListNode(ListNode* a_listNode)
 #ifdef RTREE_DONT_USE_MEMPOOLS
   delete a_listNode;
 #else // RTREE_DONT_USE_MEMPOOLS
-  // EXAMPLE
+  m_listNodePool.Deallocate(a_listNode);
 #endif // RTREE_DONT_USE_MEMPOOLS
 }
 
@@ -928,6 +1948,7 @@ void RTREE_QUAL::InitNode(Node* a_node)
 {
   a_node->m_count = 0;
   a_node->m_level = -1;
+  a_node->m_refs.store(1, std::memory_order_relaxed);
 }
 
 
@@ -964,6 +1985,7 @@ bool RTREE_QUAL::InsertRectRec(const Branch& a_branch, Node* a_node, Node** a_ne
 
     // find the optimal branch for this record
     int index = PickBranch(&a_branch.m_rect, a_node);
+    MakeWritable(&a_node->m_branch[index].m_child);
 
     // recursively insert this record into the picked branch
     bool childWasSplit = InsertRectRec(a_branch, a_node->m_branch[index].m_child, &otherNode, a_level);
@@ -973,6 +1995,7 @@ bool RTREE_QUAL::InsertRectRec(const Branch& a_branch, Node* a_node, Node** a_ne
       // Child was not split. Merge the bounding box of the new record with the
       // existing bounding box
       a_node->m_branch[index].m_rect = CombineRect(&a_branch.m_rect, &(a_node->m_branch[index].m_rect));
+      a_node->SyncBounds(index);
       return false;
     }
     else
@@ -980,6 +2003,7 @@ bool RTREE_QUAL::InsertRectRec(const Branch& a_branch, Node* a_node, Node** a_ne
       // Child was split. The old branches are now re-partitioned to two nodes
       // so we have to re-calculate the bounding boxes of each node
       a_node->m_branch[index].m_rect = NodeCover(a_node->m_branch[index].m_child);
+      a_node->SyncBounds(index);
       Branch branch;
       branch.m_child = otherNode;
       branch.m_rect = NodeCover(otherNode);
@@ -1024,6 +2048,7 @@ bool RTREE_QUAL::InsertRect(const Branch& a_branch, Node** a_root, int a_level)
 
   Node* newNode;
 
+  MakeWritable(a_root);
   if(InsertRectRec(a_branch, *a_root, &newNode, a_level))  // Root split
   {
     // Grow tree taller and new root
@@ -1081,6 +2106,7 @@ bool RTREE_QUAL::AddBranch(const Branch* a_branch, Node* a_node, Node** a_newNod
   if(a_node->m_count < MAXNODES)  // Split won't be necessary
   {
     a_node->m_branch[a_node->m_count] = *a_branch;
+    a_node->SyncBounds(a_node->m_count);
     ++a_node->m_count;
 
     return false;
@@ -1105,6 +2131,7 @@ void RTREE_QUAL::DisconnectBranch(Node* a_node, int a_index)
 
   // Remove element by swapping with the last element to prevent gaps in array
   a_node->m_branch[a_index] = a_node->m_branch[a_node->m_count - 1];
+  a_node->SyncBounds(a_index);
 
   --a_node->m_count;
 }
@@ -1213,7 +2240,7 @@ ELEMTYPEREAL RTREE_QUAL::RectVolume(Rect* a_rect)
 
   for(int index=0; index<NUMDIMS; ++index)
   {
-    volume *= a_rect->m_max[index] - a_rect->m_min[index];
+    volume *= (ELEMTYPEREAL)a_rect->m_max[index] - (ELEMTYPEREAL)a_rect->m_min[index];
   }
 
   ASSERT(volume >= (ELEMTYPEREAL)0);
@@ -1426,7 +2453,9 @@ void RTREE_QUAL::InitParVars(PartitionVars* a_parVars, int a_maxRects, int a_min
 RTREE_TEMPLATE
 void RTREE_QUAL::PickSeeds(PartitionVars* a_parVars)
 {
-  int seed0 = 0, seed1 = 0;
+  // Distinct seeds even if no pair beats the initial worst, which happens
+  // once the areas are too large for the "- 1" below to change them
+  int seed0 = 0, seed1 = 1;
   ELEMTYPEREAL worst, waste;
   ELEMTYPEREAL area[MAXNODES+1];
 
@@ -1494,6 +2523,20 @@ bool RTREE_QUAL::RemoveRect(Rect* a_rect, const DATATYPE& a_id, Node** a_root)
 
   ListNode* reInsertList = NULL;
 
+  // Copy the shared nodes RemoveRectRec is going to modify
+  std::vector<int> path;
+  if(!FindPath(a_rect, a_id, *a_root, &path))
+  {
+    return true;
+  }
+  Node** node = a_root;
+  MakeWritable(node);
+  for(int index : path)
+  {
+    node = &(*node)->m_branch[index].m_child;
+    MakeWritable(node);
+  }
+
   if(!RemoveRectRec(a_rect, a_id, *a_root, &reInsertList))
   {
     // Found and deleted a data item
@@ -1558,6 +2601,7 @@ bool RTREE_QUAL::RemoveRectRec(Rect* a_rect, const DATATYPE& a_id, Node* a_node,
           {
             // child removed, just resize parent rect
             a_node->m_branch[index].m_rect = NodeCover(a_node->m_branch[index].m_child);
+            a_node->SyncBounds(index);
           }
           else
           {
@@ -1588,7 +2632,7 @@ bool RTREE_QUAL::RemoveRectRec(Rect* a_rect, const DATATYPE& a_id, Node* a_node,
 
 // Decide whether two rectangles overlap.
 RTREE_TEMPLATE
-bool RTREE_QUAL::Overlap(Rect* a_rectA, Rect* a_rectB) const
+bool RTREE_QUAL::Overlap(const Rect* a_rectA, const Rect* a_rectB) const
 {
   ASSERT(a_rectA && a_rectB);
 
@@ -1604,6 +2648,29 @@ bool RTREE_QUAL::Overlap(Rect* a_rectA, Rect* a_rectB) const
 }
 
 
+// Bit i is set if branch i of a_node overlaps a_rect
+RTREE_TEMPLATE
+uint64_t RTREE_QUAL::OverlapMask(const Node* a_node, const Rect* a_rect) const
+{
+  if constexpr(TSOANODES)
+  {
+    return a_node->m_bounds.OverlapMask(a_node->m_count, a_rect->m_min, a_rect->m_max);
+  }
+  else
+  {
+    uint64_t mask = 0;
+    for(int index = 0; index < a_node->m_count; ++index)
+    {
+      if(Overlap(a_rect, &a_node->m_branch[index].m_rect))
+      {
+        mask |= uint64_t(1) << index;
+      }
+    }
+    return mask;
+  }
+}
+
+
 // Add a node to the reinsertion list.  All its branches will later
 // be reinserted into the index structure.
 RTREE_TEMPLATE
@@ -1629,32 +2696,27 @@ bool RTREE_QUAL::Search(Node* a_node, Rect* a_rect, int& a_foundCount, std::func
   if(a_node->IsInternalNode())
   {
     // This is an internal node in the tree
-    for(int index=0; index < a_node->m_count; ++index)
+    for(uint64_t mask = OverlapMask(a_node, a_rect); mask != 0; mask &= mask - 1)
     {
-      if(Overlap(a_rect, &a_node->m_branch[index].m_rect))
+      const int index = CountTrailingZeroBits(mask);
+      if(!Search(a_node->m_branch[index].m_child, a_rect, a_foundCount, callback))
       {
-        if(!Search(a_node->m_branch[index].m_child, a_rect, a_foundCount, callback))
-        {
-          // The callback indicated to stop searching
-          return false;
-        }
+        // The callback indicated to stop searching
+        return false;
       }
     }
   }
   else
   {
     // This is a leaf node
-    for(int index=0; index < a_node->m_count; ++index)
+    for(uint64_t mask = OverlapMask(a_node, a_rect); mask != 0; mask &= mask - 1)
     {
-      if(Overlap(a_rect, &a_node->m_branch[index].m_rect))
-      {
-        DATATYPE& id = a_node->m_branch[index].m_data;
-        ++a_foundCount;
+      DATATYPE& id = a_node->m_branch[CountTrailingZeroBits(mask)].m_data;
+      ++a_foundCount;
 
-          if(callback && !callback(id))
-          {
-            return false; // Don't continue searching
-          }
+      if(callback && !callback(id))
+      {
+        return false; // Don't continue searching
       }
     }
   }
@@ -1672,33 +2734,27 @@ bool RTREE_QUAL::Search(Node* a_node, Rect* a_rect, std::vector<DATATYPE>& a_ret
   if(a_node->IsInternalNode())
   {
     // This is an internal node in the tree
-    for(int index=0; index < a_node->m_count; ++index)
+    for(uint64_t mask = OverlapMask(a_node, a_rect); mask != 0; mask &= mask - 1)
     {
-      if(Overlap(a_rect, &a_node->m_branch[index].m_rect))
+      const int index = CountTrailingZeroBits(mask);
+      if(!Search(a_node->m_branch[index].m_child, a_rect, a_return_res, callback))
       {
-        if(!Search(a_node->m_branch[index].m_child, a_rect, a_return_res, callback))
-        {
-          // The callback indicated to stop searching
-          return false;
-        }
+        // The callback indicated to stop searching
+        return false;
       }
     }
   }
   else
   {
     // This is a leaf node
-    for(int index=0; index < a_node->m_count; ++index)
+    for(uint64_t mask = OverlapMask(a_node, a_rect); mask != 0; mask &= mask - 1)
     {
-      if(Overlap(a_rect, &a_node->m_branch[index].m_rect))
-      {
-        DATATYPE& indexdata = a_node->m_branch[index].m_data;
-        // std::cout << "found data" << std::endl;
-        a_return_res.emplace_back(indexdata);
+      DATATYPE& indexdata = a_node->m_branch[CountTrailingZeroBits(mask)].m_data;
+      a_return_res.emplace_back(indexdata);
 
-          if(callback && !callback(indexdata))
-          {
-            return false; // Don't continue searching
-          }
+      if(callback && !callback(indexdata))
+      {
+        return false; // Don't continue searching
       }
     }
   }
@@ -1747,5 +2803,9 @@ std::vector<typename RTREE_QUAL::Rect> RTREE_QUAL::ListTree() const
 
 #undef RTREE_TEMPLATE
 #undef RTREE_QUAL
+// Function-like names that would clash with gtest and the standard library
+#undef ASSERT
+#undef Min
+#undef Max
 
 #endif //RTREE_H
\ No newline at end of file
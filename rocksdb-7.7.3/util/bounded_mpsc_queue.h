@@ -0,0 +1,108 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "port/port.h"
+#include "rocksdb/rocksdb_namespace.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Bounded lock-free queue for any number of producers and one consumer,
+// after Dmitry Vyukov's bounded MPMC queue. Every slot carries a sequence
+// number telling whether it is free for the producer of a given position or
+// holds the item for the consumer of that position, so producers only
+// contend on the tail and the consumer never writes a shared counter.
+//
+// Items are exchanged with swap rather than moved: the buffers of the items
+// handed back by the consumer travel back to the producers, which avoids
+// allocations for items such as strings in the steady state.
+template <typename T>
+class BoundedMpscQueue {
+ public:
+  // `capacity` is rounded up to a power of two
+  explicit BoundedMpscQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    slots_.reset(new Slot[size]);
+    for (size_t i = 0; i < size; i++) {
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // No copying allowed
+  BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+  BoundedMpscQueue& operator=(const BoundedMpscQueue&) = delete;
+
+  // Swaps `*item` into the queue. Returns false if the queue is full.
+  // Thread-safe.
+  bool TryPush(T* item) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos & mask_];
+      const size_t seq = slot.seq.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          using std::swap;
+          swap(slot.item, *item);
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Swaps the oldest item of the queue into `*item`. Returns false if the
+  // queue is empty. Only one thread may pop at a time.
+  bool TryPop(T* item) {
+    Slot& slot = slots_[head_ & mask_];
+    const size_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != head_ + 1) {
+      assert(seq == head_);
+      return false;
+    }
+    using std::swap;
+    swap(slot.item, *item);
+    slot.seq.store(head_ + mask_ + 1, std::memory_order_release);
+    head_++;
+    return true;
+  }
+
+  // Whether TryPop() would return false. Only the popping thread may call
+  // it.
+  bool Empty() const {
+    return slots_[head_ & mask_].seq.load(std::memory_order_acquire) !=
+           head_ + 1;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> seq;
+    T item;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+  alignas(CACHE_LINE_SIZE) size_t head_ = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,134 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/bounded_mpsc_queue.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "port/port.h"
+#include "port/stack_trace.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class BoundedMpscQueueTest : public testing::Test {};
+
+TEST_F(BoundedMpscQueueTest, FullAndEmpty) {
+  // Rounded up to 8
+  BoundedMpscQueue<int> queue(5);
+  int item = 0;
+  ASSERT_TRUE(queue.Empty());
+  ASSERT_FALSE(queue.TryPop(&item));
+
+  // Wraps around the slots a few times
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 8; i++) {
+      item = round * 8 + i;
+      ASSERT_TRUE(queue.TryPush(&item));
+      ASSERT_FALSE(queue.Empty());
+    }
+    item = -1;
+    ASSERT_FALSE(queue.TryPush(&item));
+
+    // One pop makes room for exactly one push
+    ASSERT_TRUE(queue.TryPop(&item));
+    ASSERT_EQ(round * 8, item);
+    item = 100;
+    ASSERT_TRUE(queue.TryPush(&item));
+    ASSERT_FALSE(queue.TryPush(&item));
+
+    for (int i = 1; i < 8; i++) {
+      ASSERT_TRUE(queue.TryPop(&item));
+      ASSERT_EQ(round * 8 + i, item);
+    }
+    ASSERT_FALSE(queue.Empty());
+    ASSERT_TRUE(queue.TryPop(&item));
+    ASSERT_EQ(100, item);
+    ASSERT_TRUE(queue.Empty());
+    ASSERT_FALSE(queue.TryPop(&item));
+  }
+}
+
+TEST_F(BoundedMpscQueueTest, SwapsItems) {
+  BoundedMpscQueue<std::string> queue(2);
+  std::string item = "a";
+  ASSERT_TRUE(queue.TryPush(&item));
+  // The producer gets back what was in the slot
+  ASSERT_EQ("", item);
+  item = "b";
+  ASSERT_TRUE(queue.TryPush(&item));
+
+  std::string popped = "c";
+  ASSERT_TRUE(queue.TryPop(&popped));
+  ASSERT_EQ("a", popped);
+  // The consumer's old item now fills the slot, for the next producer
+  item = "d";
+  ASSERT_TRUE(queue.TryPush(&item));
+  ASSERT_EQ("c", item);
+
+  ASSERT_TRUE(queue.TryPop(&popped));
+  ASSERT_EQ("b", popped);
+  ASSERT_TRUE(queue.TryPop(&popped));
+  ASSERT_EQ("d", popped);
+  ASSERT_TRUE(queue.Empty());
+}
+
+TEST_F(BoundedMpscQueueTest, ManyProducers) {
+  constexpr uint64_t kProducers = 8;
+  constexpr uint64_t kItemsPerProducer = 20000;
+  // Small, so that the producers keep filling it up
+  BoundedMpscQueue<uint64_t> queue(16);
+
+  std::vector<port::Thread> producers;
+  for (uint64_t p = 0; p < kProducers; p++) {
+    producers.emplace_back([&queue, p]() {
+      for (uint64_t i = 0; i < kItemsPerProducer; i++) {
+        uint64_t item = p * kItemsPerProducer + i;
+        while (!queue.TryPush(&item)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<bool> seen(kProducers * kItemsPerProducer, false);
+  // The items of one producer come out in the order it pushed them
+  std::vector<uint64_t> next(kProducers, 0);
+  uint64_t popped = 0;
+  while (popped < kProducers * kItemsPerProducer) {
+    uint64_t item = 0;
+    if (!queue.TryPop(&item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_LT(item, seen.size());
+    ASSERT_FALSE(seen[item]);
+    seen[item] = true;
+    const uint64_t p = item / kItemsPerProducer;
+    ASSERT_EQ(next[p], item % kItemsPerProducer);
+    next[p]++;
+    popped++;
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  uint64_t item = 0;
+  ASSERT_FALSE(queue.TryPop(&item));
+  ASSERT_TRUE(queue.Empty());
+  for (uint64_t p = 0; p < kProducers; p++) {
+    ASSERT_EQ(kItemsPerProducer, next[p]);
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
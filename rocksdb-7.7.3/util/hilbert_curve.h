@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <math.h>
 #include "rocksdb/options.h"
+#include "rocksdb/spatial_domain.h"
 
 namespace rocksdb {
 
@@ -18,8 +19,16 @@ namespace rocksdb {
     extern void rot ( int n, int &x, int &y, int rx, int ry );
     extern int xy2d ( int n, int x, int y );
 
+    // Orders the keys by the Hilbert value of their point on a 2048 x 2048
+    // grid over `domain`, then by their id. The domain is part of the key
+    // order: it must not change over the life of a database, and Name() does
+    // not tell domains apart, so a change goes unnoticed on open.
     class HilbertComparator : public rocksdb::Comparator {
     public:
+        explicit HilbertComparator(
+            const SpatialDomain& domain = SpatialDomain::Legacy())
+            : domain_(domain) {}
+
         const char* Name() const {
             return "rocksdb.HilbertComparator";
         }
@@ -41,17 +50,13 @@ namespace rocksdb {
 
             // std::cout << x_a << " " << x_b << " " << y_a << " " << y_b << std::endl;
 
-            double x_min = -12.2304942;
-            double x_max = 37.4497039;
-            double y_min = 50.0218541;
-            double y_max = 125.9548288;
             int m = 11;
-            int n = 2048;
+            const uint32_t n = 2048;
 
-            int x_a_int = std::min(int(floor((x_a - x_min)  / ((x_max - x_min) / n))), n-1);
-            int y_a_int = std::min(int(floor((y_a - y_min)  / ((y_max - y_min) / n))), n-1);
-            int x_b_int = std::min(int(floor((x_b - x_min)  / ((x_max - x_min) / n))), n-1);
-            int y_b_int = std::min(int(floor((y_b - y_min)  / ((y_max - y_min) / n))), n-1);
+            int x_a_int = static_cast<int>(domain_.CellX(x_a, n));
+            int y_a_int = static_cast<int>(domain_.CellY(y_a, n));
+            int x_b_int = static_cast<int>(domain_.CellX(x_b, n));
+            int y_b_int = static_cast<int>(domain_.CellY(y_b, n));
 
             // std::cout << x_a_int << " " << x_b_int << " " << y_a_int << " " << y_b_int << std::endl;
             // if (x_a_int < 0 || x_a_int > 2047 || y_a_int < 0 || y_a_int > 2047 || x_b_int < 0 || x_b_int > 2047 || y_b_int < 0 || y_b_int > 2047) {
@@ -97,6 +102,9 @@ namespace rocksdb {
             (void)key;
             return;
         }
+
+    private:
+        const SpatialDomain domain_;
     };
 
 }  // namespace rocksdb
\ No newline at end of file
@@ -13,24 +13,28 @@
 #include <iostream>
 
 #include "rocksdb/options.h"
+#include "rocksdb/spatial_domain.h"
 #include "table/format.h"
 
 namespace rocksdb {
 
+    // Entry of the global secondary index: `count` consecutive secondary
+    // index entries of file `filenum`, starting with entry `id`. The block
+    // handles and exact bounds of the entries are kept in the FileMetaData
+    // of the file, so an entry only takes 16 bytes. count is 1 unless
+    // entries were merged to keep the index under its memory budget.
     struct GlobalSecIndexValue {
-        int id;
         uint64_t filenum;
-        BlockHandle blkhandle;
+        int id;
+        uint32_t count;
 
         GlobalSecIndexValue() {}
 
-        GlobalSecIndexValue(int _id, u_int64_t _filenum, BlockHandle _blkhandle):
-            id(_id), filenum(_filenum), blkhandle(_blkhandle) {}
-        
-        ~GlobalSecIndexValue() {}
+        GlobalSecIndexValue(int _id, uint64_t _filenum, uint32_t _count = 1):
+            filenum(_filenum), id(_id), count(_count) {}
 
         inline bool operator==(const GlobalSecIndexValue& rhs) const {
-            return id == rhs.id && filenum == rhs.filenum && blkhandle == rhs.blkhandle;
+            return id == rhs.id && filenum == rhs.filenum && count == rhs.count;
         }
     };
 
@@ -125,7 +129,7 @@ namespace rocksdb {
         ValueRange() : isempty_(true) {}
 
         // Whether any valued were set or not (true no values were set yet)
-        bool empty() { return isempty_; };
+        bool empty() const { return isempty_; };
         // Unset the Mbr
         void clear() { isempty_ = true; };
 
@@ -160,7 +164,7 @@ namespace rocksdb {
         Mbr() : isempty_(true) {}
 
         // Whether any valued were set or not (true no values were set yet)
-        bool empty() { return isempty_; };
+        bool empty() const { return isempty_; };
         // Unset the Mbr
         void clear() { isempty_ = true; };
 
@@ -202,11 +206,12 @@ namespace rocksdb {
 
     class SpatialSketch {
     public:
-        SpatialSketch() {
-            x_min_ = -12.2304942;
-            x_max_ = 37.4497039;
-            y_min_ = 50.0218541;
-            y_max_ = 125.9548288;
+        // Sketches are only comparable, and addable, over the same domain
+        explicit SpatialSketch(
+            const SpatialDomain& domain = SpatialDomain::Legacy())
+            : domain_(domain) {
+            // The cells index density_map_, so they are always clamped
+            domain_.wrap_below_min = false;
             for(int i = 0; i < ROWS; i++) {
                 for(int j = 0; j < COLS; j++) {
                     density_map_[i][j] = 0;
@@ -214,18 +219,6 @@ namespace rocksdb {
             }
         }
 
-        // SpatialSketch(double x_min, double x_max, double y_min, double y_max) {
-        //     x_min_ = x_min;
-        //     x_max_ = x_max;
-        //     y_min_ = y_min;
-        //     y_max_ = y_max;
-        //     for(int i = 0; i < ROWS; i++) {
-        //         for(int j = 0; j < COLS; j++) {
-        //             density_map_[i][j] = 0;
-        //         }
-        //     }
-        // }
-
         std::vector<std::pair<uint32_t, uint32_t>> getZorderSequence() {
             std::vector<std::pair<uint32_t, uint32_t>> zorder_seq;
             for(int i =0; i < ROWS; i++) {
@@ -237,7 +230,7 @@ namespace rocksdb {
             return zorder_seq;
         }
 
-        uint32_t getSumValues() {
+        uint32_t getSumValues() const {
             uint32_t total_sum =0;
             for(int i =0; i < ROWS; i++) {
                 for(int j = 0; j < COLS; j++) {
@@ -280,8 +273,8 @@ namespace rocksdb {
             double x_center = (mbr.first.min + mbr.first.max) / 2;
             double y_center = (mbr.second.min + mbr.second.max) / 2;
 
-            int x_int = std::min(int(floor((x_center - x_min_)  / ((x_max_ - x_min_) / ROWS))), ROWS-1);
-            int y_int = std::min(int(floor((y_center - y_min_)  / ((y_max_ - y_min_) / COLS))), COLS-1);
+            uint32_t x_int = domain_.CellX(x_center, ROWS);
+            uint32_t y_int = domain_.CellY(y_center, COLS);
             density_map_[x_int][y_int] += 1;
         }
 
@@ -332,10 +325,7 @@ namespace rocksdb {
             }                       
         };
 
-        double x_min_;
-        double x_max_;
-        double y_min_;
-        double y_max_;
+        SpatialDomain domain_;
     };
 
     struct Rect {
@@ -0,0 +1,286 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "util/RTree_mem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "port/stack_trace.h"
+#include "test_util/testharness.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+typedef RTree<int, float, 1, double> RTree1D;
+
+namespace {
+std::vector<int> SearchAll(const RTree1D& tree, float lo, float hi) {
+  std::vector<int> hits;
+  tree.Visit(&lo, &hi, [&](const int& value) {
+    hits.push_back(value);
+    return true;
+  });
+  std::sort(hits.begin(), hits.end());
+  return hits;
+}
+}  // namespace
+
+class RTreeTest : public testing::Test {};
+
+TEST_F(RTreeTest, SnapshotSharesNodePool) {
+  RTree1D tree;
+  for (int i = 0; i < 200; i++) {
+    const float lo = static_cast<float>(i);
+    const float hi = lo + 0.5f;
+    tree.Insert(&lo, &hi, i);
+  }
+  const size_t bytes = tree.ApproximateMemoryUsage();
+
+  RTree1D snapshot(tree, RTree1D::ShareTag());
+  ASSERT_EQ(bytes, tree.ApproximateMemoryUsage());
+  ASSERT_EQ(bytes, snapshot.ApproximateMemoryUsage());
+  ASSERT_EQ(200, snapshot.Size());
+
+  // Changes to the tree copy the nodes they touch; the snapshot keeps
+  // seeing what it was taken from
+  for (int i = 0; i < 100; i++) {
+    const float lo = static_cast<float>(i);
+    const float hi = lo + 0.5f;
+    tree.Remove(&lo, &hi, i);
+  }
+  ASSERT_EQ(100, tree.Size());
+  ASSERT_EQ(200, SearchAll(snapshot, 0, 1000).size());
+  ASSERT_EQ(100, SearchAll(tree, 0, 1000).size());
+}
+
+TEST_F(RTreeTest, NodeMemoryUsageFollowsLiveNodes) {
+  RTree1D tree;
+  const size_t empty_bytes = tree.NodeMemoryUsage();
+  ASSERT_GT(empty_bytes, 0);
+  for (int i = 0; i < 500; i++) {
+    const float lo = static_cast<float>(i);
+    const float hi = lo + 0.5f;
+    tree.Insert(&lo, &hi, i);
+  }
+  const size_t full_bytes = tree.NodeMemoryUsage();
+  ASSERT_GT(full_bytes, empty_bytes);
+  ASSERT_LE(full_bytes, tree.ApproximateMemoryUsage());
+
+  // Copying the nodes shared with a snapshot replaces them, so the count
+  // does not grow with every change
+  RTree1D snapshot(tree, RTree1D::ShareTag());
+  ASSERT_EQ(full_bytes, snapshot.NodeMemoryUsage());
+  const float lo = 0.0f;
+  const float hi = 0.5f;
+  tree.Remove(&lo, &hi, 0);
+  tree.Insert(&lo, &hi, 0);
+  ASSERT_EQ(full_bytes, tree.NodeMemoryUsage());
+
+  // Unlike the pool, it shrinks as entries are removed
+  for (int i = 0; i < 500; i++) {
+    const float entry_lo = static_cast<float>(i);
+    const float entry_hi = entry_lo + 0.5f;
+    tree.Remove(&entry_lo, &entry_hi, i);
+  }
+  ASSERT_EQ(0, tree.Size());
+  ASSERT_EQ(empty_bytes, tree.NodeMemoryUsage());
+  ASSERT_EQ(full_bytes, snapshot.NodeMemoryUsage());
+}
+
+namespace {
+// Reference for RTreeNodeBounds::OverlapMask: the per-branch test the
+// vector loops replace
+template <class BOUNDS, class ELEMTYPE, int NUMDIMS>
+uint64_t ScalarOverlapMask(const BOUNDS& bounds, int count,
+                           const ELEMTYPE* qmin, const ELEMTYPE* qmax) {
+  uint64_t mask = 0;
+  for (int index = 0; index < count; index++) {
+    bool hit = true;
+    for (int axis = 0; axis < NUMDIMS; axis++) {
+      if (!(bounds.m_max[axis][index] >= qmin[axis] &&
+            bounds.m_min[axis][index] <= qmax[axis])) {
+        hit = false;
+      }
+    }
+    if (hit) {
+      mask |= uint64_t{1} << index;
+    }
+  }
+  return mask;
+}
+
+template <class ELEMTYPE, int NUMDIMS>
+void CheckOverlapMask() {
+  typedef RTreeNodeBounds<ELEMTYPE, NUMDIMS, 50, true> Bounds;
+  Random rnd(301);
+  // Bounds on a coarse grid so that many branches touch the query exactly
+  auto coord = [&]() { return static_cast<ELEMTYPE>(rnd.Uniform(16)); };
+  for (int count = 0; count <= 50; count++) {
+    Bounds bounds;
+    // Garbage in the unused slots must not leak into the mask
+    for (int index = 0; index < Bounds::CAPACITY; index++) {
+      for (int axis = 0; axis < NUMDIMS; axis++) {
+        bounds.m_min[axis][index] = std::numeric_limits<ELEMTYPE>::lowest();
+        bounds.m_max[axis][index] = std::numeric_limits<ELEMTYPE>::max();
+      }
+    }
+    for (int index = 0; index < count; index++) {
+      ELEMTYPE min[NUMDIMS];
+      ELEMTYPE max[NUMDIMS];
+      for (int axis = 0; axis < NUMDIMS; axis++) {
+        min[axis] = coord();
+        max[axis] = min[axis] + static_cast<ELEMTYPE>(rnd.Uniform(4));
+      }
+      if (index % 7 == 3) {
+        // Never overlaps anything
+        min[0] = std::numeric_limits<ELEMTYPE>::quiet_NaN();
+      }
+      bounds.Set(index, min, max);
+    }
+    for (int query = 0; query < 100; query++) {
+      ELEMTYPE qmin[NUMDIMS];
+      ELEMTYPE qmax[NUMDIMS];
+      for (int axis = 0; axis < NUMDIMS; axis++) {
+        qmin[axis] = coord();
+        qmax[axis] = qmin[axis] + static_cast<ELEMTYPE>(rnd.Uniform(3));
+      }
+      const uint64_t expected =
+          ScalarOverlapMask<Bounds, ELEMTYPE, NUMDIMS>(bounds, count, qmin,
+                                                       qmax);
+      ASSERT_EQ(expected, bounds.OverlapMask(count, qmin, qmax))
+          << "count " << count << " query " << query;
+    }
+  }
+}
+}  // namespace
+
+TEST_F(RTreeTest, OverlapMaskMatchesScalar) {
+  CheckOverlapMask<float, 1>();
+  CheckOverlapMask<float, 2>();
+  CheckOverlapMask<double, 1>();
+  CheckOverlapMask<double, 2>();
+}
+
+TEST_F(RTreeTest, OverlapMaskBoundaries) {
+  typedef RTreeNodeBounds<float, 1, 50, true> Bounds;
+  Bounds bounds;
+  const float min[] = {1, 2, 3};
+  const float max[] = {2, 3, 4};
+  for (int index = 0; index < 3; index++) {
+    bounds.Set(index, &min[index], &max[index]);
+  }
+  // An empty node never overlaps
+  float qmin = 0;
+  float qmax = 10;
+  ASSERT_EQ(0, bounds.OverlapMask(0, &qmin, &qmax));
+  // Touching either end is an overlap
+  qmin = qmax = 2;
+  ASSERT_EQ(0x3, bounds.OverlapMask(3, &qmin, &qmax));
+  qmin = 4;
+  qmax = 5;
+  ASSERT_EQ(0x4, bounds.OverlapMask(3, &qmin, &qmax));
+  qmin = 0;
+  qmax = 1;
+  ASSERT_EQ(0x1, bounds.OverlapMask(3, &qmin, &qmax));
+  qmin = std::nextafter(4.0f, 5.0f);
+  qmax = 5;
+  ASSERT_EQ(0, bounds.OverlapMask(3, &qmin, &qmax));
+}
+
+TEST_F(RTreeTest, VectorizedSearchMatchesScalar) {
+  // The same entries in a tree searching the per-dimension bounds and in one
+  // testing branch by branch
+  RTree<int, float, 2, double, 8, 4, true> soa;
+  RTree<int, float, 2, double, 8, 4, false> aos;
+  Random rnd(17);
+  for (int i = 0; i < 1000; i++) {
+    float min[2] = {static_cast<float>(rnd.Uniform(100)),
+                    static_cast<float>(rnd.Uniform(100))};
+    float max[2] = {min[0] + rnd.Uniform(5), min[1] + rnd.Uniform(5)};
+    soa.Insert(min, max, i);
+    aos.Insert(min, max, i);
+  }
+  for (int query = 0; query < 200; query++) {
+    float min[2] = {static_cast<float>(rnd.Uniform(100)),
+                    static_cast<float>(rnd.Uniform(100))};
+    float max[2] = {min[0] + rnd.Uniform(10), min[1] + rnd.Uniform(10)};
+    std::vector<int> expected;
+    std::vector<int> actual;
+    aos.Visit(min, max, [&](const int& value) {
+      expected.push_back(value);
+      return true;
+    });
+    soa.Visit(min, max, [&](const int& value) {
+      actual.push_back(value);
+      return true;
+    });
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    ASSERT_EQ(expected, actual);
+  }
+}
+
+TEST_F(RTreeTest, RemoveIfByEntryRects) {
+  // Entries of 20 "files" spread over the same range; one file is removed
+  // by the rects of its entries while a snapshot shares the nodes
+  RTree<std::pair<int, int>, float, 1, double, 8, 4> tree;
+  std::vector<float> file_mins;
+  std::vector<float> file_maxs;
+  Random rnd(42);
+  for (int i = 0; i < 2000; i++) {
+    const int file = i % 20;
+    const float lo = static_cast<float>(rnd.Uniform(10000));
+    const float hi = lo + static_cast<float>(rnd.Uniform(20));
+    tree.Insert(&lo, &hi, std::make_pair(file, i));
+    if (file == 7) {
+      file_mins.push_back(lo);
+      file_maxs.push_back(hi);
+    }
+  }
+  decltype(tree) snapshot(tree, decltype(tree)::ShareTag());
+
+  const int removed = tree.RemoveIf(
+      file_mins.data(), file_maxs.data(), file_mins.size(),
+      [](const std::pair<int, int>& value) { return value.first == 7; });
+  ASSERT_EQ(100, removed);
+  ASSERT_EQ(1900, tree.Size());
+  ASSERT_EQ(2000, snapshot.Size());
+
+  const float lo = 0;
+  const float hi = 20000;
+  int remaining = 0;
+  tree.Visit(&lo, &hi, [&](const std::pair<int, int>& value) {
+    EXPECT_NE(7, value.first);
+    remaining++;
+    return true;
+  });
+  ASSERT_EQ(1900, remaining);
+  int in_snapshot = 0;
+  snapshot.Visit(&lo, &hi, [&](const std::pair<int, int>&) {
+    in_snapshot++;
+    return true;
+  });
+  ASSERT_EQ(2000, in_snapshot);
+
+  // Rects not reaching an entry leave it alone
+  const float miss_lo = 20001;
+  const float miss_hi = 20002;
+  ASSERT_EQ(0, tree.RemoveIf(&miss_lo, &miss_hi, 1,
+                             [](const std::pair<int, int>&) { return true; }));
+  ASSERT_EQ(0, tree.RemoveIf(&miss_lo, &miss_hi, 0,
+                             [](const std::pair<int, int>&) { return true; }));
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
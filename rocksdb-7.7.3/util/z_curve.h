@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <math.h>
 #include "rocksdb/options.h"
+#include "rocksdb/spatial_domain.h"
 #include "util/rtree.h"
 
 namespace rocksdb {
@@ -17,8 +18,16 @@ namespace rocksdb {
     extern int comp_z_order (uint32_t x_a_int, uint32_t y_a_int, uint32_t x_b_int, uint32_t y_b_int);
     extern uint32_t xy2z(int level, uint32_t x, uint32_t y);
 
+    // Orders the keys by the z-value of their point on a 262144 x 262144 grid
+    // over `domain`, then by their id. The domain is part of the key order:
+    // it must not change over the life of a database, and Name() does not
+    // tell domains apart, so a change goes unnoticed on open.
     class ZComparator : public rocksdb::Comparator {
     public:
+        explicit ZComparator(
+            const SpatialDomain& domain = SpatialDomain::Legacy())
+            : domain_(domain) {}
+
         const char* Name() const {
             return "rocksdb.HilbertComparator";
         }
@@ -40,17 +49,12 @@ namespace rocksdb {
 
             // std::cout << x_a << " " << x_b << " " << y_a << " " << y_b << std::endl;
 
-            double x_min = -12.2304942;
-            double x_max = 37.4497039;
-            double y_min = 50.0218541;
-            double y_max = 125.9548288;
-            // int m = 11;
-            int n = 262144;
+            const uint32_t n = 262144;
 
-            uint32_t x_a_int = std::min(int(floor((x_a - x_min)  / ((x_max - x_min) / n))), n-1);
-            uint32_t y_a_int = std::min(int(floor((y_a - y_min)  / ((y_max - y_min) / n))), n-1);
-            uint32_t x_b_int = std::min(int(floor((x_b - x_min)  / ((x_max - x_min) / n))), n-1);
-            uint32_t y_b_int = std::min(int(floor((y_b - y_min)  / ((y_max - y_min) / n))), n-1);
+            uint32_t x_a_int = domain_.CellX(x_a, n);
+            uint32_t y_a_int = domain_.CellY(y_a, n);
+            uint32_t x_b_int = domain_.CellX(x_b, n);
+            uint32_t y_b_int = domain_.CellY(y_b, n);
 
             // std::cout << x_a_int << " " << x_b_int << " " << y_a_int << " " << y_b_int << std::endl;
             // if (x_a_int < 0 || x_a_int > 2047 || y_a_int < 0 || y_a_int > 2047 || x_b_int < 0 || x_b_int > 2047 || y_b_int < 0 || y_b_int > 2047) {
@@ -88,11 +92,18 @@ namespace rocksdb {
             (void)key;
             return;
         }
+
+    private:
+        const SpatialDomain domain_;
     };
 
 
     class ZComparator4SecondaryIndex : public rocksdb::Comparator {
     public:
+        explicit ZComparator4SecondaryIndex(
+            const SpatialDomain& domain = SpatialDomain::Legacy())
+            : domain_(domain) {}
+
         const char* Name() const {
             return "rocksdb.HilbertComparator4SecondaryIndex";
         }
@@ -109,17 +120,12 @@ namespace rocksdb {
             double x_b = (b_mbr.first.min + b_mbr.first.max) / 2;
             double y_b = (b_mbr.second.min + b_mbr.second.max) / 2;
 
-            double x_min = -12.2304942;
-            double x_max = 37.4497039;
-            double y_min = 50.0218541;
-            double y_max = 125.9548288;
-            // int m = 11;
-            int n = 8192;
+            const uint32_t n = 8192;
 
-            uint32_t x_a_int = std::min(int(floor((x_a - x_min)  / ((x_max - x_min) / n))), n-1);
-            uint32_t y_a_int = std::min(int(floor((y_a - y_min)  / ((y_max - y_min) / n))), n-1);
-            uint32_t x_b_int = std::min(int(floor((x_b - x_min)  / ((x_max - x_min) / n))), n-1);
-            uint32_t y_b_int = std::min(int(floor((y_b - y_min)  / ((y_max - y_min) / n))), n-1);
+            uint32_t x_a_int = domain_.CellX(x_a, n);
+            uint32_t y_a_int = domain_.CellY(y_a, n);
+            uint32_t x_b_int = domain_.CellX(x_b, n);
+            uint32_t y_b_int = domain_.CellY(y_b, n);
 
             // std::cout << x_a_int << " " << x_b_int << " " << y_a_int << " " << y_b_int << std::endl;
             // if (x_a_int < 0 || x_a_int > 2047 || y_a_int < 0 || y_a_int > 2047 || x_b_int < 0 || x_b_int > 2047 || y_b_int < 0 || y_b_int > 2047) {
@@ -156,6 +162,9 @@ namespace rocksdb {
             (void)key;
             return;
         }
+
+    private:
+        const SpatialDomain domain_;
     };    
 
 }  // namespace rocksdb
\ No newline at end of file
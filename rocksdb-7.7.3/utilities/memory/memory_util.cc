@@ -39,6 +39,14 @@ Status MemoryUtil::GetApproximateMemoryUsageByType(
     }
   }
 
+  // Global secondary index, shared by all the column families of a DB
+  for (auto* db : dbs) {
+    uint64_t usage = 0;
+    if (db->GetIntProperty(DB::Properties::kGlobalSecIndexBytes, &usage)) {
+      (*usage_by_type)[MemoryUtil::kGlobalSecIndexTotal] += usage;
+    }
+  }
+
   // Cache
   for (const auto* cache : cache_set) {
     if (cache != nullptr) {